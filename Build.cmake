@@ -95,7 +95,7 @@ ENDIF()
    list( APPEND SRC_FILES ${GENERATED_G3_DEFINITIONS} )
 
    IF (MSVC OR MINGW)
-      list(REMOVE_ITEM SRC_FILES  ${LOG_SRC}/crashhandler_unix.cpp)
+      list(REMOVE_ITEM SRC_FILES  ${LOG_SRC}/crashhandler_unix.cpp ${LOG_SRC}/g3log/mmapfilesink.hpp ${LOG_SRC}/mmapfilesink.cpp)
    ELSE()
       list(REMOVE_ITEM SRC_FILES  ${LOG_SRC}/crashhandler_windows.cpp ${LOG_SRC}/g3log/stacktrace_windows.hpp ${LOG_SRC}/stacktrace_windows.cpp)
    ENDIF (MSVC OR MINGW)
@@ -133,6 +133,10 @@ ENDIF()
    ENDIF()
 
    TARGET_LINK_LIBRARIES(${G3LOG_LIBRARY} ${PLATFORM_LINK_LIBRIES})
+   IF(USE_G3_ZLIB AND ZLIB_FOUND)
+      TARGET_INCLUDE_DIRECTORIES(${G3LOG_LIBRARY} PRIVATE ${ZLIB_INCLUDE_DIRS})
+      TARGET_LINK_LIBRARIES(${G3LOG_LIBRARY} ${ZLIB_LIBRARIES})
+   ENDIF()
 
    # Kjell: This is likely not necessary, except for Windows?
    TARGET_INCLUDE_DIRECTORIES(${G3LOG_LIBRARY} PUBLIC ${LOG_SRC})
@@ -18,6 +18,8 @@
 #   add_definitions(-DDISABLE_VECTORED_EXCEPTIONHANDLING)
 #   add_definitions(-DDEBUG_BREAK_AT_FATAL_SIGNAL)
 #   add_definitions(-DG3_DYNAMIC_MAX_MESSAGE_SIZE)
+#   add_definitions(-DG3_LOCKFREE_QUEUE)
+#   add_definitions(-DG3_HAS_ZLIB)
 
 
 
@@ -83,6 +85,34 @@ ELSE()
 ENDIF(G3_LOG_FULL_FILENAME)
 
 
+# -DUSE_G3_LOCKFREE_QUEUE=ON : the background workers (kjellkod::Active) use a lock-free
+# multiple producer, single consumer queue instead of the mutex protected shared_queue.
+# Producers never block on a mutex and the consumer is only notified if it is asleep
+option (USE_G3_LOCKFREE_QUEUE
+       "Use a lock-free multiple producer, single consumer queue for the background workers" OFF)
+IF(USE_G3_LOCKFREE_QUEUE)
+   LIST(APPEND G3_DEFINITIONS G3_LOCKFREE_QUEUE)
+   message( STATUS "-DUSE_G3_LOCKFREE_QUEUE=ON		Lock-free queue used by the background workers" )
+ELSE()
+   message( STATUS "-DUSE_G3_LOCKFREE_QUEUE=OFF" )
+ENDIF(USE_G3_LOCKFREE_QUEUE)
+
+
+# -DUSE_G3_ZLIB=ON : the FileSink can gzip its rotated log files, ref: g3::RotationPolicy::compress
+# Used only if zlib is found. Off by default, g3log then has no zlib dependency
+option (USE_G3_ZLIB
+       "Compress rotated log files with zlib, if zlib is found" OFF)
+IF(USE_G3_ZLIB)
+   find_package(ZLIB QUIET)
+ENDIF(USE_G3_ZLIB)
+IF(USE_G3_ZLIB AND ZLIB_FOUND)
+   LIST(APPEND G3_DEFINITIONS G3_HAS_ZLIB)
+   message( STATUS "-DUSE_G3_ZLIB=ON			Rotated log files can be compressed with zlib" )
+ELSE()
+   message( STATUS "-DUSE_G3_ZLIB=OFF or zlib not found	Rotated log files are not compressed" )
+ENDIF(USE_G3_ZLIB AND ZLIB_FOUND)
+
+
 # -DENABLE_FATAL_SIGNALHANDLING=ON   : defualt change the
 # By default fatal signal handling is enabled. You can disable it with this option
 # enumerated in src/stacktrace_windows.cpp 
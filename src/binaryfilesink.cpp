@@ -0,0 +1,281 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+
+#include "g3log/binaryfilesink.hpp"
+#include "filesinkhelper.ipp"
+#include "binaryrecordhelper.ipp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+namespace {
+   const size_t kStreamBufferBytes = 64 * 1024;
+
+   // the record size is filled in by endRecord()
+   void beginRecord(std::string &record, g3::binary::RecordType type) {
+      record.clear();
+      record.append(sizeof(uint32_t), '\0');
+      record.push_back(static_cast<char>(type));
+   }
+
+   void endRecord(std::string &record, std::ofstream &out) {
+      const auto size = static_cast<uint32_t>(record.size() - sizeof(uint32_t));
+      std::memcpy(&record[0], &size, sizeof(size));
+      out.write(record.data(), static_cast<std::streamsize>(record.size()));
+   }
+
+   bool openBinaryFile(const std::string &file_with_path, std::ofstream &out) {
+      out.open(file_with_path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+      if (!out.is_open()) {
+         std::cerr << "FILE ERROR:  could not open log file:[" << file_with_path << "]" << std::endl;
+         return false;
+      }
+      return true;
+   }
+} // anonymous
+
+
+namespace g3 {
+   using namespace internal;
+
+
+   BinaryFileSink::BinaryFileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id)
+      : _log_file_with_path(log_directory)
+      , _stream_buffer(kStreamBufferBytes) {
+      const std::string prefix = prefixSanityFix(log_prefix);
+      if (!isValidFilename(prefix)) {
+         std::cerr << "g3log: forced abort due to illegal log prefix [" << log_prefix << "]" << std::endl;
+         abort();
+      }
+
+      std::string file_name = createLogFileName(prefix, logger_id);
+      file_name = file_name.substr(0, file_name.size() - std::string(".log").size()) + ".g3bin";
+      _log_file_with_path = pathSanityFix(_log_file_with_path, file_name);
+      _out.rdbuf()->pubsetbuf(_stream_buffer.data(), static_cast<std::streamsize>(_stream_buffer.size()));
+      if (!openBinaryFile(_log_file_with_path, _out)) {
+         std::cerr << "Cannot write log file to location, attempting current directory" << std::endl;
+         _log_file_with_path = "./" + file_name;
+         openBinaryFile(_log_file_with_path, _out);
+      }
+      assert(_out.is_open() && "cannot open log file at startup");
+
+      _out.write(binary::kMagic, sizeof(binary::kMagic));
+      _out.write(reinterpret_cast<const char *>(&binary::kVersion), sizeof(binary::kVersion));
+      _out.write(reinterpret_cast<const char *>(&binary::kByteOrderMark), sizeof(binary::kByteOrderMark));
+   }
+
+
+   BinaryFileSink::~BinaryFileSink() {
+      _out.flush();
+      _out.close();
+      std::cerr << "g3log g3BinaryFileSink shutdown. Log file at: [" << _log_file_with_path << "]\n" << std::flush;
+   }
+
+
+   void BinaryFileSink::fileWrite(LogMessageMover message) {
+      write(message.get());
+   }
+
+
+   void BinaryFileSink::receiveBatch(const LogMessageBatch &messages) {
+      for (auto &message : messages) {
+         write(message.get());
+      }
+   }
+
+
+   std::string BinaryFileSink::fileName() {
+      return _log_file_with_path;
+   }
+
+
+   void BinaryFileSink::flush() {
+      _out.flush();
+   }
+
+
+   void BinaryFileSink::write(const LogMessage &message) {
+      const LogSite *site = message._site;
+      if (site->id >= _written_sites.size()) {
+         _written_sites.resize(site->id + 1, false);
+      }
+      if (!_written_sites[site->id]) {
+         beginRecord(_record, binary::kSiteRecord);
+         appendValue(_record, site->id);
+         appendValue(_record, static_cast<int32_t>(site->line));
+         appendString(_record, site->file_path);
+         appendString(_record, site->function);
+         endRecord(_record, _out);
+         _written_sites[site->id] = true;
+      }
+
+      const int level = message._level.value;
+      if (std::find(_written_levels.begin(), _written_levels.end(), level) == _written_levels.end()) {
+         beginRecord(_record, binary::kLevelRecord);
+         appendValue(_record, static_cast<int32_t>(level));
+         appendString(_record, message._level.text);
+         endRecord(_record, _out);
+         _written_levels.push_back(level);
+      }
+
+      const uint32_t thread = threadNumber(message._call_thread_id);
+      const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(to_system_time(message._timestamp).time_since_epoch());
+      beginRecord(_record, binary::kMessageRecord);
+      appendValue(_record, static_cast<int64_t>(timestamp.count()));
+      appendValue(_record, static_cast<int32_t>(level));
+      appendValue(_record, site->id);
+      appendValue(_record, thread);
+      appendValue(_record, static_cast<int32_t>(message._line));
+      appendString(_record, message._expression);
+      appendString(_record, message._message);
+      endRecord(_record, _out);
+
+      // a FATAL entry is the last one before the process exits, it must reach the file
+      if (message.wasFatal()) {
+         _out.flush();
+      }
+   }
+
+
+   uint32_t BinaryFileSink::threadNumber(const std::thread::id &thread_id) {
+      auto found = _threads.find(thread_id);
+      if (found != _threads.end()) {
+         return found->second;
+      }
+
+      const auto number = static_cast<uint32_t>(_threads.size());
+      _threads.emplace(thread_id, number);
+      std::ostringstream oss;
+      oss << thread_id;
+      beginRecord(_record, binary::kThreadRecord);
+      appendValue(_record, number);
+      appendString(_record, oss.str());
+      endRecord(_record, _out);
+      return number;
+   }
+
+
+
+   BinaryLogReader::BinaryLogReader(const std::string &file_name)
+      : _in(file_name, std::ios_base::in | std::ios_base::binary)
+      , _good(false)
+      , _truncated(false)
+      , _file_size(0) {
+      char magic[sizeof(binary::kMagic)] = {0};
+      uint32_t version = 0;
+      uint32_t byte_order = 0;
+      _in.read(magic, sizeof(magic));
+      _in.read(reinterpret_cast<char *>(&version), sizeof(version));
+      _in.read(reinterpret_cast<char *>(&byte_order), sizeof(byte_order));
+      _good = _in.good() && 0 == std::memcmp(magic, binary::kMagic, sizeof(magic))
+              && binary::kVersion == version && binary::kByteOrderMark == byte_order;
+      if (_good) {
+         const auto records = _in.tellg();
+         _in.seekg(0, std::ios_base::end);
+         _file_size = _in.tellg();
+         _in.seekg(records);
+      }
+   }
+
+
+   // reads the next record into _record, the size prefix is not kept
+   bool BinaryLogReader::readRecord() {
+      uint32_t size = 0;
+      _in.read(reinterpret_cast<char *>(&size), sizeof(size));
+      if (_in.gcount() == 0) {
+         return false; // end of file
+      }
+      if (_in.gcount() != sizeof(size)) {
+         _truncated = true;
+         return false;
+      }
+      // a damaged size is not trusted: the record must fit in the rest of the file
+      if (static_cast<std::streamoff>(size) > _file_size - static_cast<std::streamoff>(_in.tellg())) {
+         _truncated = true;
+         return false;
+      }
+
+      _record.resize(size);
+      _in.read(&_record[0], size);
+      if (_in.gcount() != static_cast<std::streamsize>(size)) {
+         _truncated = true;
+         return false;
+      }
+      return true;
+   }
+
+
+   bool BinaryLogReader::next(std::unique_ptr<LogMessage> &message, std::string &thread_id) {
+      while (_good && readRecord()) {
+         RecordCursor cursor(_record);
+         const auto type = cursor.read<uint8_t>();
+         switch (type) {
+            case binary::kSiteRecord: {
+               const auto id = cursor.read<uint32_t>();
+               const auto line = cursor.read<int32_t>();
+               const std::string file_path = cursor.readString();
+               const std::string function = cursor.readString();
+               if (cursor.ok) {
+                  _sites[id] = registerSite(file_path.c_str(), line, function.c_str());
+               }
+               break;
+            }
+            case binary::kLevelRecord: {
+               const auto value = cursor.read<int32_t>();
+               std::string text = cursor.readString();
+               if (cursor.ok) {
+                  _levels[value] = std::move(text);
+               }
+               break;
+            }
+            case binary::kThreadRecord: {
+               const auto number = cursor.read<uint32_t>();
+               std::string text = cursor.readString();
+               if (cursor.ok) {
+                  _threads[number] = std::move(text);
+               }
+               break;
+            }
+            case binary::kMessageRecord: {
+               const auto timestamp = cursor.read<int64_t>();
+               const auto level = cursor.read<int32_t>();
+               const auto site_id = cursor.read<uint32_t>();
+               const auto thread = cursor.read<uint32_t>();
+               const auto line = cursor.read<int32_t>();
+               std::string expression = cursor.readString();
+               std::string text = cursor.readString();
+               if (!cursor.ok) {
+                  break; // a broken record is skipped
+               }
+
+               auto site = _sites.find(site_id);
+               auto level_text = _levels.find(level);
+               message.reset(new LogMessage(
+                                (site != _sites.end()) ? site->second : registerSite("", line, ""),
+                                LEVELS(level, (level_text != _levels.end()) ? level_text->second : std::string("UNKNOWN"))));
+
+               const system_time_point system_timestamp {std::chrono::duration_cast<system_time_point::duration>(std::chrono::nanoseconds(timestamp))};
+               message->_timestamp = to_high_resolution_time(system_timestamp);
+               message->_line = line;
+               message->_expression = std::move(expression);
+               message->_message = std::move(text);
+
+               auto thread_text = _threads.find(thread);
+               thread_id = (thread_text != _threads.end()) ? thread_text->second : std::to_string(thread);
+               return true;
+            }
+            default: // a record type of a later version
+               break;
+         }
+      }
+      return false;
+   }
+} // g3
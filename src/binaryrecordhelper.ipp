@@ -0,0 +1,70 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+
+// inline: the helpers are shared by the binary log formats, ref: binaryfilesink.hpp and flightrecorder.hpp
+namespace g3 {
+   namespace internal {
+      template<typename T>
+      void appendValue(std::string &record, const T &value) {
+         record.append(reinterpret_cast<const char *>(&value), sizeof(T));
+      }
+
+      inline void appendString(std::string &record, const char *text, size_t size) {
+         appendValue(record, static_cast<uint32_t>(size));
+         record.append(text, size);
+      }
+
+      inline void appendString(std::string &record, const std::string &text) {
+         appendString(record, text.data(), text.size());
+      }
+
+      inline void appendString(std::string &record, const char *text) {
+         appendString(record, text, std::strlen(text));
+      }
+
+      // Reads the fields of one record. A field beyond the end of the record marks the record as bad
+      struct RecordCursor {
+         const char *pos;
+         const char *end;
+         bool ok;
+
+         explicit RecordCursor(const std::string &record)
+            : pos(record.data()), end(record.data() + record.size()), ok(true) {}
+
+         template<typename T>
+         T read() {
+            T value {};
+            if (static_cast<size_t>(end - pos) < sizeof(T)) {
+               ok = false;
+               return value;
+            }
+            std::memcpy(&value, pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+         }
+
+         std::string readString() {
+            const auto size = read<uint32_t>();
+            if (!ok || static_cast<size_t>(end - pos) < size) {
+               ok = false;
+               return {};
+            }
+            std::string text(pos, size);
+            pos += size;
+            return text;
+         }
+      };
+   } // internal
+} // g3
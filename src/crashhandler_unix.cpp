@@ -28,6 +28,14 @@
 #include <atomic>
 #include <map>
 #include <mutex>
+#include <cerrno>
+#include <ctime>
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#include <link.h>
+#endif
 
 // Linux/Clang, OSX/Clang, OSX/gcc
 #if (defined(__clang__) || defined(__APPLE__))
@@ -50,6 +58,278 @@ namespace {
    std::map<int, std::string> gSignals = kSignals;
 
 
+   // The minimal crash record is made without heap allocations, in preallocated buffers.
+   // Ref: g3::addCrashReportFd. The file descriptors are kept as fd + 1, 0 is a free slot
+   const size_t kMaxCrashReportFds = 16;
+   const int kMaxCrashFrames = 64;
+   std::atomic<int> gCrashReportFds[kMaxCrashReportFds];
+   std::atomic<int> gCrashReportWriters{0}; // signal handlers that may write to the fds, ref: g3::removeCrashReportFd
+   void* gCrashFrames[kMaxCrashFrames];
+   char gCrashRecord[512];
+
+   // Raw stack dumps, ref: g3::setRawStackDump
+   const size_t kRawStackDumpBytes = 16 * 1024;
+   std::atomic<bool> gRawStackDump{false};
+   char gRawDump[kRawStackDumpBytes];
+   char gExecutablePath[1024];
+
+   // The load map of the raw stack dumps, ref: g3::refreshLoadMap. dl_iterate_phdr is not
+   // async-signal-safe, the load map is made beforehand and the signal handler only copies it.
+   // A refresh fills the buffer that is not published. Once the signal handler has started no
+   // more refreshes are done, the buffer it copies is left alone
+   const size_t kLoadMapBytes = 12 * 1024;
+   char gLoadMaps[2][kLoadMapBytes];
+   size_t gLoadMapSizes[2];
+   std::atomic<int> gLoadMapIndex{-1};
+   std::atomic<bool> gInSignalHandler{false};
+   std::mutex gLoadMapMutex;
+
+   // async-signal-safe formatting into a preallocated buffer
+   struct CrashRecord {
+      char* const begin;
+      char* pos;
+      char* const end;
+
+      CrashRecord(char* buffer, size_t buffer_size) : begin(buffer), pos(buffer), end(buffer + buffer_size) {}
+
+      void append(const char* text) {
+         while (*text && pos < end) {
+            *pos++ = *text++;
+         }
+      }
+
+      void append(const char* text, size_t size) {
+         while (size-- > 0 && pos < end) {
+            *pos++ = *text++;
+         }
+      }
+
+      void append(unsigned long long value, size_t min_digits = 1) {
+         char digits[24];
+         size_t size = 0;
+         do {
+            digits[size++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+         } while (value > 0 || size < min_digits);
+         while (size > 0 && pos < end) {
+            *pos++ = digits[--size];
+         }
+      }
+
+      void appendHex(uintptr_t value) {
+         const char* const hex = "0123456789abcdef";
+         char digits[2 * sizeof(uintptr_t)];
+         size_t size = 0;
+         do {
+            digits[size++] = hex[value & 0xf];
+            value >>= 4;
+         } while (value > 0);
+         append("0x");
+         while (size > 0 && pos < end) {
+            *pos++ = digits[--size];
+         }
+      }
+
+      void appendHexBytes(const unsigned char* bytes, size_t count) {
+         const char* const hex = "0123456789abcdef";
+         for (size_t index = 0; index < count && pos + 1 < end; ++index) {
+            *pos++ = hex[bytes[index] >> 4];
+            *pos++ = hex[bytes[index] & 0xf];
+         }
+      }
+
+      size_t size() const {
+         return static_cast<size_t>(pos - begin);
+      }
+   };
+
+
+#if defined(__linux__)
+   // the GNU build-id of a loaded module, from its PT_NOTE segment
+   bool findBuildId(const char* notes, size_t notes_size, const unsigned char*& build_id, size_t& build_id_size) {
+      const char* note = notes;
+      const char* const notes_end = notes + notes_size;
+      while (note + sizeof(ElfW(Nhdr)) <= notes_end) {
+         const auto header = reinterpret_cast<const ElfW(Nhdr)*>(note);
+         const char* name = note + sizeof(ElfW(Nhdr));
+         const char* description = name + ((header->n_namesz + 3) & ~3u);
+         if (NT_GNU_BUILD_ID == header->n_type && 4 == header->n_namesz && 0 == memcmp(name, "GNU", 4)
+               && description + header->n_descsz <= notes_end) {
+            build_id = reinterpret_cast<const unsigned char*>(description);
+            build_id_size = header->n_descsz;
+            return true;
+         }
+         note = description + ((header->n_descsz + 3) & ~3u);
+      }
+      return false;
+   }
+
+   struct LoadMapWriter {
+      CrashRecord* record;
+      size_t modules;
+   };
+
+   // "load map <first address>-<end address> bias <load bias> build-id <hex, or -> <path>"
+   int appendLoadedModule(struct dl_phdr_info* info, size_t, void* data) {
+      auto& writer = *static_cast<LoadMapWriter*>(data);
+      uintptr_t low = UINTPTR_MAX;
+      uintptr_t high = 0;
+      const unsigned char* build_id = nullptr;
+      size_t build_id_size = 0;
+      for (int index = 0; index < info->dlpi_phnum; ++index) {
+         const auto& segment = info->dlpi_phdr[index];
+         const uintptr_t start = info->dlpi_addr + segment.p_vaddr;
+         if (PT_LOAD == segment.p_type) {
+            low = (start < low) ? start : low;
+            high = (start + segment.p_memsz > high) ? start + segment.p_memsz : high;
+         } else if (PT_NOTE == segment.p_type && nullptr == build_id) {
+            findBuildId(reinterpret_cast<const char*>(start), segment.p_memsz, build_id, build_id_size);
+         }
+      }
+      if (0 == high) {
+         return 0;
+      }
+
+      // the main program comes first, without a name
+      const char* path = info->dlpi_name;
+      if ((nullptr == path || '\0' == *path) && 0 == writer.modules) {
+         const ssize_t size = readlink("/proc/self/exe", gExecutablePath, sizeof(gExecutablePath) - 1);
+         gExecutablePath[(size > 0) ? size : 0] = '\0';
+         path = gExecutablePath;
+      }
+      ++writer.modules;
+
+      CrashRecord& record = *writer.record;
+      record.append("\tload map ");
+      record.appendHex(low);
+      record.append("-");
+      record.appendHex(high);
+      record.append(" bias ");
+      record.appendHex(info->dlpi_addr);
+      record.append(" build-id ");
+      if (nullptr != build_id && build_id_size > 0) {
+         record.appendHexBytes(build_id, build_id_size);
+      } else {
+         record.append("-");
+      }
+      record.append(" ");
+      record.append((nullptr == path || '\0' == *path) ? "[unknown]" : path);
+      record.append("\n");
+      return 0;
+   }
+#endif
+
+   // Made outside of the signal handler, after the crash handler is installed, raw stack dumps
+   // are turned on or modules are loaded
+   void snapshotLoadMap() {
+#if defined(__linux__)
+      if (gInSignalHandler.load()) {
+         return;
+      }
+      std::lock_guard<std::mutex> guard(gLoadMapMutex);
+      if (gInSignalHandler.load()) {
+         return;
+      }
+      const int next = (0 == gLoadMapIndex.load()) ? 1 : 0;
+      CrashRecord record(gLoadMaps[next], kLoadMapBytes);
+      LoadMapWriter writer{&record, 0};
+      dl_iterate_phdr(&appendLoadedModule, &writer);
+      gLoadMapSizes[next] = record.size();
+      gLoadMapIndex.store(next);
+#endif
+   }
+
+   // The return addresses and the load map of the process, for offline symbolization by the
+   // g3log-symbolize tool. No symbol lookups or heap allocations, the load map is copied from
+   // the last snapshotLoadMap()
+   size_t formatRawStackDump(char* buffer, size_t buffer_size, void* const* frames, int count) {
+      CrashRecord record(buffer, buffer_size);
+      record.append("\n******* RAW STACKDUMP *******\n");
+      for (int index = 0; index < count; ++index) {
+         record.append("\traw frame [");
+         record.append(static_cast<unsigned long long>(index + 1));
+         record.append("] ");
+         record.appendHex(reinterpret_cast<uintptr_t>(frames[index]));
+         record.append("\n");
+      }
+      const int load_map = gLoadMapIndex.load();
+      if (load_map >= 0) {
+         record.append(gLoadMaps[load_map], gLoadMapSizes[load_map]);
+      }
+      return record.size();
+   }
+
+   const char* signalName(int signal_number) {
+      switch (signal_number) {
+         case SIGABRT: return "SIGABRT";
+         case SIGFPE: return "SIGFPE";
+         case SIGSEGV: return "SIGSEGV";
+         case SIGILL: return "SIGILL";
+         case SIGTERM: return "SIGTERM";
+         default: return "UNKNOWN SIGNAL";
+      }
+   }
+
+   void writeAll(int fd, const char* data, size_t size) {
+      while (size > 0) {
+         const ssize_t written = write(fd, data, size);
+         if (written < 0 && EINTR == errno) {
+            continue;
+         }
+         if (written <= 0) {
+            return;
+         }
+         data += written;
+         size -= static_cast<size_t>(written);
+      }
+   }
+
+   // The signal, the PID and the raw stack frames, written straight to stderr and to the crash
+   // report fds. Only async-signal-safe calls, it also works with a corrupted heap
+   void writeCrashRecord(int signal_number) {
+      const int frames = backtrace(gCrashFrames, kMaxCrashFrames);
+      struct timespec now = {0, 0};
+      clock_gettime(CLOCK_REALTIME, &now);
+
+      CrashRecord record(gCrashRecord, sizeof(gCrashRecord));
+      record.append("\n***** FATAL SIGNAL RECEIVED ******* \nReceived fatal signal: ");
+      record.append(signalName(signal_number));
+      record.append("(");
+      record.append(static_cast<unsigned long long>(signal_number));
+      record.append(")\tPID: ");
+      record.append(static_cast<unsigned long long>(getpid()));
+      record.append("\tat: ");
+      record.append(static_cast<unsigned long long>(now.tv_sec));
+      record.append(".");
+      record.append(static_cast<unsigned long long>(now.tv_nsec / 1000), 6);
+      record.append(" (seconds since the epoch)\n");
+
+      // the first frame is here
+      const bool raw = gRawStackDump.load();
+      const size_t raw_size = (raw && frames > 1) ? formatRawStackDump(gRawDump, sizeof(gRawDump) - 1, gCrashFrames + 1, frames - 1) : 0;
+      gRawDump[raw_size] = '\0';
+
+      auto writeTo = [&](int fd) {
+         writeAll(fd, gCrashRecord, record.size());
+         if (raw) {
+            writeAll(fd, gRawDump, raw_size);
+         } else if (frames > 1) {
+            backtrace_symbols_fd(gCrashFrames + 1, frames - 1, fd);
+         }
+         writeAll(fd, "\n", 1);
+      };
+      writeTo(STDERR_FILENO);
+      gCrashReportWriters.fetch_add(1);
+      for (auto& slot : gCrashReportFds) {
+         const int fd = slot.load() - 1;
+         if (fd >= 0 && STDERR_FILENO != fd) {
+            writeTo(fd);
+         }
+      }
+      gCrashReportWriters.fetch_sub(1);
+   }
+
+
    bool shouldDoExit() {
       static std::atomic<uint64_t> firstExit{0};
       auto const count = firstExit.fetch_add(1, std::memory_order_relaxed);
@@ -79,9 +359,14 @@ namespace {
          }
       }
 
+      // the minimal record first, the richer fatal message below needs a working heap
+      gInSignalHandler.store(true);
+      writeCrashRecord(signal_number);
+
       using namespace g3::internal;
       {
-         const auto dump = stackdump();
+         // a raw stack dump was already made for the crash record
+         const auto dump = stackdump(gRawStackDump.load() ? gRawDump : nullptr);
          std::ostringstream fatal_stream;
          const auto fatal_reason = exitReasonName(g3::internal::FATAL_SIGNAL, signal_number);
          fatal_stream << "Received fatal signal: " << fatal_reason;
@@ -107,6 +392,11 @@ namespace {
       // sigaction to use sa_sigaction file. ref: http://www.linuxprogrammingblog.com/code-examples/sigaction
       action.sa_flags = SA_SIGINFO;
 
+      // backtrace() can allocate at its first call, when it loads the unwinder. Done here instead of in the signal handler
+      void* warmup[1];
+      backtrace(warmup, 1);
+      snapshotLoadMap();
+
       // do it verbose style - install all signal actions
       for (const auto& sig_pair : gSignals) {
          if (sigaction(sig_pair.first, &action, nullptr) < 0) {
@@ -157,6 +447,15 @@ namespace g3 {
          const size_t max_dump_size = 50;
          void* dump[max_dump_size];
          size_t size = backtrace(dump, max_dump_size);
+         if (gRawStackDump.load()) {
+            if (size <= 1) {
+               return {};
+            }
+            snapshotLoadMap(); // not done within the signal handler
+            std::vector<char> raw(kRawStackDumpBytes);
+            const size_t raw_size = formatRawStackDump(raw.data(), raw.size(), dump + 1, static_cast<int>(size - 1));
+            return std::string(raw.data(), raw_size);
+         }
          char** messages = backtrace_symbols(dump, static_cast<int>(size)); // overwrite sigaction with caller's address
 
          // dump stack: skip first frame, since that is here
@@ -264,6 +563,42 @@ namespace g3 {
    }
 
 
+   bool addCrashReportFd(int fd) {
+      if (fd < 0) {
+         return false;
+      }
+      for (auto& slot : gCrashReportFds) {
+         int free_slot = 0;
+         if (slot.compare_exchange_strong(free_slot, fd + 1)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   void removeCrashReportFd(int fd) {
+      for (auto& slot : gCrashReportFds) {
+         int used_slot = fd + 1;
+         slot.compare_exchange_strong(used_slot, 0);
+      }
+      // a signal handler that read the fd before it was removed may still write to it
+      while (gCrashReportWriters.load() > 0) {
+         std::this_thread::yield();
+      }
+   }
+
+   void setRawStackDump(bool enabled) {
+      if (enabled) {
+         snapshotLoadMap();
+      }
+      gRawStackDump.store(enabled);
+   }
+
+   void refreshLoadMap() {
+      snapshotLoadMap();
+   }
+
+
    // installs the signal handling for whatever signal set that is currently active
    // If you want to setup your own signal handling then
    // You should instead call overrideSetupSignals()
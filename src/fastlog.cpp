@@ -0,0 +1,118 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/fastlog.hpp"
+#include "g3log/g3log.hpp"
+#include "g3log/logcapture.hpp"
+#include "g3log/logmessage.hpp"
+#include "g3log/messagepool.hpp"
+
+#include <sstream>
+
+namespace {
+   thread_local std::string t_fast_buffer;
+
+   template<typename T>
+   T read(const std::string& encoded, size_t& position) {
+      T value;
+      std::memcpy(&value, encoded.data() + position, sizeof(T));
+      position += sizeof(T);
+      return value;
+   }
+
+   /// writes the next encoded argument to the stream. @return false if there are no more arguments
+   bool writeNext(std::ostream& out, const std::string& encoded, size_t& position) {
+      using namespace g3::internal::fast;
+      if (position >= encoded.size()) {
+         return false;
+      }
+
+      const char tag = encoded[position++];
+      switch (tag) {
+         case kSigned: out << read<int64_t>(encoded, position); break;
+         case kUnsigned: out << read<uint64_t>(encoded, position); break;
+         case kDouble: out << read<double>(encoded, position); break;
+         case kChar: out << encoded[position++]; break;
+         case kBool: out << (0 != encoded[position++]); break;
+         case kPointer: out << reinterpret_cast<const void*>(read<uintptr_t>(encoded, position)); break;
+         case kString: {
+            const auto size = read<uint32_t>(encoded, position);
+            out.write(encoded.data() + position, size);
+            position += size;
+            break;
+         }
+         default: // corrupt encoding, should never happen
+            out << "[unknown LOG_FAST argument]";
+            position = encoded.size();
+            break;
+      }
+      return true;
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      namespace fast {
+         std::string& threadBuffer() {
+            return t_fast_buffer;
+         }
+
+         void releaseLargeBuffer(std::string& encoded) {
+            if (encoded.capacity() > kMaxKeptCapacity) {
+               std::string().swap(encoded);
+            }
+         }
+
+         std::string format(const char* format, const std::string& encoded) {
+            std::ostringstream out;
+            size_t position = 0;
+            for (const char* c = format; '\0' != *c; ++c) {
+               if ('{' == c[0] && '{' == c[1]) {
+                  out << '{';
+                  ++c;
+               } else if ('}' == c[0] && '}' == c[1]) {
+                  out << '}';
+                  ++c;
+               } else if ('{' == c[0] && '}' == c[1]) {
+                  if (false == writeNext(out, encoded, position)) {
+                     out << "{}"; // missing argument
+                  }
+                  ++c;
+               } else {
+                  out << *c;
+               }
+            }
+
+            while (position < encoded.size()) {
+               out << ' ';
+               writeNext(out, encoded, position);
+            }
+            return out.str();
+         }
+      } // fast
+
+
+      void saveFastMessage(const LogSite* site, const LEVELS& level, const char* format, const std::string& encoded) {
+         // fatal messages take the normal path, with the stack dump, formatted right away
+         if (wasFatal(level)) {
+            LogCapture(site, level).stream() << fast::format(format, encoded);
+            return;
+         }
+
+         if (level.value < FLAGS_minloglevel) {
+            return;
+         }
+         LEVELS msgLevel {level};
+         LogMessagePtr message {takeLogMessage(site, msgLevel)};
+         message.get()->write().assign(encoded);
+         message.get()->_fast_format = format;
+         pushMessageToLogger(message);
+      }
+   } // internal
+} // g3
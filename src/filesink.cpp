@@ -9,17 +9,230 @@
 #include "g3log/filesink.hpp"
 #include "filesinkhelper.ipp"
 #include "g3log/g3log.hpp"
+#include "g3log/crashhandler.hpp"
 #include <cassert>
 #include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <limits>
+#include <map>
+#include <vector>
+#ifdef G3_HAS_ZLIB
+#include <zlib.h>
+#endif
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+namespace {
+   // Rotations can come within the same second, the file name then gets a sequence number
+   std::string logFileStem(const std::string &file_with_path) {
+      return file_with_path.substr(0, file_with_path.size() - std::string(".log").size());
+   }
+
+   // The sequence number continues from the sink's previous file with the same stem, a name
+   // is never reused even after retention has removed the earlier file
+   std::string uniqueLogFileName(const std::string &directory, const std::string &prefix, const std::string &logger_id,
+                                 std::string &last_stem, size_t &sequence) {
+      const std::string stem = logFileStem(directory + g3::internal::createLogFileName(prefix, logger_id));
+      if (stem != last_stem) {
+         last_stem = stem;
+         sequence = 0;
+      }
+      std::string candidate;
+      do {
+         candidate = (0 == sequence) ? stem + ".log" : stem + "." + std::to_string(sequence) + ".log";
+         ++sequence;
+      } while (std::ifstream(candidate).good());
+      return candidate;
+   }
+
+   // The file names in the directory. Empty if it cannot be read
+   std::vector<std::string> directoryEntries(const std::string &directory) {
+      std::vector<std::string> names;
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+      DIR* dir = opendir(directory.empty() ? "." : directory.c_str());
+      if (nullptr == dir) {
+         return names;
+      }
+      while (struct dirent* entry = readdir(dir)) {
+         names.push_back(entry->d_name);
+      }
+      closedir(dir);
+#else
+      WIN32_FIND_DATAA entry;
+      HANDLE find = FindFirstFileA((directory.empty() ? std::string("./*") : directory + "*").c_str(), &entry);
+      if (INVALID_HANDLE_VALUE == find) {
+         return names;
+      }
+      do {
+         names.push_back(entry.cFileName);
+      } while (FindNextFileA(find, &entry));
+      FindClose(find);
+#endif
+      return names;
+   }
+
+   size_t fileSizeOnDisk(const std::string &file) {
+      std::ifstream in(file, std::ios::binary | std::ios::ate);
+      const std::streamoff size = in ? static_cast<std::streamoff>(in.tellg()) : 0;
+      return size > 0 ? static_cast<size_t>(size) : 0;
+   }
+
+   // The log files of earlier runs with the same prefix and logger id, oldest first: the names
+   // "<prefix>.<logger_id>.<YYYYmmdd-HHMMSS>[.N].log", also when compressed to ".log.gz".
+   // The date and the sequence number give the order. Other names are never matched
+   std::deque<std::pair<std::string, size_t>> findEarlierLogFiles(const std::string &directory, const std::string &prefix,
+                                                                  const std::string &logger_id, const std::string &current_file) {
+      const std::string head = prefix + "." + (logger_id.empty() ? std::string() : logger_id + ".");
+      const size_t kDateSize = std::string("YYYYmmdd-HHMMSS").size();
+      auto isDigits = [](const std::string & text, size_t from, size_t to) {
+         return from < to && std::all_of(text.begin() + from, text.begin() + to, ::isdigit);
+      };
+
+      std::map<std::pair<std::string, unsigned long>, std::pair<std::string, size_t>> found;
+      for (const auto &name : directoryEntries(directory)) {
+         if (name.compare(0, head.size(), head) != 0 || name.size() < head.size() + kDateSize + std::string(".log").size()) {
+            continue;
+         }
+         const std::string date = name.substr(head.size(), kDateSize);
+         if (!isDigits(date, 0, 8) || date[8] != '-' || !isDigits(date, 9, kDateSize)) {
+            continue;
+         }
+         std::string rest = name.substr(head.size() + kDateSize);
+         const bool compressed = rest.size() > 3 && 0 == rest.compare(rest.size() - 3, 3, ".gz");
+         if (compressed) {
+            rest.erase(rest.size() - 3);
+         }
+         if (rest.size() < 4 || 0 != rest.compare(rest.size() - 4, 4, ".log")) {
+            continue;
+         }
+         rest.erase(rest.size() - 4);
+         unsigned long sequence = 0;
+         if (!rest.empty()) {
+            if (rest[0] != '.' || !isDigits(rest, 1, rest.size()) || rest.size() > 10) {
+               continue;
+            }
+            sequence = std::stoul(rest.substr(1));
+         }
+
+         const std::string log_file = directory + (compressed ? name.substr(0, name.size() - 3) : name);
+         if (log_file == current_file) {
+            continue;
+         }
+         auto &entry = found[std::make_pair(date, sequence)];
+         entry.first = log_file;
+         entry.second += fileSizeOnDisk(directory + name); // the original and the .gz can both be there
+      }
+
+      std::deque<std::pair<std::string, size_t>> files;
+      for (auto &file : found) {
+         files.push_back(file.second);
+      }
+      return files;
+   }
+
+   // days since 1970-01-01 of a date in the proleptic Gregorian calendar
+   int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+      year -= (month <= 2) ? 1 : 0;
+      const int64_t era = (year >= 0 ? year : year - 399) / 400;
+      const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+      const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+      const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+      return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+   }
+
+   // The next boundary of whole intervals of local time, counted from the local midnight of
+   // 1970-01-01: a 24 hour interval rotates at local midnight. The local time at the boundary
+   // is converted back by mktime, which knows if daylight saving time is in effect then
+   std::chrono::system_clock::time_point nextLocalBoundary(const std::chrono::system_clock::time_point &now, int64_t interval) {
+      const std::time_t now_seconds = std::chrono::system_clock::to_time_t(now);
+      const std::tm local = g3::localtime(now_seconds);
+      const int64_t local_seconds = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * 86400
+                                    + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+      const int64_t boundary_seconds = (local_seconds / interval + 1) * interval;
+
+      std::tm boundary = {};
+      boundary.tm_year = 70;
+      boundary.tm_mday = 1 + static_cast<int>(boundary_seconds / 86400);
+      boundary.tm_sec = static_cast<int>(boundary_seconds % 86400);
+      boundary.tm_isdst = -1;
+      std::time_t boundary_time = std::mktime(&boundary);
+      if (boundary_time <= now_seconds) { // not representable, or skipped by a clock change
+         boundary_time = now_seconds + static_cast<std::time_t>(boundary_seconds - local_seconds);
+      }
+      return std::chrono::system_clock::from_time_t(boundary_time);
+   }
+
+#ifdef G3_HAS_ZLIB
+   // The compression must not compete with the live log file for the CPU
+   void lowerThreadPriority() {
+#if defined(__linux__)
+      setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+   }
+
+   // Compresses to "<file>.gz.tmp", which is renamed to "<file>.gz" when complete. Then the original is removed
+   void compressLogFile(const std::string &file) {
+      std::ifstream in(file, std::ios::binary);
+      if (!in) {
+         return; // already removed by the retention
+      }
+
+      const std::string compressed = file + ".gz";
+      const std::string temporary = compressed + ".tmp";
+      gzFile out = gzopen(temporary.c_str(), "wb6");
+      if (nullptr == out) {
+         std::cerr << "FILE ERROR: could not compress log file:[" << file << "]" << std::endl;
+         return;
+      }
+
+      std::vector<char> chunk(64 * 1024);
+      bool written = true;
+      while (written && in.read(chunk.data(), chunk.size()).gcount() > 0) {
+         const int bytes = static_cast<int>(in.gcount());
+         written = (gzwrite(out, chunk.data(), static_cast<unsigned>(bytes)) == bytes);
+      }
+      written = (Z_OK == gzclose(out)) && written;
+      in.close();
+
+      // the retention can have removed the file meanwhile, then the compressed file is not kept either
+      if (!written || !std::ifstream(file).good() || 0 != std::rename(temporary.c_str(), compressed.c_str())) {
+         std::remove(temporary.c_str());
+         return;
+      }
+      std::remove(file.c_str());
+   }
+#endif
+} // anonymous
+
 
 namespace g3 {
    using namespace internal;
 
 
-   FileSink::FileSink(const std::string &log_prefix, const std::string &log_directory, const std::string& logger_id)
+   FileSink::FileSink(const std::string &log_prefix, const std::string &log_directory, const std::string& logger_id,
+                      const FlushPolicy &flush_policy, const LogLayout &layout, const RotationPolicy &rotation_policy)
       : _log_file_with_path(log_directory)
       , _log_prefix_backup(log_prefix)
       , _outptr(new std::ofstream)
+      , _layout(layout)
+      , _logger_id(logger_id)
+      , _rotation_policy(rotation_policy)
+      , _file_bytes(0)
+      , _rotation_sequence(0)
+      , _crash_report_fd(-1)
+      , _flush_policy(flush_policy)
+      , _stop_timer(false)
    {
       _log_prefix_backup = prefixSanityFix(log_prefix);
       if (!isValidFilename(_log_prefix_backup)) {
@@ -37,11 +250,22 @@ namespace g3 {
          _outptr = createLogFile(_log_file_with_path);
       }
       assert(_outptr && "cannot open log file at startup");
+      _log_directory = _log_file_with_path.substr(0, _log_file_with_path.size() - file_name.size());
+      _rotation_stem = logFileStem(_log_file_with_path);
+      _rotation_sequence = 1;
+      _rotated_files = findEarlierLogFiles(_log_directory, _log_prefix_backup, _logger_id, _log_file_with_path);
+      useCrashReportFd();
       addLogFileHeader();
+      scheduleRotation();
+      applyRetention();
+      startFlushTimer();
    }
 
 
    FileSink::~FileSink() {
+      stopFlushTimer();
+      writeBuffer();
+
       std::string exit_msg {"g3log g3FileSink shutdown at: "};
       auto now = std::chrono::system_clock::now();
       exit_msg.append(localtime_formatted(now, internal::time_formatted)).append("\n");
@@ -49,21 +273,222 @@ namespace g3 {
 
       exit_msg.append("Log file at: [").append(_log_file_with_path).append("]\n");
       std::cerr << exit_msg << std::flush;
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+      if (_crash_report_fd >= 0) {
+         removeCrashReportFd(_crash_report_fd);
+         ::close(_crash_report_fd);
+      }
+#endif
    }
 
    // The actual log receiving function
    void FileSink::fileWrite(LogMessageMover message) {
+      const LogMessage& entry = message.get();
       if(FLAGS_logtostderr || FLAGS_alsologtostderr) {
-          std::cerr << message.get().toString() << std::flush;
+          std::cerr << _layout.toString(entry) << std::flush;
       }
 
       if(FLAGS_logtostderr) return;
 
-      std::ofstream &out(filestream());
-      out << message.get().toString() << std::flush;
+      std::lock_guard<std::mutex> lock(_buffer_mutex);
+      if (entry._timestamp >= _next_rotation) {
+         rotate(); // the entry goes to the new log file
+      }
+
+      const bool was_empty = _buffer.empty();
+      if (was_empty) {
+         _buffered_since = std::chrono::steady_clock::now();
+      }
+      const size_t buffered = _buffer.size();
+      _layout.format(entry, _buffer); // written straight into the buffer
+      _file_bytes += _buffer.size() - buffered;
+
+      // a FATAL entry is the last one before the process exits, it must reach the file
+      const bool flush_now = _buffer.size() >= _flush_policy.max_buffered_bytes
+                             || entry._level.value >= _flush_policy.flush_level.value
+                             || internal::wasFatal(entry._level);
+      if (flush_now) {
+         writeBuffer();
+      } else if (was_empty && _flush_timer.joinable()) {
+         _timer_wake.notify_one();
+      }
+
+      if (_file_bytes >= _rotate_at_bytes) {
+         rotate();
+      }
+   }
+
+   void FileSink::setRotationPolicy(const RotationPolicy &rotation_policy) {
+      std::lock_guard<std::mutex> lock(_buffer_mutex);
+      _rotation_policy = rotation_policy;
+      scheduleRotation();
+      applyRetention();
+   }
+
+   // _buffer_mutex must be held
+   void FileSink::rotate() {
+      writeBuffer();
+      const auto now_formatted = g3::localtime_formatted(std::chrono::system_clock::now(), {internal::date_formatted + " " + internal::time_formatted});
+      const std::string new_log = uniqueLogFileName(_log_directory, _log_prefix_backup, _logger_id, _rotation_stem, _rotation_sequence);
+      std::unique_ptr<std::ofstream> log_stream = createLogFile(new_log);
+      if (nullptr == log_stream) {
+         filestream() << "\n" << now_formatted << " Unable to rotate log file. Unsuccessful log name was: " << new_log << std::flush;
+         _file_bytes = 0; // tried again at the next limit
+         scheduleRotation();
+         return;
+      }
+
+      const std::string rotating = now_formatted + "\n\tRotating log file to: " + new_log + "\n";
+      filestream() << rotating << std::flush;
+      _rotated_files.emplace_back(_log_file_with_path, _file_bytes + rotating.size());
+
+      const std::string old_log = _log_file_with_path;
+      _log_file_with_path = new_log;
+      _outptr = std::move(log_stream);
+      useCrashReportFd();
+#ifdef G3_HAS_ZLIB
+      if (_rotation_policy.compress) {
+         if (!_compressor) {
+            _compressor = kjellkod::Active::createActive();
+            _compressor->send(&lowerThreadPriority);
+         }
+         _compressor->send([old_log] { compressLogFile(old_log); });
+      }
+#endif
+      const std::string rotated = header() + now_formatted + "\n\tRotated log file. The previous log file was at: " + old_log + "\n";
+      filestream() << rotated << std::flush;
+      _file_bytes = rotated.size();
+
+      scheduleRotation();
+      applyRetention();
+   }
+
+   // _buffer_mutex must be held
+   void FileSink::scheduleRotation() {
+      _rotate_at_bytes = (_rotation_policy.max_file_bytes > 0) ? _rotation_policy.max_file_bytes : std::numeric_limits<size_t>::max();
+      _next_rotation = g3::high_resolution_time_point::max();
+
+      const auto interval = _rotation_policy.interval.count();
+      if (interval > 0) {
+         // the interval boundaries are in local time, the entries have high resolution timestamps
+         const auto system_now = std::chrono::system_clock::now();
+         const auto high_resolution_now = std::chrono::high_resolution_clock::now();
+         const auto until_boundary = nextLocalBoundary(system_now, interval) - system_now;
+         _next_rotation = high_resolution_now + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(until_boundary);
+      }
+   }
+
+   // _buffer_mutex must be held. The current log file is never removed
+   void FileSink::applyRetention() {
+      // the sizes on disk: a rotated file counts with its .gz size once the compression is done
+      if (_rotation_policy.max_total_bytes > 0) {
+         for (auto &file : _rotated_files) {
+            file.second = fileSizeOnDisk(file.first) + fileSizeOnDisk(file.first + ".gz");
+         }
+      }
+
+      size_t total_bytes = _file_bytes;
+      for (auto &file : _rotated_files) {
+         total_bytes += file.second;
+      }
+
+      auto over_limits = [&] {
+         const bool too_many = _rotation_policy.max_files > 0 && _rotated_files.size() + 1 > _rotation_policy.max_files;
+         const bool too_big = _rotation_policy.max_total_bytes > 0 && total_bytes > _rotation_policy.max_total_bytes;
+         return too_many || too_big;
+      };
+      while (!_rotated_files.empty() && over_limits()) {
+         std::remove(_rotated_files.front().first.c_str());
+         std::remove((_rotated_files.front().first + ".gz").c_str());
+         total_bytes -= _rotated_files.front().second;
+         _rotated_files.pop_front();
+      }
+   }
+
+   void FileSink::setFlushPolicy(const FlushPolicy &flush_policy) {
+      stopFlushTimer();
+      {
+         std::lock_guard<std::mutex> lock(_buffer_mutex);
+         writeBuffer();
+         _flush_policy = flush_policy;
+      }
+      startFlushTimer();
+   }
+
+   void FileSink::flush() {
+      std::lock_guard<std::mutex> lock(_buffer_mutex);
+      writeBuffer();
+   }
+
+   // _buffer_mutex must be held, or the timer thread not running
+   void FileSink::writeBuffer() {
+      if (_buffer.empty()) {
+         return;
+      }
+      filestream() << _buffer << std::flush;
+      _buffer.clear(); // the capacity is kept for the next entries
+   }
+
+   void FileSink::startFlushTimer() {
+      if (_flush_policy.max_latency.count() <= 0 || _flush_policy.max_buffered_bytes == 0) {
+         return; // every entry is flushed anyhow, or no timer is wanted
+      }
+      _stop_timer = false;
+      _flush_timer = std::thread(&FileSink::runFlushTimer, this);
    }
 
+   void FileSink::stopFlushTimer() {
+      if (!_flush_timer.joinable()) {
+         return;
+      }
+      {
+         std::lock_guard<std::mutex> lock(_buffer_mutex);
+         _stop_timer = true;
+      }
+      _timer_wake.notify_one();
+      _flush_timer.join();
+   }
+
+   // Writes the buffer when its oldest entry has waited for max_latency. The timer thread is
+   // only woken by the first entry in an empty buffer
+   void FileSink::runFlushTimer() {
+      std::unique_lock<std::mutex> lock(_buffer_mutex);
+      while (!_stop_timer) {
+         if (_buffer.empty()) {
+            _timer_wake.wait(lock);
+            continue;
+         }
+
+         const auto deadline = _buffered_since + _flush_policy.max_latency;
+         if (std::chrono::steady_clock::now() >= deadline) {
+            writeBuffer();
+            continue;
+         }
+         _timer_wake.wait_until(lock, deadline);
+      }
+   }
+
+   // A fatal signal appends its crash record to the current log file, written by the signal
+   // handler through a file descriptor of its own. The log file is written in append mode
+   void FileSink::useCrashReportFd() {
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+      const int previous = _crash_report_fd;
+      _crash_report_fd = ::open(_log_file_with_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+      if (_crash_report_fd >= 0 && !addCrashReportFd(_crash_report_fd)) {
+         ::close(_crash_report_fd);
+         _crash_report_fd = -1;
+      }
+      if (previous >= 0) {
+         removeCrashReportFd(previous);
+         ::close(previous);
+      }
+#endif
+   }
+
+
    std::string FileSink::changeLogFile(const std::string &directory, const std::string &logger_id) {
+      std::lock_guard<std::mutex> lock(_buffer_mutex);
+      writeBuffer(); // the buffered entries belong to the current log file
 
       auto now = std::chrono::system_clock::now();
       auto now_formatted = g3::localtime_formatted(now, {internal::date_formatted + " " + internal::time_formatted});
@@ -86,6 +511,14 @@ namespace g3 {
       std::string old_log = _log_file_with_path;
       _log_file_with_path = prospect_log;
       _outptr = std::move(log_stream);
+      useCrashReportFd();
+      _log_directory = directory;
+      _logger_id = logger_id;
+      _file_bytes = 0;
+      _rotation_stem = logFileStem(_log_file_with_path);
+      _rotation_sequence = 1;
+      _rotated_files = findEarlierLogFiles(_log_directory, _log_prefix_backup, _logger_id, _log_file_with_path);
+      applyRetention();
       ss_change << "\n\tNew log file. The previous log file was at: ";
       ss_change << old_log << "\n";
       filestream() << now_formatted << ss_change.str();
@@ -17,17 +17,20 @@
 #include <fstream>
 #include <sstream>
 #include <cstring>
+#include <cstdio>
+#include <atomic>
 #ifndef OS_WINDOWS
 #include <unistd.h>
 #endif
 
 
+// inline: the helpers are shared by the file sinks
 namespace g3 {
    namespace internal {
       static const std::string file_name_time_formatted = "%Y%m%d-%H%M%S";
 
       // check for filename validity -  filename should not be part of PATH
-      bool isValidFilename(const std::string &prefix_filename) {
+      inline bool isValidFilename(const std::string &prefix_filename) {
          std::string illegal_characters("/,|<>:#$%{}[]\'\"^!?+* ");
          size_t pos = prefix_filename.find_first_of(illegal_characters, 0);
          if (pos != std::string::npos) {
@@ -41,7 +44,7 @@ namespace g3 {
          return true;
       }
 
-      std::string prefixSanityFix(std::string prefix) {
+      inline std::string prefixSanityFix(std::string prefix) {
          prefix.erase(std::remove_if(prefix.begin(), prefix.end(), ::isspace), prefix.end());
          prefix.erase(std::remove(prefix.begin(), prefix.end(), '/'), prefix.end());
          prefix.erase(std::remove(prefix.begin(), prefix.end(), '\\'), prefix.end());
@@ -55,7 +58,7 @@ namespace g3 {
          return prefix;
       }
 
-      std::string pathSanityFix(std::string path, std::string file_name) {
+      inline std::string pathSanityFix(std::string path, std::string file_name) {
          // Unify the delimeters,. maybe sketchy solution but it seems to work
          // on at least win7 + ubuntu. All bets are off for older windows
          std::replace(path.begin(), path.end(), '\\', '/');
@@ -80,7 +83,7 @@ namespace g3 {
          return path;
       }
 
-      std::string header() {
+      inline std::string header() {
          std::ostringstream ss_entry;
          //  Day Month Date Time Year: is written as "%a %b %d %H:%M:%S %Y" and formatted output as : Wed Sep 19 08:28:16 2012
          auto now = std::chrono::system_clock::now();
@@ -90,7 +93,7 @@ namespace g3 {
          return ss_entry.str();
       }
 
-      std::string createLogFileName(const std::string &verified_prefix, const std::string &logger_id) {
+      inline std::string createLogFileName(const std::string &verified_prefix, const std::string &logger_id) {
          std::stringstream oss_name;
          oss_name << verified_prefix << ".";
          if( logger_id != "" ) {
@@ -102,9 +105,11 @@ namespace g3 {
          return oss_name.str();
       }
 
-      bool openLogFile(const std::string &complete_file_with_path, std::ofstream &outstream) {
-         std::ios_base::openmode mode = std::ios_base::out; // for clarity: it's really overkill since it's an ofstream
-         mode |= std::ios_base::trunc;
+      inline bool openLogFile(const std::string &complete_file_with_path, std::ofstream &outstream) {
+         // truncated, then written in append mode. The crash record of a fatal signal is appended
+         // to the file through another file descriptor, ref: g3::addCrashReportFd
+         std::ofstream(complete_file_with_path, std::ios_base::out | std::ios_base::trunc);
+         std::ios_base::openmode mode = std::ios_base::out | std::ios_base::app;
          outstream.open(complete_file_with_path, mode);
          if (!outstream.is_open()) {
             std::ostringstream ss_error;
@@ -117,7 +122,13 @@ namespace g3 {
          return true;
       }
 
-      bool setSymlink(const std::string &file_with_full_path) {          
+      // unique within the process, all the file sinks share it
+      inline unsigned long nextSymlinkId() {
+         static std::atomic<unsigned long> id {0};
+         return ++id;
+      }
+
+      inline bool setSymlink(const std::string &file_with_full_path) {          
           #ifndef OS_WINDOWS
           const char *slash = strrchr(file_with_full_path.c_str(), '/');
           #else
@@ -136,12 +147,26 @@ namespace g3 {
           std::string linkname = modulename + ".log";
 
           linkpath += linkname;
-          unlink(linkpath.c_str()); // delete old symlink          
           #ifdef OS_WINDOWS
+          unlink(linkpath.c_str()); // delete old symlink
           //To do
           #else
-          const char *linkdest = slash ? (slash + 1) : file_with_full_path.c_str();          
-          if (symlink(linkdest, linkpath.c_str()) != 0) {
+          // The new link is made under a temporary name and renamed over the old one. Readers
+          // following the link always find a log file, also during a rotation. The temporary name
+          // has the link's name, i.e. the prefix, the pid and a per process id: sinks in other
+          // processes, or in this one, never share it
+          auto replaceLink = [](const std::string &destination, const std::string &link) {
+             const std::string temporary = link + "." + std::to_string(getpid()) + "." + std::to_string(nextSymlinkId()) + ".tmp";
+             unlink(temporary.c_str());
+             if (symlink(destination.c_str(), temporary.c_str()) != 0 || rename(temporary.c_str(), link.c_str()) != 0) {
+                unlink(temporary.c_str());
+                return false;
+             }
+             return true;
+          };
+
+          const char *linkdest = slash ? (slash + 1) : file_with_full_path.c_str();
+          if (!replaceLink(linkdest, linkpath)) {
              return false;
           }
 
@@ -149,8 +174,7 @@ namespace g3 {
           // FLAGS_log_link, if indicated
           if (!FLAGS_log_link.empty()) {
              linkpath = FLAGS_log_link + "/" + linkname;
-             unlink(linkpath.c_str());                  // delete old one if it exists
-             if (symlink(file_with_full_path.c_str(), linkpath.c_str()) != 0) {             
+             if (!replaceLink(file_with_full_path, linkpath)) {
                 return false;
              }
          }
@@ -159,7 +183,7 @@ namespace g3 {
       }
       
 
-      std::unique_ptr<std::ofstream> createLogFile(const std::string &file_with_full_path) {
+      inline std::unique_ptr<std::ofstream> createLogFile(const std::string &file_with_full_path) {
          std::unique_ptr<std::ofstream> out(new std::ofstream);
          std::ofstream &stream(*(out.get()));
          bool success_with_open_file = openLogFile(file_with_full_path, stream);
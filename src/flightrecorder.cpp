@@ -0,0 +1,324 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+
+#include "g3log/flightrecorder.hpp"
+#include "g3log/fastlog.hpp"
+#include "binaryrecordhelper.ipp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <thread>
+
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+   const size_t kMinimumRingBytes = 64 * 1024;
+
+   // the header page, ref: g3::flight
+   struct Header {
+      char magic[sizeof(g3::flight::kMagic)];
+      uint32_t version;
+      uint32_t byte_order;
+      uint64_t ring_bytes;
+      std::atomic<uint64_t> written;
+   };
+   static_assert(sizeof(Header) <= g3::flight::kHeaderBytes, "the header must fit in the header page");
+
+   // the record positions are written and read by several threads, also in a shared mapping
+   static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "the position is stored as a plain uint64");
+
+   uint64_t alignRecord(uint64_t bytes) {
+      return (bytes + 7) & ~uint64_t(7);
+   }
+
+   // of the record's fields, 8 bytes at a time: a record damaged by a lapped writer does not match
+   uint32_t fieldsChecksum(const char *data, size_t size) {
+      const uint64_t kMultiplier = 0xff51afd7ed558ccdULL;
+      uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+      size_t offset = 0;
+      for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+         uint64_t word;
+         std::memcpy(&word, data + offset, sizeof(word));
+         hash = (hash ^ word) * kMultiplier;
+         hash ^= hash >> 32;
+      }
+      uint64_t tail = 0;
+      std::memcpy(&tail, data + offset, size - offset);
+      hash = (hash ^ tail) * kMultiplier;
+      return static_cast<uint32_t>(hash ^ (hash >> 32));
+   }
+
+   std::string threadIdText(const std::thread::id &thread_id) {
+      std::ostringstream oss;
+      oss << thread_id;
+      return oss.str();
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+
+      FlightRecorder::FlightRecorder(const std::string &file_name, size_t ring_bytes)
+         : _fd(-1)
+         , _mapping(nullptr)
+         , _mapping_bytes(0)
+         , _ring(nullptr)
+         , _ring_bytes(0) {
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+         // the recording of an earlier run can hold the last messages before a kill
+         if (std::ifstream(file_name).good()) {
+            std::rename(file_name.c_str(), (file_name + ".previous").c_str());
+         }
+
+         _ring_bytes = std::max(ring_bytes, kMinimumRingBytes);
+         _ring_bytes = ((_ring_bytes + flight::kHeaderBytes - 1) / flight::kHeaderBytes) * flight::kHeaderBytes;
+         _mapping_bytes = flight::kHeaderBytes + _ring_bytes;
+
+         _fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+         if (_fd < 0 || 0 != ::ftruncate(_fd, static_cast<off_t>(_mapping_bytes))) {
+            std::cerr << "FILE ERROR: could not create the flight recorder file:[" << file_name << "] " << std::strerror(errno) << std::endl;
+            return;
+         }
+#if defined(__linux__)
+         // the disk space is taken now, a full disk must not give a SIGBUS at a LOG call
+         if (0 != posix_fallocate(_fd, 0, static_cast<off_t>(_mapping_bytes))) {
+            std::cerr << "FILE ERROR: could not reserve disk space for the flight recorder file:[" << file_name << "]" << std::endl;
+         }
+#endif
+
+         void *mapping = ::mmap(nullptr, _mapping_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+         if (MAP_FAILED == mapping) {
+            std::cerr << "FILE ERROR: could not map the flight recorder file:[" << file_name << "] " << std::strerror(errno) << std::endl;
+            return;
+         }
+         _mapping = static_cast<char *>(mapping);
+
+         Header *header = new (_mapping) Header;
+         std::memcpy(header->magic, flight::kMagic, sizeof(header->magic));
+         header->version = flight::kVersion;
+         header->byte_order = flight::kByteOrderMark;
+         header->ring_bytes = _ring_bytes;
+         header->written.store(0);
+         _ring = _mapping + flight::kHeaderBytes;
+#else
+         (void)ring_bytes;
+         std::cerr << "g3log: the flight recorder is not supported on this platform, [" << file_name << "] is not used" << std::endl;
+#endif
+      }
+
+
+      FlightRecorder::~FlightRecorder() {
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+         if (nullptr != _mapping) {
+            ::munmap(_mapping, _mapping_bytes);
+         }
+         if (_fd >= 0) {
+            ::close(_fd);
+         }
+#endif
+      }
+
+
+      void FlightRecorder::record(const LogMessage &message) {
+         if (nullptr == _ring) {
+            return;
+         }
+
+         // the thread id text is made once per thread
+         thread_local std::string fields;
+         thread_local const std::string this_thread_id = threadIdText(std::this_thread::get_id());
+         std::string other_thread_id;
+         const std::string *thread_id = &this_thread_id;
+         if (message._call_thread_id != std::this_thread::get_id()) {
+            other_thread_id = threadIdText(message._call_thread_id);
+            thread_id = &other_thread_id;
+         }
+
+         const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(to_system_time(message._timestamp).time_since_epoch());
+         fields.clear();
+         appendValue(fields, static_cast<int64_t>(timestamp.count()));
+         appendValue(fields, static_cast<int32_t>(message._level.value));
+         appendValue(fields, static_cast<int32_t>(message._line));
+         appendString(fields, message._level.text);
+         appendString(fields, message._site->file_path);
+         appendString(fields, message._site->function);
+         appendString(fields, *thread_id);
+
+         // A record is at most a quarter of the ring, it must not overwrite the whole ring. A huge
+         // message, and then the expression, is cut. A record that is still too large is not recorded
+         const char *fast_format = (nullptr == message._fast_format) ? "" : message._fast_format;
+         const size_t fast_format_size = std::strlen(fast_format);
+         const size_t max_record = static_cast<size_t>(_ring_bytes / 4);
+         const size_t used = flight::kRecordHeaderBytes + fields.size() + 3 * sizeof(uint32_t) + fast_format_size;
+         if (used > max_record) {
+            return;
+         }
+         const size_t message_size = std::min(max_record - used, message._message.size());
+         const size_t expression_size = std::min(max_record - used - message_size, message._expression.size());
+         appendString(fields, message._expression.data(), expression_size);
+         appendString(fields, fast_format, fast_format_size);
+         appendString(fields, message._message.data(), message_size);
+
+         const uint32_t size = static_cast<uint32_t>(fields.size());
+         const uint32_t checksum = fieldsChecksum(fields.data(), fields.size());
+         const uint64_t total = alignRecord(flight::kRecordHeaderBytes + size);
+         Header *header = reinterpret_cast<Header *>(_mapping);
+         const uint64_t position = header->written.fetch_add(total);
+
+         // lapped: a newer record was reserved over these bytes, by writers a full ring ahead
+         auto lapped = [&] {
+            return header->written.load(std::memory_order_acquire) > position + _ring_bytes;
+         };
+         if (lapped()) {
+            return;
+         }
+         copy(position + sizeof(uint64_t), reinterpret_cast<const char *>(&size), sizeof(size));
+         copy(position + sizeof(uint64_t) + sizeof(uint32_t), reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+         copy(position + flight::kRecordHeaderBytes, fields.data(), fields.size());
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (lapped()) {
+            return; // the position store would land in the newer record
+         }
+
+         // written last: the record is complete. The position is 8 byte aligned, it never wraps
+         auto complete = reinterpret_cast<std::atomic<uint64_t> *>(_ring + (position % _ring_bytes));
+         complete->store(position, std::memory_order_release);
+      }
+
+
+      void FlightRecorder::copy(uint64_t position, const char *data, size_t size) {
+         const size_t offset = static_cast<size_t>(position % _ring_bytes);
+         const size_t first = std::min(size, static_cast<size_t>(_ring_bytes) - offset);
+         std::memcpy(_ring + offset, data, first);
+         std::memcpy(_ring, data + first, size - first);
+      }
+   } // internal
+
+
+
+   FlightRecorderReader::FlightRecorderReader(const std::string &file_name)
+      : _written(0)
+      , _position(0)
+      , _start(0)
+      , _good(false)
+      , _skipped(0) {
+      std::ifstream in(file_name, std::ios_base::in | std::ios_base::binary);
+      const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      if (content.size() < flight::kHeaderBytes) {
+         return;
+      }
+
+      char magic[sizeof(flight::kMagic)];
+      uint32_t version = 0;
+      uint32_t byte_order = 0;
+      uint64_t ring_bytes = 0;
+      size_t offset = 0;
+      auto read_header = [&](void *value, size_t size) {
+         std::memcpy(value, content.data() + offset, size);
+         offset += size;
+      };
+      read_header(magic, sizeof(magic));
+      read_header(&version, sizeof(version));
+      read_header(&byte_order, sizeof(byte_order));
+      read_header(&ring_bytes, sizeof(ring_bytes));
+      read_header(&_written, sizeof(_written));
+      _good = 0 == std::memcmp(magic, flight::kMagic, sizeof(magic)) && flight::kVersion == version
+              && flight::kByteOrderMark == byte_order && ring_bytes > 0 && 0 == ring_bytes % 8
+              && content.size() >= flight::kHeaderBytes + ring_bytes;
+      if (!_good) {
+         return;
+      }
+
+      _ring = content.substr(flight::kHeaderBytes, static_cast<size_t>(ring_bytes));
+      // the oldest bytes of the ring can be the overwritten start of a record
+      _start = (_written > ring_bytes) ? alignRecord(_written - ring_bytes) : 0;
+      _position = _start;
+   }
+
+
+   void FlightRecorderReader::read(uint64_t position, char *data, size_t size) const {
+      const size_t offset = static_cast<size_t>(position % _ring.size());
+      const size_t first = std::min(size, _ring.size() - offset);
+      std::memcpy(data, _ring.data() + offset, first);
+      std::memcpy(data + first, _ring.data(), size - first);
+   }
+
+
+   bool FlightRecorderReader::next(std::unique_ptr<LogMessage> &message, std::string &thread_id) {
+      using namespace internal;
+      bool searching = false;
+      while (_good && _position + flight::kRecordHeaderBytes <= _written) {
+         uint64_t stored_position = 0;
+         uint32_t size = 0;
+         uint32_t checksum = 0;
+         read(_position, reinterpret_cast<char *>(&stored_position), sizeof(stored_position));
+         read(_position + sizeof(uint64_t), reinterpret_cast<char *>(&size), sizeof(size));
+         read(_position + sizeof(uint64_t) + sizeof(uint32_t), reinterpret_cast<char *>(&checksum), sizeof(checksum));
+         const uint64_t total = alignRecord(flight::kRecordHeaderBytes + size);
+         const bool complete = stored_position == _position && total <= _ring.size() && _position + total <= _written;
+
+         std::string fields;
+         if (complete) {
+            fields.resize(size);
+            read(_position + flight::kRecordHeaderBytes, &fields[0], size);
+         }
+
+         // not a complete record, or damaged by a lapped writer: the next one is searched for
+         if (!complete || checksum != fieldsChecksum(fields.data(), fields.size())) {
+            if (!searching && _position != _start) {
+               ++_skipped;
+            }
+            searching = true;
+            _position += 8;
+            continue;
+         }
+
+         _position += total;
+         searching = false;
+
+         RecordCursor cursor(fields);
+         const auto timestamp = cursor.read<int64_t>();
+         const auto level = cursor.read<int32_t>();
+         const auto line = cursor.read<int32_t>();
+         const std::string level_text = cursor.readString();
+         const std::string file_path = cursor.readString();
+         const std::string function = cursor.readString();
+         thread_id = cursor.readString();
+         std::string expression = cursor.readString();
+         const std::string fast_format = cursor.readString();
+         std::string text = cursor.readString();
+         if (!cursor.ok) {
+            ++_skipped;
+            continue;
+         }
+
+         message.reset(new LogMessage(registerSite(file_path.c_str(), line, function.c_str()), LEVELS(level, level_text)));
+         const system_time_point system_timestamp {std::chrono::duration_cast<system_time_point::duration>(std::chrono::nanoseconds(timestamp))};
+         message->_timestamp = to_high_resolution_time(system_timestamp);
+         message->_line = line;
+         message->_expression = std::move(expression);
+         message->_message = fast_format.empty() ? std::move(text) : fast::format(fast_format.c_str(), text);
+         return true;
+      }
+      return false;
+   }
+} // g3
@@ -24,6 +24,7 @@
 #include "g3log/crashhandler.hpp"
 #include "g3log/logmessage.hpp"
 #include "g3log/loglevels.hpp"
+#include "g3log/messagepool.hpp"
 #include "gflags/gflags.h"
 
 
@@ -34,6 +35,7 @@
 #include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <sstream>
 
 
@@ -45,17 +47,16 @@ DEFINE_bool(alsologtostderr, false,
 DEFINE_int32(minloglevel, 0, "Messages logged at a lower level than this don't "
                   "actually get logged anywhere");
 
-// To do
-/**********   ************/
+// Off by default: the highest value, no level reaches it
 DEFINE_int32(stderrthreshold,
-             G3LOG_ERROR.value,
+             std::numeric_limits<int32_t>::max(),
              "log messages at or above this level are copied to stderr in "
-             "addition to logfiles.  This flag obsoletes --alsologtostderr.");
+             "addition to the sinks, once per message. Off by default");
 
-DEFINE_int32(v, 0, "show all log message for level <= v.");
+DEFINE_int32(v, 0, "show all VLOG(n) messages for n <= v. Ref: g3::setVLogLevel");
+DEFINE_string(vmodule, "", "per-module verbose level, <pattern>=<level>,... "
+              "The pattern is a glob of the file name without its extension. Ref: g3::setVModule");
 DEFINE_string(log_link, "", "put symbol link to the latest log.");
-// To do
-/**********   ************/
 
 static const char* DefaultLogDir() {
   const char* env;
@@ -201,12 +202,19 @@ namespace g3 {
       * i.e. (dlopen + dlsym)  */
       void saveMessage(const char* entry, const char* file, int line, const char* function, const LEVELS& level,
                        const char* boolean_expression, int fatal_signal, const char* stack_trace) {
+         saveMessage(entry, registerSite(file, line, function), level, boolean_expression, fatal_signal, stack_trace);
+      }
+
+      /** The call site record is owned by g3log, only the message content is copied */
+      void saveMessage(const char* entry, const LogSite* site, const LEVELS& level,
+                       const char* boolean_expression, int fatal_signal, const char* stack_trace) {
 
          if(level.value < FLAGS_minloglevel) {           
            return;
          }
          LEVELS msgLevel {level};
-         LogMessagePtr message {std2::make_unique<LogMessage>(file, line, function, msgLevel)};
+         // a fatal message does not touch the pool's lock, it can come from the signal handler
+         LogMessagePtr message {internal::wasFatal(level) ? std2::make_unique<LogMessage>(site, msgLevel) : takeLogMessage(site, msgLevel)};
          message.get()->write().append(entry);
          message.get()->setExpression(boolean_expression);
 
@@ -254,6 +262,7 @@ namespace g3 {
          if (!internal::isLoggingInitialized()) {
             std::call_once(g_set_first_uninitialized_flag, [&] {
                g_first_unintialized_msg = incoming.release();
+               g_first_unintialized_msg->formatFastMessage();
                std::string err = {"LOGGER NOT INITIALIZED:\n\t\t"};
                err.append(g_first_unintialized_msg->message());
                std::string& str = g_first_unintialized_msg->write();
@@ -22,11 +22,23 @@
 #include <thread>
 #include <functional>
 #include <memory>
+#include "g3log/generated_definitions.hpp"
+#if defined(G3_LOCKFREE_QUEUE)
+#include "g3log/lockfree_queue.hpp"
+#else
 #include "g3log/shared_queue.hpp"
+#endif
 
 namespace kjellkod {
    typedef std::function<void() > Callback;
 
+   // The message queue is chosen at compile time. See Options.cmake: USE_G3_LOCKFREE_QUEUE
+#if defined(G3_LOCKFREE_QUEUE)
+   typedef lockfree_queue<Callback> MessageQueue;
+#else
+   typedef shared_queue<Callback> MessageQueue;
+#endif
+
    class Active {
    private:
       Active() : done_(false) {} // Construction ONLY through factory createActive();
@@ -41,7 +53,7 @@ namespace kjellkod {
          }
       }
 
-      shared_queue<Callback> mq_;
+      MessageQueue mq_;
       std::thread thd_;
       bool done_;
 
@@ -0,0 +1,131 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "g3log/logmessage.hpp"
+
+namespace g3 {
+
+   /** The binary log file format, written by BinaryFileSink and read by BinaryLogReader.
+   *
+   * The file starts with the magic "G3LOGBIN", the format version and kByteOrderMark, all
+   * values are in the byte order of the writing machine. Then follows a sequence of records:
+   *    uint32 size of the rest of the record, uint8 record type, the fields of the record
+   *
+   * Strings are written as uint32 size + the characters. The call sites, levels and threads are
+   * described once per file, in a definition record before their first message:
+   *    kSiteRecord     uint32 site id, int32 line, string file path, string function
+   *    kLevelRecord    int32 level value, string level text
+   *    kThreadRecord   uint32 thread number, string thread id
+   *    kMessageRecord  int64 timestamp (ns since the epoch), int32 level value, uint32 site id,
+   *                    uint32 thread number, int32 line, string expression, string message
+   * Unknown record types are skipped by the reader */
+   namespace binary {
+      static const char kMagic[8] = {'G', '3', 'L', 'O', 'G', 'B', 'I', 'N'};
+      static const uint32_t kVersion = 1;
+      static const uint32_t kByteOrderMark = 0x01020304;
+
+      enum RecordType : uint8_t {
+         kSiteRecord = 'S',
+         kLevelRecord = 'L',
+         kThreadRecord = 'T',
+         kMessageRecord = 'M'
+      };
+   } // binary
+
+
+   /** File sink that writes the raw LogMessage fields as compact binary records, ref: g3::binary
+   * No text formatting is done, the log file is rendered offline by the g3log-decode tool.
+   * FLAGS_logtostderr and FLAGS_alsologtostderr are not used by this sink.
+   *
+   * Usage:
+   * auto handle = worker->addSink(std2::make_unique<g3::BinaryFileSink>(prefix, directory), &g3::BinaryFileSink::receiveBatch);
+   */
+   class BinaryFileSink {
+   public:
+      /// The log file is named as the FileSink's log file, with ".g3bin" instead of ".log"
+      BinaryFileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id = "g3log");
+      virtual ~BinaryFileSink();
+
+      void fileWrite(LogMessageMover message);
+      void receiveBatch(const LogMessageBatch &messages);
+      std::string fileName();
+
+      /// Flushes the written records to the file
+      void flush();
+
+
+   private:
+      std::string _log_file_with_path;
+      std::ofstream _out;
+      std::vector<char> _stream_buffer;
+      std::string _record; // reused encoding buffer
+
+      // what is already described in the file
+      std::vector<bool> _written_sites; // by site id
+      std::vector<int> _written_levels;
+      std::unordered_map<std::thread::id, uint32_t> _threads;
+
+      void write(const LogMessage &message);
+      uint32_t threadNumber(const std::thread::id &thread_id);
+
+      BinaryFileSink &operator=(const BinaryFileSink &) = delete;
+      BinaryFileSink(const BinaryFileSink &other) = delete;
+   };
+
+
+   /** Reads the messages of a binary log file, ref: BinaryFileSink
+   *
+   * Usage:
+   *   g3::BinaryLogReader reader(file_name);
+   *   std::unique_ptr<g3::LogMessage> message;
+   *   std::string thread_id;
+   *   while (reader.next(message, thread_id)) {
+   *      std::cout << message->toString();
+   *   }
+   */
+   class BinaryLogReader {
+   public:
+      explicit BinaryLogReader(const std::string &file_name);
+
+      /// @return false if the file cannot be read, or if it is not a binary log file of this version and byte order
+      bool good() const {
+         return _good;
+      }
+
+      /// Reads the next message. The call sites of the messages are registered as LogSite records
+      /// @return false at the end of the file, or at an incomplete record
+      bool next(std::unique_ptr<LogMessage> &message, std::string &thread_id);
+
+      /// @return true if the file ends with an incomplete record, e.g. after a crash of the writing process,
+      /// or if a record's size is larger than the rest of the file
+      bool truncated() const {
+         return _truncated;
+      }
+
+   private:
+      std::ifstream _in;
+      bool _good;
+      bool _truncated;
+      std::streamoff _file_size;
+      std::string _record;
+      std::unordered_map<uint32_t, const LogSite*> _sites;
+      std::unordered_map<int, std::string> _levels;
+      std::unordered_map<uint32_t, std::string> _threads;
+
+      bool readRecord();
+   };
+} // g3
@@ -53,6 +53,30 @@ namespace g3 {
    ///  g3::overrideSetupSignals({ {SIGABRT, "SIGABRT"}, {SIGFPE, "SIGFPE"},{SIGILL, "SIGILL"},
    //                          {SIGSEGV, "SIGSEGV"},});
    void overrideSetupSignals(const std::map<int, std::string> overrideSignals);
+
+   /// At a fatal signal a minimal crash record is written first: the signal, the PID, the time
+   /// and the raw stack frames. It is made in preallocated buffers, without locks or heap
+   /// allocations, and written with write(2) to stderr and to the file descriptors added here.
+   /// Then follows the usual fatal message through the LogWorker and its sinks, which cannot
+   /// be done safely if the heap or the logger itself is corrupted.
+   /// The FileSink adds the fd of its log file. At most 16 file descriptors
+   /// @return false if there is no room for another file descriptor
+   bool addCrashReportFd(int fd);
+   /// Waits for a signal handler that is writing its crash record to the fd, the fd can be
+   /// closed once this returns
+   void removeCrashReportFd(int fd);
+
+   /// Raw stack dumps: the fatal stack dumps, of the crash record and of the fatal message, are
+   /// made of the raw return addresses and a load map of the process. The load map has the
+   /// address range, the load bias, the GNU build-id and the path of each loaded module (Linux).
+   /// No symbol lookups or demangling are done in the fatal path, the dump is symbolized offline
+   /// with the g3log-symbolize tool. Off by default
+   void setRawStackDump(bool enabled);
+
+   /// The signal handler cannot list the loaded modules, the load map is made beforehand: when the
+   /// crash handler is installed and when raw stack dumps are turned on. Call this after dlopen()
+   /// or dlclose(), a module that is missing from the load map is not symbolized
+   void refreshLoadMap();
 #endif
 
 
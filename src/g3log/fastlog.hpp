@@ -0,0 +1,145 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================
+*
+* Deferred formatting for LOG_FAST(level, "format {}", args...)
+*
+* The calling thread only copies the raw argument values, in a compact binary encoding,
+* together with a pointer to the (static) format string. The formatting into text is done
+* later on the LogWorker's background thread. Ref: LogMessage::formatFastMessage() */
+
+#pragma once
+
+#include "g3log/loglevels.hpp"
+#include "g3log/logsite.hpp"
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace g3 {
+   namespace internal {
+      namespace fast {
+         enum Tag : char {
+            kSigned = 'i',
+            kUnsigned = 'u',
+            kDouble = 'd',
+            kChar = 'c',
+            kBool = 'b',
+            kString = 's',
+            kPointer = 'p'
+         };
+
+         template<typename T>
+         void append(std::string& encoded, Tag tag, const T& value) {
+            encoded.push_back(tag);
+            encoded.append(reinterpret_cast<const char*>(&value), sizeof(T));
+         }
+
+         inline void appendString(std::string& encoded, const char* text, size_t length) {
+            const uint32_t size = static_cast<uint32_t>(length);
+            append(encoded, kString, size);
+            encoded.append(text, length);
+         }
+
+         inline void encode(std::string& encoded, bool value) {
+            encoded.push_back(kBool);
+            encoded.push_back(value ? 1 : 0);
+         }
+
+         inline void encode(std::string& encoded, char value) {
+            encoded.push_back(kChar);
+            encoded.push_back(value);
+         }
+
+         // int8_t and uint8_t are characters to operator<<, as with the stream LOG
+         inline void encode(std::string& encoded, signed char value) {
+            encode(encoded, static_cast<char>(value));
+         }
+
+         inline void encode(std::string& encoded, unsigned char value) {
+            encode(encoded, static_cast<char>(value));
+         }
+
+         inline void encode(std::string& encoded, const char* value) {
+            if (nullptr == value) {
+               value = "(null)";
+            }
+            appendString(encoded, value, std::strlen(value));
+         }
+
+         inline void encode(std::string& encoded, char* value) {
+            encode(encoded, static_cast<const char*>(value));
+         }
+
+         inline void encode(std::string& encoded, const std::string& value) {
+            appendString(encoded, value.data(), value.size());
+         }
+
+         template<typename T>
+         void encode(std::string& encoded, T* value) {
+            append(encoded, kPointer, reinterpret_cast<uintptr_t>(value));
+         }
+
+         template<typename T>
+         typename std::enable_if < std::is_integral<T>::value &&std::is_signed<T>::value >::type
+         encode(std::string& encoded, T value) {
+            append(encoded, kSigned, static_cast<int64_t>(value));
+         }
+
+         template<typename T>
+         typename std::enable_if < std::is_integral<T>::value && !std::is_signed<T>::value >::type
+         encode(std::string& encoded, T value) {
+            append(encoded, kUnsigned, static_cast<uint64_t>(value));
+         }
+
+         template<typename T>
+         typename std::enable_if<std::is_floating_point<T>::value>::type
+         encode(std::string& encoded, T value) {
+            append(encoded, kDouble, static_cast<double>(value));
+         }
+
+         template<typename T>
+         typename std::enable_if<std::is_enum<T>::value>::type
+         encode(std::string& encoded, T value) {
+            append(encoded, kSigned, static_cast<int64_t>(value));
+         }
+
+         inline void encodeAll(std::string&) {}
+
+         template<typename First, typename... Rest>
+         void encodeAll(std::string& encoded, const First& first, const Rest&... rest) {
+            encode(encoded, first);
+            encodeAll(encoded, rest...);
+         }
+
+         /// @return the calling thread's encoding buffer, reused between LOG_FAST calls
+         std::string& threadBuffer();
+
+         /// frees the encoding buffer after an unusually large message, instead of keeping it
+         void releaseLargeBuffer(std::string& encoded);
+
+         /// formats the encoded arguments into the "{}" placeholders of the format string.
+         /// "{{" and "}}" are written as "{" and "}". Arguments without a placeholder are appended
+         std::string format(const char* format, const std::string& encoded);
+      } // fast
+
+      /// Saves the encoded LOG_FAST message. Fatal levels are formatted immediately
+      void saveFastMessage(const LogSite* site, const LEVELS& level, const char* format, const std::string& encoded);
+
+      /// LOG_FAST capture. Supports fundamental types, enums, strings and pointers
+      template<typename... Args>
+      void captureFast(const LogSite* site, const LEVELS& level, const char* format, const Args&... args) {
+         std::string& encoded = fast::threadBuffer();
+         encoded.clear();
+         fast::encodeAll(encoded, args...);
+         saveFastMessage(site, level, format, encoded);
+         fast::releaseLargeBuffer(encoded);
+      }
+   } // internal
+} // g3
@@ -9,25 +9,98 @@
 
 #include <string>
 #include <memory>
+#include <chrono>
+#include <deque>
+#include <utility>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
 
 #include "g3log/logmessage.hpp"
+#include "g3log/loglayout.hpp"
+#include "g3log/active.hpp"
 namespace g3 {
 
+   /// When the FileSink writes its buffered log entries to the file. The buffer is written and
+   /// flushed as soon as one of the conditions is met. A FATAL entry is always flushed right away.
+   ///
+   /// The default policy flushes every entry, as it comes in
+   struct FlushPolicy {
+      size_t max_buffered_bytes = 0;             ///< flush when the buffered entries reach this size
+      std::chrono::milliseconds max_latency {0}; ///< max time an entry waits in the buffer. 0: no timer
+      LEVELS flush_level = G3LOG_ERROR;          ///< entries at this level, or above, are flushed right away
+   };
+
+
+   /// Rotation of the FileSink's log file, done on the sink's own thread. The rotated files
+   /// are kept as they are, only the oldest ones are removed by the retention limits.
+   /// The retention counts the log files with the sink's prefix and logger id in its directory,
+   /// also those of earlier runs. The directory is scanned at the start and at changeLogFile()
+   struct RotationPolicy {
+      size_t max_file_bytes = 0;           ///< rotate when the log file reaches this size. 0: no size limit
+      std::chrono::seconds interval {0};   ///< rotate at each whole interval of local time, e.g. std::chrono::hours(24) at midnight. 0: never
+      size_t max_files = 0;                ///< keep at most this many log files, the current one included. 0: keep all
+      size_t max_total_bytes = 0;          ///< keep at most this many bytes of log files, their sizes on disk. 0: no limit
+      bool compress = false;               ///< gzip the rotated files on a low priority thread. Needs zlib, ref: G3_HAS_ZLIB
+   };
+
+
    class FileSink {
    public:
-      FileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id="g3log");
+      /// @param layout the look of the log lines, e.g. g3::LogLayout("%T %L [%F->%N:%#] %m")
+      FileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id="g3log",
+               const FlushPolicy &flush_policy = FlushPolicy(), const LogLayout &layout = LogLayout::defaultLayout(),
+               const RotationPolicy &rotation_policy = RotationPolicy());
       virtual ~FileSink();
 
       void fileWrite(LogMessageMover message);
       std::string changeLogFile(const std::string &directory, const std::string &logger_id);
       std::string fileName();
 
+      /// Changes the flush policy. Whatever is buffered is written first
+      void setFlushPolicy(const FlushPolicy &flush_policy);
+      /// Writes and flushes the buffered log entries
+      void flush();
+      /// Changes the rotation policy. The retention limits are applied at once
+      void setRotationPolicy(const RotationPolicy &rotation_policy);
+
 
    private:
       std::string _log_file_with_path;
       std::string _log_prefix_backup; // needed in case of future log file changes of directory
       std::unique_ptr<std::ofstream> _outptr;
+      const LogLayout _layout;
+      std::string _log_directory;
+      std::string _logger_id;
+
+      // Rotation. The per entry cost is the size counter and the timestamp comparison
+      RotationPolicy _rotation_policy;
+      size_t _file_bytes;
+      size_t _rotate_at_bytes;
+      g3::high_resolution_time_point _next_rotation;
+      std::string _rotation_stem; // the current file name without ".log", and its next sequence number
+      size_t _rotation_sequence;
+      std::deque<std::pair<std::string, size_t>> _rotated_files; // oldest first, with their sizes on disk
+      std::unique_ptr<kjellkod::Active> _compressor; // started at the first rotation with compression
+      int _crash_report_fd; // the log file gets the minimal crash record, ref: g3::addCrashReportFd. POSIX only
+
+      // The buffer is shared with the max latency timer thread, it is protected by _buffer_mutex
+      FlushPolicy _flush_policy;
+      std::string _buffer;
+      std::chrono::steady_clock::time_point _buffered_since;
+      std::mutex _buffer_mutex;
+      std::condition_variable _timer_wake;
+      bool _stop_timer;
+      std::thread _flush_timer;
 
+      void writeBuffer();
+      void rotate();
+      void scheduleRotation();
+      void applyRetention();
+      void useCrashReportFd();
+      void startFlushTimer();
+      void stopFlushTimer();
+      void runFlushTimer();
       void addLogFileHeader();
       std::ofstream &filestream() {
          return *(_outptr.get());
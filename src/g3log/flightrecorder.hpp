@@ -0,0 +1,122 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "g3log/logmessage.hpp"
+
+namespace g3 {
+
+   /** The flight recorder keeps the most recent log messages in a file backed ring buffer,
+   * mapped with MAP_SHARED. The messages are copied into the ring by the logging thread, at the
+   * LOG call, before they are queued for the sinks. The written pages belong to the kernel's
+   * page cache, so the ring survives a SIGKILL or an OOM kill of the process (but not a crash
+   * of the machine). POSIX only. Ref: LogWorkerOptions::flight_recorder_file
+   *
+   * File layout, in the byte order of the writing machine:
+   *    header page   magic "G3LOGFR1", uint32 version, uint32 byte order mark, uint64 ring bytes,
+   *                  uint64 bytes written since the start
+   *    ring          records at 8 byte aligned positions. The position of a record counts all
+   *                  bytes written since the start, the record is at (position % ring bytes)
+   *
+   * Record: uint64 position, uint32 size of the fields, uint32 checksum of the fields, the fields
+   *    int64 timestamp (ns since the epoch), int32 level value, int32 line, followed by the strings
+   *    level, file path, function, thread id, expression, LOG_FAST format and message, each as
+   *    uint32 size + the characters
+   *
+   * The logging threads reserve their positions with an atomic add, without locks. The position
+   * is written last, it marks the record as complete. A record that was interrupted by the kill
+   * is not recovered. A record is at most a quarter of the ring: a huge message, and then the
+   * expression, is cut. A record with still larger fields is not recorded.
+   *
+   * The position is also the record's generation: position / ring bytes is the number of laps
+   * of the ring. A writer that was preempted while the others went a full lap around the ring
+   * is lapped, its bytes now belong to a newer record. It checks for this before and after its
+   * copy, and drops its record without marking it complete. The newer record it may have
+   * overwritten meanwhile fails the checksum, the recovery skips it */
+   namespace flight {
+      static const char kMagic[8] = {'G', '3', 'L', 'O', 'G', 'F', 'R', '1'};
+      static const uint32_t kVersion = 2;
+      static const uint32_t kByteOrderMark = 0x01020304;
+      static const size_t kHeaderBytes = 4096;
+      static const size_t kRecordHeaderBytes = 16;
+   } // flight
+
+
+   namespace internal {
+      /// The writing side of the flight recorder. Thread safe
+      class FlightRecorder {
+      public:
+         /// A file from an earlier run is kept as "<file_name>.previous"
+         FlightRecorder(const std::string &file_name, size_t ring_bytes);
+         ~FlightRecorder();
+
+         bool isOpen() const {
+            return nullptr != _ring;
+         }
+
+         /// copies the message into the ring, wait free
+         void record(const LogMessage &message);
+
+      private:
+         int _fd;
+         char *_mapping;
+         size_t _mapping_bytes;
+         char *_ring;
+         uint64_t _ring_bytes;
+
+         void copy(uint64_t position, const char *data, size_t size);
+
+         FlightRecorder &operator=(const FlightRecorder &) = delete;
+         FlightRecorder(const FlightRecorder &other) = delete;
+      };
+   } // internal
+
+
+   /** Recovers the messages of a flight recorder file, oldest first
+   *
+   * Usage:
+   *   g3::FlightRecorderReader reader(file_name);
+   *   std::unique_ptr<g3::LogMessage> message;
+   *   std::string thread_id;
+   *   while (reader.next(message, thread_id)) {
+   *      std::cout << message->toString();
+   *   }
+   */
+   class FlightRecorderReader {
+   public:
+      explicit FlightRecorderReader(const std::string &file_name);
+
+      /// @return false if the file cannot be read, or if it is not a flight recorder file of this version and byte order
+      bool good() const {
+         return _good;
+      }
+
+      /// @return false when there are no more complete records
+      bool next(std::unique_ptr<LogMessage> &message, std::string &thread_id);
+
+      /// @return the number of skipped records: incomplete, or damaged by a lapped writer
+      size_t skipped() const {
+         return _skipped;
+      }
+
+   private:
+      std::string _ring;
+      uint64_t _written;
+      uint64_t _position;
+      uint64_t _start;
+      bool _good;
+      size_t _skipped;
+
+      void read(uint64_t position, char *data, size_t size) const;
+   };
+} // g3
@@ -24,6 +24,8 @@
 #include "g3log/loglevels.hpp"
 #include "g3log/logcapture.hpp"
 #include "g3log/logmessage.hpp"
+#include "g3log/fastlog.hpp"
+#include "g3log/vlog.hpp"
 #include "g3log/generated_definitions.hpp"
 #include <gflags/gflags.h>
 #ifdef HAVE_UNISTD_H
@@ -109,6 +111,8 @@ namespace g3 {
       // Save the created LogMessage to any existing sinks
       void saveMessage(const char *message, const char *file, int line, const char *function, const LEVELS &level,
                        const char *boolean_expression, int fatal_signal, const char *stack_trace);
+      void saveMessage(const char *message, const LogSite *site, const LEVELS &level,
+                       const char *boolean_expression, int fatal_signal, const char *stack_trace);
 
       // forwards the message to all sinks
       void pushMessageToLogger(LogMessagePtr log_entry);
@@ -141,10 +145,10 @@ namespace g3 {
    } // internal
 } // g3
 
-#define INTERNAL_LOG_MESSAGE(level) LogCapture(__FILE__, __LINE__, static_cast<const char*>(__PRETTY_FUNCTION__), LEVELS(level))
+#define INTERNAL_LOG_MESSAGE(level) LogCapture(G3LOG_SITE(), LEVELS(level))
 
 #define INTERNAL_CONTRACT_MESSAGE(boolean_expression)  \
-   LogCapture(__FILE__, __LINE__, __PRETTY_FUNCTION__, g3::internal::CONTRACT, boolean_expression)
+   LogCapture(G3LOG_SITE(), g3::internal::CONTRACT, boolean_expression)
 
 
 // LOG(level) is the API for the stream log
@@ -175,6 +179,10 @@ namespace g3 {
    if(true == (boolean_expression))  \
       if(g3::logLevel(level))  INTERNAL_LOG_MESSAGE(level).stream()
 
+// Verbose stream log, logged at the INFO level if verboselevel <= FLAGS_v. Ref: VLOG_IS_ON and g3::setVLogLevel
+#define VLOG(verboselevel) \
+   if(!(VLOG_IS_ON(verboselevel) && g3::logLevel(G3LOG_INFO))){ } else INTERNAL_LOG_MESSAGE(G3LOG_INFO).stream()
+
 //LOG for every n message with conditions
 #define SOME_KIND_OF_LOG_IF_EVERY_N(level, boolean_expression, n)    \
   static int LOG_OCCURRENCES = 0, LOG_OCCURRENCES_MOD_N = 0; \
@@ -256,6 +264,19 @@ And here is possible output
    if(true == (boolean_expression))                                     \
       if(g3::logLevel(level))  INTERNAL_LOG_MESSAGE(level).capturef(printf_like_message, ##__VA_ARGS__)
 
+/** LOG_FAST(level, format, args...) is for latency critical code. The calling thread only copies
+* the raw argument values. The formatting to text is done on the background thread.
+*
+* Each "{}" in the format string is replaced by the next argument, "{{" and "}}" give "{" and "}".
+* The arguments are formatted as with the stream LOG. Supported are fundamental types, enums,
+* C strings, std::string and pointers. The format string must be a string literal or
+* otherwise outlive the logger.
+*
+* EXAMPLE:
+*   LOG_FAST(INFO, "order {} filled {} @ {}", order_id, quantity, price);  */
+#define LOG_FAST(level, format, ...) \
+   if(!g3::logLevel(level)){ } else g3::internal::captureFast(G3LOG_SITE(), level, format, ##__VA_ARGS__)
+
 // Design By Contract, printf-like API syntax with variadic input parameters.
 // Throws std::runtime_eror if contract breaks
 #define CHECKF(boolean_expression, printf_like_message, ...)    \
@@ -719,9 +740,7 @@ DECLARE_bool(logtostderr);
 DECLARE_bool(alsologtostderr);
 DECLARE_int32(minloglevel);
 DECLARE_string(log_dir);
-// To do 
-// flags stderrthreshold,log_link,v... 
-DECLARE_int32(stderrthreshold);
-DECLARE_int32(v);
+DECLARE_int32(stderrthreshold); // messages at or above this level are also written to stderr by the LogWorker. Off by default
+DECLARE_int32(v);               // the verbosity for VLOG(n), ref: g3::setVLogLevel
+DECLARE_string(vmodule);        // the verbosity per source file, ref: g3::setVModule
 DECLARE_string(log_link);
-// To do
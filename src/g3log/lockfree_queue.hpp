@@ -0,0 +1,122 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================
+*
+* Multiple producer, single consumer queue. Producers never take a lock, they
+* only do one atomic exchange on the queue head per push. The consumer side is
+* only ever touched by one thread at a time, i.e. the kjellkod::Active thread.
+*
+* The node based design is Dmitry Vyukov's non-intrusive MPSC queue
+* Ref: http://www.1024cores.net/home/lock-free-algorithms/queues/non-intrusive-mpsc-node-based-queue
+*
+* Consumer wakeups are batched. The consumer only sleeps on the condition variable
+* after it has found the queue empty. Producers only pay for the mutex + notify_one
+* if the consumer is actually asleep, i.e. during a burst of LOG calls the producers
+* will not make any syscall at all. */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/** Multiple producer, single consumer lock-free queue with the same API as shared_queue
+* push(...) is safe from any thread. try_and_pop, wait_and_pop and empty must only be
+* called from the single consumer thread. */
+template<typename T>
+class lockfree_queue
+{
+   struct Node {
+      Node() : next(nullptr) {}
+      explicit Node(T &&item) : next(nullptr), value(std::move(item)) {}
+      std::atomic<Node *> next;
+      T value;
+   };
+
+   std::atomic<Node *> head_; // producers side, the latest pushed node
+   Node *tail_;               // consumer side, the stub or last popped node
+   std::atomic<unsigned> size_;
+
+   std::atomic<bool> sleeping_;
+   std::mutex m_;
+   std::condition_variable data_cond_;
+
+   lockfree_queue &operator=(const lockfree_queue &) = delete;
+   lockfree_queue(const lockfree_queue &other) = delete;
+
+   // spin a little before going to sleep, most of the time the next item is
+   // just around the corner when the logger is under pressure
+   static const int kSpinsBeforeSleep = 64;
+
+   bool pop(T &popped_item) {
+      Node *tail = tail_;
+      Node *next = tail->next.load(std::memory_order_acquire);
+      if (nullptr == next) {
+         return false;
+      }
+      popped_item = std::move(next->value);
+      tail_ = next;
+      size_.fetch_sub(1, std::memory_order_relaxed);
+      delete tail;
+      return true;
+   }
+
+public:
+   lockfree_queue() : head_(new Node), tail_(head_.load()), size_(0), sleeping_(false) {}
+
+   ~lockfree_queue() {
+      T ignored;
+      while (pop(ignored)) {}
+      delete tail_;
+   }
+
+   void push(T item) {
+      Node *node = new Node(std::move(item));
+      size_.fetch_add(1, std::memory_order_relaxed);
+      Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+      prev->next.store(node, std::memory_order_seq_cst);
+
+      // Only wake up the consumer if it went to sleep. Under the mutex to
+      // avoid the lost wakeup between the consumer's last check and its wait
+      if (sleeping_.load(std::memory_order_seq_cst)) {
+         std::lock_guard<std::mutex> lock(m_);
+         data_cond_.notify_one();
+      }
+   }
+
+   /// \return immediately, with true if successful retrieval
+   bool try_and_pop(T &popped_item) {
+      return pop(popped_item);
+   }
+
+   /// Try to retrieve, if no items, wait till an item is available and try again
+   void wait_and_pop(T &popped_item) {
+      for (int spin = 0; spin < kSpinsBeforeSleep; ++spin) {
+         if (pop(popped_item)) {
+            return;
+         }
+         std::this_thread::yield();
+      }
+
+      std::unique_lock<std::mutex> lock(m_);
+      sleeping_.store(true, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!pop(popped_item)) {
+         data_cond_.wait(lock);
+      }
+      sleeping_.store(false, std::memory_order_relaxed);
+   }
+
+   bool empty() const {
+      return nullptr == tail_->next.load(std::memory_order_acquire);
+   }
+
+   unsigned size() const {
+      return size_.load(std::memory_order_relaxed);
+   }
+};
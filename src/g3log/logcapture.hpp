@@ -10,9 +10,12 @@
 
 #include "g3log/loglevels.hpp"
 #include "g3log/crashhandler.hpp"
+#include "g3log/logsite.hpp"
 
 #include <string>
 #include <sstream>
+#include <ostream>
+#include <streambuf>
 #include <cstdarg>
 #include <csignal>
 #ifdef _MSC_VER
@@ -29,6 +32,44 @@ namespace g3Internal {
     struct CheckOpString;
 }
 
+namespace g3 {
+   namespace internal {
+      /** Stream buffer for the LOG capture. It writes into a thread-local buffer that is reused
+      * from one LOG call to the next. Once the buffer has grown to fit the thread's messages
+      * the capture is done without any heap allocation.
+      *
+      * A nested LOG call, i.e. a LOG call made while streaming into another LOG call on the
+      * same thread, uses its own buffer since the thread-local one is already taken */
+      class CaptureStreamBuf : public std::streambuf {
+       public:
+         CaptureStreamBuf();
+         virtual ~CaptureStreamBuf();
+
+         /// @return the captured, null terminated, message. Valid until the next write
+         const char* c_str();
+
+         /// @return bytes the buffer holds before it has to grow
+         size_t capacity() const {
+            return _buffer->size();
+         }
+
+       protected:
+         int_type overflow(int_type ch) override;
+         std::streamsize xsputn(const char* text, std::streamsize count) override;
+
+       private:
+         void grow(size_t min_size);
+
+         std::string* _buffer;   // the thread-local buffer, or _own for a nested LOG call
+         std::string _own;
+         bool _uses_thread_buffer;
+
+         CaptureStreamBuf(const CaptureStreamBuf&) = delete;
+         CaptureStreamBuf& operator=(const CaptureStreamBuf&) = delete;
+      };
+   } // internal
+} // g3
+
 struct LogCapture {
    /// Called from crash handler when a fatal signal has occurred (SIGSEGV etc)
    LogCapture(const LEVELS &level, g3::SignalType fatal_signal, const char *dump = nullptr);
@@ -42,6 +83,9 @@ struct LogCapture {
     */
    LogCapture(const char *file, const int line, const char *function, const LEVELS &level, const char *expression = "", g3::SignalType fatal_signal = SIGABRT, const char *dump = nullptr);
 
+   /// @site is the static call site record given in g3log.hpp from macros. Ref: G3LOG_SITE()
+   LogCapture(const g3::LogSite *site, const LEVELS &level, const char *expression = "", g3::SignalType fatal_signal = SIGABRT, const char *dump = nullptr);
+
    
    /// Called when Check Failed
    LogCapture(const char *file, const int line, const char *function, const g3Internal::CheckOpString result, const LEVELS &level = G3LOG_FATAL, const char *expression = "", g3::SignalType fatal_signal = SIGABRT, const char *dump = nullptr);
@@ -74,13 +118,14 @@ struct LogCapture {
 
 
    /// prettifying API for this completely open struct
-   std::ostringstream &stream() {
+   std::ostream &stream() {
       return _stream;
    }
 
 
 
-   std::ostringstream _stream;
+   g3::internal::CaptureStreamBuf _buffer; // do not change declaration order. _buffer is used by _stream
+   std::ostream _stream;
    std::string _stack_trace;
    const char *_file;
    const int _line;
@@ -88,6 +133,7 @@ struct LogCapture {
    const LEVELS &_level;
    const char *_expression;
    const g3::SignalType _fatal_signal;
+   const g3::LogSite *_site; // nullptr if created with file, line and function
 
 };
 //} // g3
@@ -0,0 +1,69 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#pragma once
+
+#include "g3log/time.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace g3 {
+   struct LogMessage;
+
+   /** The look of a log line, given by a layout pattern. The pattern is compiled once, at
+   * construction, into a list of fields. Each line is then written straight into the
+   * caller's output buffer, without temporary strings.
+   *
+   * Fields:
+   *    %T        timestamp, "%Y/%m/%d %H:%M:%S %f6"
+   *    %T{...}   timestamp with the given time format, ref: g3::localtime_formatted
+   *    %L        level
+   *    %F        file
+   *    %P        full file path
+   *    %N        function
+   *    %#        line
+   *    %t        thread id
+   *    %m        message
+   *    %%        a '%'
+   * Any other text is written as is. Every line ends with a newline.
+   *
+   * Fatal messages keep their detailed look, ref: LogMessage::toString()
+   *
+   * Example: g3::LogLayout layout("%T %L [%F->%N:%#] %m");
+   */
+   class LogLayout {
+    public:
+      explicit LogLayout(const std::string& pattern);
+
+      /// The layout of LogMessage::toString(), "%T\t%L [%F->%N:%#]\t%m"
+      static const LogLayout& defaultLayout();
+
+      /// appends the formatted line to the output buffer
+      void format(const LogMessage& message, std::string& out) const;
+      std::string toString(const LogMessage& message) const;
+
+      const std::string& pattern() const {
+         return _pattern;
+      }
+
+    private:
+      enum class FieldType {Text, Timestamp, Level, File, FilePath, Function, Line, ThreadId, Message};
+      struct Field {
+         FieldType type;
+         std::string text; // only for FieldType::Text
+         std::shared_ptr<const internal::TimeFormatter> time_format; // only for FieldType::Timestamp
+      };
+
+      void addText(const std::string& text);
+
+      std::string _pattern;
+      std::vector<Field> _fields;
+   };
+} // g3
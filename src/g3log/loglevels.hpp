@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <map>
 #include <atomic>
+#include <cstdint>
 #include <g3log/atomicbool.hpp>
 
 // Levels for logging, made so that it would be easy to change, remove, add levels -- KjellKod
@@ -141,7 +142,18 @@ namespace g3 {
    }
 
 #ifdef G3_DYNAMIC_LOGGING
-   // Only safe if done at initialization in a single-thread context
+   namespace internal {
+      /// The enabled status of level values 0 ... kLevelBits-1 is kept in an atomic bitmask, the
+      /// LOG level check is a single relaxed load. Other level values are looked up under a lock
+      const int kLevelBits = 128;
+      const int kLevelWords = kLevelBits / 64;
+      extern std::atomic<uint64_t> g_enabled_levels[kLevelWords];
+      bool outOfRangeLogLevel(int value);
+   } // internal
+
+
+   // The level changes below, in only_change_at_initialization and log_levels, are safe to call
+   // from any thread at any time. LOG calls in other threads see a change shortly after, not necessarily at once
    namespace only_change_at_initialization {
 
       /// add a custom level - enabled or disabled
@@ -189,7 +201,19 @@ namespace g3 {
 
 #endif
    /// Enabled status for the given logging level
-   bool logLevel(LEVELS level);
+   inline bool logLevel(const LEVELS& level) {
+#ifdef G3_DYNAMIC_LOGGING
+      const int value = level.value;
+      if (value >= 0 && value < internal::kLevelBits) {
+         const uint64_t word = internal::g_enabled_levels[value / 64].load(std::memory_order_relaxed);
+         return 0 != ((word >> (value % 64)) & 1u);
+      }
+      return internal::outOfRangeLogLevel(value);
+#else
+      (void)level;
+      return true;
+#endif
+   }
 
 } // g3
 
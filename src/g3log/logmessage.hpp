@@ -14,11 +14,13 @@
 #include "g3log/time.hpp"
 #include "g3log/moveoncopy.hpp"
 #include "g3log/crashhandler.hpp"
+#include "g3log/logsite.hpp"
 
 #include <string>
 #include <sstream>
 #include <thread>
 #include <memory>
+#include <vector>
 
 namespace g3 {
 
@@ -32,29 +34,31 @@ namespace g3 {
    */
    struct LogMessage {
       std::string file_path() const {
-         return _file_path;
+         return _site->file_path;
       }
       std::string file() const {
-         return _file;
+         return _site->file;
       }
       std::string line() const {
          return std::to_string(_line);
       }
       std::string function() const {
-         return _function;
+         return _site->function;
       }
       std::string level() const {
          return _level.text;
       }
 
+      /// default look is Y/M/D H:M:S microseconds
+      std::string timestamp() const;
       /// use a different format string to get a different look on the time.
-      //  default look is Y/M/D H:M:S
-      std::string timestamp(const std::string& time_format = {internal::date_formatted + " " + internal::time_formatted}) const;
+      std::string timestamp(const std::string& time_format) const;
 
       std::string message() const  {
          return _message;
       }
-      std::string& write() const {
+      /// Only for the capture side. A LogMessage is read-only once it is sent to the sinks
+      std::string& write() {
          return _message;
       }
 
@@ -77,6 +81,7 @@ namespace g3 {
 
 
       LogMessage(const std::string& file, const int line, const std::string& function, const LEVELS& level);
+      LogMessage(const LogSite* site, const LEVELS& level);
 
       explicit LogMessage(const std::string& fatalOsSignalCrashMessage);
       LogMessage(const LogMessage& other);
@@ -89,13 +94,18 @@ namespace g3 {
       //
       g3::high_resolution_time_point _timestamp;
       std::thread::id _call_thread_id;
-      std::string _file;
-      std::string _file_path;
+      const LogSite* _site; // file, line and function of the LOG call. Never nullptr
       int _line;
-      std::string _function;
       LEVELS _level;
       std::string _expression; // only with content for CHECK(...) calls
-      mutable std::string _message;
+      std::string _message;
+
+      // Only for LOG_FAST: the format string while _message still holds the raw, encoded, arguments.
+      // nullptr once the message is formatted. Ref: fastlog.hpp
+      const char* _fast_format;
+
+      /// internal: formats a LOG_FAST message. Called on the background thread
+      void formatFastMessage();
 
 
 
@@ -103,12 +113,12 @@ namespace g3 {
          using std::swap;
          swap(first._timestamp, second._timestamp);
          swap(first._call_thread_id, second._call_thread_id);
-         swap(first._file, second._file);
+         swap(first._site, second._site);
          swap(first._line, second._line);
-         swap(first._function, second._function);
          swap(first._level, second._level);
          swap(first._expression, second._expression);
          swap(first._message, second._message);
+         swap(first._fast_format, second._fast_format);
       }
 
    };
@@ -132,5 +142,39 @@ namespace g3 {
 
    typedef MoveOnCopy<std::unique_ptr<FatalMessage>> FatalMessagePtr;
    typedef MoveOnCopy<std::unique_ptr<LogMessage>> LogMessagePtr;
-   typedef MoveOnCopy<LogMessage> LogMessageMover;
+
+
+   /** The message as received by the sinks. The LogWorker shares one read-only LogMessage,
+   * reference counted, between all its sinks. No sink gets its own copy of the message.
+   *
+   * The API is the same as when this was a MoveOnCopy<LogMessage>, except that get() is read-only.
+   * A sink that wants to modify the message can use release() to get its own copy */
+   class LogMessageMover {
+    public:
+      explicit LogMessageMover(LogMessage&& message)
+         : _message(std::make_shared<const LogMessage>(std::move(message))) {}
+      explicit LogMessageMover(std::shared_ptr<const LogMessage> message)
+         : _message(std::move(message)) {}
+
+      const LogMessage& get() const {
+         return *_message;
+      }
+
+      /// @return a copy of the shared message
+      LogMessage release() const {
+         return *_message;
+      }
+
+      std::shared_ptr<const LogMessage> share() const {
+         return _message;
+      }
+
+    private:
+      std::shared_ptr<const LogMessage> _message;
+   };
+
+
+   /// Messages delivered, in order, in one call to a batch receiving sink.
+   /// Ref: LogWorker::addSink with a call such as: void MySink::receiveBatch(const g3::LogMessageBatch& messages)
+   typedef std::vector<LogMessageMover> LogMessageBatch;
 } // g3
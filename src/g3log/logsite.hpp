@@ -0,0 +1,61 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace g3 {
+
+   /** Static description of a LOG call site. Each LOG(...) call site gets its record
+   * once, at its first call. A LogMessage only carries a pointer to the record.
+   *
+   * The records are owned by g3log and are never deleted. This keeps them valid also for
+   * LOG calls from a dynamically loaded library that is unloaded before its messages are
+   * written to the sinks */
+   struct LogSite {
+      const char* file_path; ///< as given by __FILE__
+      const char* file;      ///< basename of file_path (or the full path with G3_LOG_FULL_FILENAME)
+      const char* function;
+      int line;
+      uint32_t id;           ///< unique per call site, in order of registration
+   };
+
+
+   namespace internal {
+      /// @return offset of the basename in the path, i.e. the character after the last '/', '\' or '('
+      /// Evaluated at compile time for the LOG call sites
+      constexpr size_t basenameOffset(const char* path, size_t index = 0, size_t offset = 0) {
+         return ('\0' == path[index]) ? offset
+                : ('/' == path[index] || '\\' == path[index] || '(' == path[index]) ? basenameOffset(path, index + 1, index + 1)
+                : basenameOffset(path, index + 1, offset);
+      }
+
+      /// @return the record for the call site. Registered at the first call, the same
+      /// file, line and function always gives the same record. Thread safe.
+      /// A thread finds its recently used sites without taking the registry's lock. The registry
+      /// is bounded, past 64K distinct sites the new ones share a single "too many" record
+      const LogSite* registerSite(const char* file_path, size_t basename_offset, int line, const char* function);
+      const LogSite* registerSite(const char* file_path, int line, const char* function);
+
+      /// Call site of the messages from the signal and exception handlers, which have no LOG call.
+      /// A constant, using it takes no lock. The id 0 is never given to a registered site
+      extern const LogSite kSignalSite;
+   } // internal
+} // g3
+
+
+/// @return const g3::LogSite* for the calling site. The record lookup is only done at the
+/// first call, after that it is a read of a function local static
+#define G3LOG_SITE() \
+   ([](const char* g3_site_function) -> const g3::LogSite* { \
+      static const g3::LogSite* const g3_site = g3::internal::registerSite(__FILE__, \
+            std::integral_constant<size_t, g3::internal::basenameOffset(__FILE__)>::value, __LINE__, g3_site_function); \
+      return g3_site; })(static_cast<const char*>(__PRETTY_FUNCTION__))
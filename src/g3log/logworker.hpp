@@ -16,11 +16,18 @@
 #include "g3log/sinkhandle.hpp"
 #include "g3log/filesink.hpp"
 #include "g3log/logmessage.hpp"
+#include "g3log/threadrings.hpp"
+#include "g3log/flightrecorder.hpp"
+#include "g3log/telemetry.hpp"
 #include "g3log/std2_make_unique.hpp"
 
 #include <memory>
 #include <string>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 
 namespace g3 {
@@ -28,17 +35,96 @@ namespace g3 {
    struct LogWorkerImpl;
    using FileSinkHandle = g3::SinkHandle<g3::FileSink>;
 
+   /// What to do with a new message when the bounded message queue is full.
+   /// Ref: LogWorkerOptions::max_queue_size
+   enum class OverflowPolicy {
+      Block,         ///< the logging thread waits until there is room in the queue
+      DropNewest,    ///< the new message is dropped
+      DropOldest,    ///< the oldest queued message is dropped to make room for the new message
+      DropBelowLevel ///< messages below LogWorkerOptions::drop_below_level are dropped, the others wait for room
+   };
+
+   /// Construction options for the LogWorker. The default constructed options
+   /// give the same LogWorker as @ref LogWorker::createLogWorker()
+   struct LogWorkerOptions {
+      /// true: each logging thread writes to its own wait-free ring. A merging thread
+      /// forwards the messages, in timestamp order, to the background worker.
+      /// This avoids contention between logging threads on the shared message queue
+      bool per_thread_rings = false;
+
+      /// messages per thread ring (rounded up to a power of two). A thread that fills
+      /// its ring is blocked until the merging thread has caught up
+      size_t ring_capacity = 4096;
+
+      /// 0: the message queue is unbounded (default). Otherwise the maximum number of messages
+      /// waiting for the background worker. Dropped messages are counted and a
+      /// "N messages dropped" WARNING is sent to the sinks once the queue has been drained.
+      /// The sinks are bounded as well: while they are max_queue_size messages behind, the
+      /// background worker waits for them and the queue fills up. At most about 2 * max_queue_size
+      /// messages are in flight: in the queue, and taken by the background worker or waiting for the sinks
+      size_t max_queue_size = 0;
+      OverflowPolicy overflow_policy = OverflowPolicy::Block;
+      LEVELS drop_below_level = G3LOG_WARNING; ///< only used with OverflowPolicy::DropBelowLevel
+
+      /// not empty: each message is also copied, by the logging thread at the LOG call, into this file
+      /// backed ring buffer (POSIX only). The most recent messages survive a SIGKILL or an OOM kill,
+      /// they are recovered with the g3log-recover tool. Ref: flightrecorder.hpp
+      std::string flight_recorder_file;
+      size_t flight_recorder_bytes = 4 * 1024 * 1024; ///< size of the ring buffer
+
+      /// not set: each sink gets its own background thread (default). Otherwise the sinks added
+      /// later run on this shared thread pool, in FIFO order per sink. Ref: sinkexecutor.hpp
+      std::shared_ptr<SinkExecutor> sink_executor;
+
+      /// true: the LogWorker keeps the counters and latencies of LogWorker::stats(). A LOG call then
+      /// adds to a counter of its own thread, the sinks measure their calls on their own threads
+      bool telemetry = false;
+   };
+
    /// Background side of the LogWorker. Internal use only
    struct LogWorkerImpl final {
       typedef std::shared_ptr<g3::internal::SinkWrapper> SinkWrapperPtr;
       std::vector<SinkWrapperPtr> _sinks;
+
+      // optional bounded message queue. Ref: LogWorkerOptions::max_queue_size
+      const LogWorkerOptions _options;
+      std::mutex _pending_mutex;
+      std::condition_variable _pending_room;
+      std::deque<std::unique_ptr<LogMessage>> _pending;
+      std::atomic<size_t> _dropped;
+      size_t _dropped_reported; // only used by the background worker
+
+      // messages sent to the sinks, until every sink is done with them. Only with the bounded queue.
+      // Shared with the batches, a sink can release its last batch after the LogWorker is gone
+      struct SinkBacklog {
+         std::mutex mutex;
+         std::condition_variable done;
+         size_t messages = 0;
+      };
+      std::shared_ptr<SinkBacklog> _sink_backlog;
+
+      // messages saved since the last wakeup, sent to the sinks in one go. Only used by the background worker
+      LogMessageBatch _batch;
+      bool _batching;
+
       std::unique_ptr<kjellkod::Active> _bg; // do not change declaration order. _bg must be destroyed before sinks
+      std::unique_ptr<g3::internal::ThreadRings> _rings; // optional, must be destroyed before _bg
+      std::unique_ptr<g3::internal::FlightRecorder> _recorder; // optional. Ref: LogWorkerOptions::flight_recorder_file
+      std::unique_ptr<g3::internal::WorkerTelemetry> _telemetry; // optional. Ref: LogWorkerOptions::telemetry
 
-      LogWorkerImpl();
+      explicit LogWorkerImpl(const LogWorkerOptions& options);
       ~LogWorkerImpl() = default;
 
+      void save(std::unique_ptr<LogMessage> message);
+      void fatal(FatalMessagePtr msgPtr);
+      void enqueue(std::unique_ptr<LogMessage> message);
+
       void bgSave(g3::LogMessagePtr msgPtr);
       void bgFatal(FatalMessagePtr msgPtr);
+      void bgDrainPending();
+      void bgFlushBatch();
+      size_t bgWaitForSinkRoom();
+      std::shared_ptr<LogMessageBatch> bgNewSinkBatch(size_t messages);
 
       LogWorkerImpl(const LogWorkerImpl&) = delete;
       LogWorkerImpl& operator=(const LogWorkerImpl&) = delete;
@@ -51,7 +137,7 @@ namespace g3 {
    /// save( msg ) : internal use
    /// fatal ( fatal_msg ) : internal use
    class LogWorker final {
-      LogWorker() = default;
+      explicit LogWorker(const LogWorkerOptions& options) : _impl(options) {}
       void addWrappedSink(std::shared_ptr<g3::internal::SinkWrapper> wrapper);
 
       LogWorkerImpl _impl;
@@ -66,6 +152,15 @@ namespace g3 {
       /// if you want to use the default file logger then see below for @ref addDefaultLogger
       static std::unique_ptr<LogWorker> createLogWorker();
 
+      /// Creates the LogWorker with no sinks, configured with the given options
+      /// Example: per thread rings
+      /// @verbatim
+      /// g3::LogWorkerOptions options;
+      /// options.per_thread_rings = true;
+      /// auto worker = g3::LogWorker::createLogWorker(options);
+      /// @endverbatim
+      static std::unique_ptr<LogWorker> createLogWorker(const LogWorkerOptions& options);
+
       
       /**
       A convenience function to add the default g3::FileSink to the log worker
@@ -96,13 +191,33 @@ namespace g3 {
       std::unique_ptr<g3::SinkHandle<T>> addSink(std::unique_ptr<T> real_sink, DefaultLogCall call) {
          using namespace g3;
          using namespace g3::internal;
-         auto sink = std::make_shared<Sink<T>> (std::move(real_sink), call);
+         auto sink = std::make_shared<Sink<T>> (std::move(real_sink), call, _impl._options.sink_executor);
          addWrappedSink(sink);
          return std2::make_unique<SinkHandle<T>> (sink);
       }
 
 
 
+      /// @return number of messages dropped since start, due to a full bounded queue, or
+      /// saved to the per thread rings after they were stopped at shutdown.
+      /// Ref: LogWorkerOptions::max_queue_size
+      size_t droppedMessages() const;
+
+
+      /// @return a snapshot of the message counts, the queue depth, the sinks' backlog and the
+      /// latency from the LOG call to the sinks. Needs LogWorkerOptions::telemetry, otherwise
+      /// only the dropped messages are counted. Can be called from any thread
+      /// @verbatim
+      /// g3::LogWorkerOptions options;
+      /// options.telemetry = true;
+      /// auto worker = g3::LogWorker::createLogWorker(options);
+      /// ...
+      /// auto stats = worker->stats();
+      /// std::cout << stats.queue_depth << " queued, p99 " << stats.latency.p99.count() << " ns";
+      /// @endverbatim
+      LogWorkerStats stats() const;
+
+
       /// internal:
       /// pushes in background thread (asynchronously) input messages to log file
       void save(LogMessagePtr entry);
@@ -0,0 +1,36 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#pragma once
+
+#include "g3log/logmessage.hpp"
+
+#include <memory>
+
+namespace g3 {
+   namespace internal {
+      /// Pool of the LogMessages of the LOG and LOG_FAST calls. Internal use only
+      ///
+      /// The logging threads take the messages, the sinks give them back once they are done
+      /// with them. A message keeps the capacity of its strings, so once the pool is warm the
+      /// message of a LOG call is not allocated. Each thread caches a few messages, the caches
+      /// exchange them with a shared list in chunks. A message with a very long text is not kept.
+      /// The whole LOG call is only free of allocations with LogWorkerOptions::per_thread_rings,
+      /// otherwise each message is sent to the background worker in a std::function that is
+      /// allocated, as is the node of the background worker's queue
+
+      /// @return a message for the call site, the same as new LogMessage(site, level)
+      std::unique_ptr<LogMessage> takeLogMessage(const LogSite* site, const LEVELS& level);
+
+      /// gives back a message from takeLogMessage, or deletes it. Thread safe
+      void recycleLogMessage(const LogMessage* message);
+
+      /// a pooled message, or a thread's capture buffer, that is larger than this is released after use
+      const size_t kMaxKeptCapacity = 64 * 1024;
+   } // internal
+} // g3
@@ -0,0 +1,81 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+#pragma once
+
+#include <string>
+#include <chrono>
+
+#include "g3log/logmessage.hpp"
+#include "g3log/loglayout.hpp"
+
+namespace g3 {
+
+   /** File sink that writes through a memory mapping of the log file, POSIX only.
+   *
+   * The file is grown in large chunks (posix_fallocate where available) and the current
+   * chunk is mapped. A log line is formatted into a reused buffer and copied into the mapping,
+   * i.e. there is no std::ofstream and no write(2) per log line.
+   *
+   * The written pages are handed to the kernel with msync(MS_ASYNC) about once per second, and
+   * synchronously at a FATAL entry or a call to flush(). At close, or at a log file change, the
+   * file is truncated to the written size.
+   *
+   * A write to a mapped page past the end of the file raises SIGBUS. The file size is therefore
+   * checked before a chunk is mapped, and about once per second. A file that another process has
+   * truncated is written on from its new end.
+   *
+   * Usage:
+   * auto handle = worker->addSink(std2::make_unique<g3::MmapFileSink>(prefix, directory), &g3::MmapFileSink::fileWrite);
+   */
+   class MmapFileSink {
+   public:
+      static const size_t kDefaultChunkBytes = 16 * 1024 * 1024;
+
+      /// @param chunk_bytes the file grows, and is mapped, this many bytes at a time. Rounded up to the page size
+      MmapFileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id = "g3log",
+                   size_t chunk_bytes = kDefaultChunkBytes, const LogLayout &layout = LogLayout::defaultLayout());
+      virtual ~MmapFileSink();
+
+      void fileWrite(LogMessageMover message);
+      std::string changeLogFile(const std::string &directory, const std::string &logger_id);
+      std::string fileName();
+
+      /// msync(MS_SYNC) of what is written to the current chunk
+      void flush();
+
+
+   private:
+      std::string _log_file_with_path;
+      std::string _log_prefix_backup; // needed in case of future log file changes of directory
+      const size_t _chunk_bytes;
+      const LogLayout _layout;
+      std::string _line; // reused formatting buffer
+
+      int _fd;
+      char *_mapping;        // the current chunk, nullptr if not mapped
+      size_t _mapping_offset; // file offset of the current chunk
+      size_t _written;        // bytes written to the file
+      std::chrono::steady_clock::time_point _last_sync;
+      bool _write_failed;     // reported once, until a write succeeds again
+
+      void useFile(int fd, const std::string &file_with_path);
+      void closeFile();
+      bool mapChunk();
+      void unmapChunk();
+      void sync(int flags);
+      void followTruncation();
+      void writeWithoutMapping(const char *data, size_t size);
+      void append(const char *data, size_t size);
+      void append(const std::string &text) {
+         append(text.data(), text.size());
+      }
+
+      MmapFileSink &operator=(const MmapFileSink &) = delete;
+      MmapFileSink(const MmapFileSink &other) = delete;
+   };
+} // g3
@@ -11,8 +11,10 @@
 
 #include "g3log/sinkwrapper.hpp"
 #include "g3log/active.hpp"
+#include "g3log/sinkexecutor.hpp"
 #include "g3log/future.hpp"
 #include "g3log/logmessage.hpp"
+#include "g3log/telemetry.hpp"
 
 #include <memory>
 #include <functional>
@@ -21,6 +23,7 @@
 namespace g3 {
    namespace internal {
       typedef std::function<void(LogMessageMover) > AsyncMessageCall;
+      typedef std::function<void(const LogMessageBatch&) > AsyncBatchCall;
 
       /// The asynchronous Sink has an active object, incoming requests for actions
       //  will be processed in the background by the specific object the Sink represents.
@@ -33,46 +36,109 @@ namespace g3 {
       // Ref: send(Message) deals with incoming log entries (converted if necessary to string)
       // Ref: send(Call call, Args... args) deals with calls
       //           to the real sink's API
+      //
+      // With a SinkExecutor the calls run on a strand of the shared executor, instead of
+      // on the sink's own thread. Either way they run one at a time, in FIFO order
 
       template<class T>
       struct Sink : public SinkWrapper {
          std::unique_ptr<T> _real_sink;
-         std::unique_ptr<kjellkod::Active> _bg;
+         std::unique_ptr<kjellkod::Active> _bg;      // without an executor
+         std::unique_ptr<SinkStrand> _strand;        // with an executor
          AsyncMessageCall _default_log_call;
+         AsyncBatchCall _batch_call;
+
+         // for sinks that receive the messages one at a time
+         AsyncBatchCall oneByOne() {
+            return [this](const LogMessageBatch & messages) {
+               for (auto& message : messages) {
+                  _default_log_call(message);
+               }
+            };
+         }
 
          template<typename DefaultLogCall >
-         Sink(std::unique_ptr<T> sink, DefaultLogCall call)
+         Sink(std::unique_ptr<T> sink, DefaultLogCall call, std::shared_ptr<SinkExecutor> executor = nullptr)
             : SinkWrapper(),
          _real_sink {std::move(sink)},
-         _bg(kjellkod::Active::createActive()),
+         _bg(createActive(executor)),
+         _strand(createStrand(executor)),
          _default_log_call(std::bind(call, _real_sink.get(), std::placeholders::_1)) {
+            _batch_call = oneByOne();
+         }
+
+
+         /// The sink receives the messages in batches. Ref: LogMessageBatch
+         Sink(std::unique_ptr<T> sink, void(T::*Call)(const LogMessageBatch&), std::shared_ptr<SinkExecutor> executor = nullptr)
+            : SinkWrapper(),
+         _real_sink {std::move(sink)},
+         _bg(createActive(executor)),
+         _strand(createStrand(executor)) {
+            _batch_call = std::bind(Call, _real_sink.get(), std::placeholders::_1);
+            auto batch_call = _batch_call;
+            _default_log_call = [batch_call](LogMessageMover m) {
+               batch_call(LogMessageBatch {m});
+            };
          }
 
 
-         Sink(std::unique_ptr<T> sink, void(T::*Call)(std::string) )
+         Sink(std::unique_ptr<T> sink, void(T::*Call)(std::string), std::shared_ptr<SinkExecutor> executor = nullptr)
             : SinkWrapper(),
          _real_sink {std::move(sink)},
-         _bg(kjellkod::Active::createActive()) {
+         _bg(createActive(executor)),
+         _strand(createStrand(executor)) {
             std::function<void(std::string)> adapter = std::bind(Call, _real_sink.get(), std::placeholders::_1);
             _default_log_call = [ = ](LogMessageMover m) {
                adapter(m.get().toString());
             };
+            _batch_call = oneByOne();
          }
 
          virtual ~Sink() {
             _bg.reset(); // TODO: to remove
+            _strand.reset(); // waits for the queued calls
          }
 
          void send(LogMessageMover msg) override {
-            _bg->send([this, msg] {
+            post([this, msg] {
                _default_log_call(msg);
             });
          }
 
+         void sendBatch(std::shared_ptr<const LogMessageBatch> messages) override {
+            post([this, messages] {
+               if (telemetry) {
+                  telemetry->process(*messages, _batch_call);
+               } else {
+                  _batch_call(*messages);
+               }
+            });
+         }
+
          template<typename Call, typename... Args>
          auto async(Call call, Args &&... args)-> std::future< typename std::result_of<decltype(call)(T, Args...)>::type> {
+            if (_strand) {
+               return g3::spawn_task(std::bind(call, _real_sink.get(), std::forward<Args>(args)...), _strand.get());
+            }
             return g3::spawn_task(std::bind(call, _real_sink.get(), std::forward<Args>(args)...), _bg.get());
          }
+
+       private:
+         static std::unique_ptr<kjellkod::Active> createActive(const std::shared_ptr<SinkExecutor>& executor) {
+            return executor ? nullptr : kjellkod::Active::createActive();
+         }
+
+         static std::unique_ptr<SinkStrand> createStrand(const std::shared_ptr<SinkExecutor>& executor) {
+            return std::unique_ptr<SinkStrand>(executor ? new SinkStrand(executor) : nullptr);
+         }
+
+         void post(kjellkod::Callback call) {
+            if (_strand) {
+               _strand->send(std::move(call));
+            } else {
+               _bg->send(std::move(call));
+            }
+         }
       };
    } // internal
 } // g3
@@ -0,0 +1,103 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "g3log/active.hpp"
+
+namespace g3 {
+   namespace internal {
+      class SinkStrand;
+   }
+
+   /** A small work-stealing thread pool, shared by the sinks of a LogWorker instead of one
+   * background thread per sink. Ref: LogWorkerOptions::sink_executor
+   *
+   * Each sink gets a strand: its calls run one at a time and in the order they were sent,
+   * as with the sink's own thread. A strand with pending calls is scheduled on one of the
+   * worker threads. An idle worker steals scheduled strands from the other workers.
+   *
+   * Usage:
+   *   g3::LogWorkerOptions options;
+   *   options.sink_executor = g3::SinkExecutor::create(2);
+   *   auto worker = g3::LogWorker::createLogWorker(options);
+   */
+   class SinkExecutor {
+   public:
+      /// @param threads the number of worker threads. 0: std::thread::hardware_concurrency()
+      static std::shared_ptr<SinkExecutor> create(size_t threads = 2);
+
+      /// Waits for the scheduled strands, then stops the worker threads
+      ~SinkExecutor();
+
+      size_t threadCount() const {
+         return _threads.size();
+      }
+
+   private:
+      friend class internal::SinkStrand;
+
+      // the strands scheduled on a worker. Its owner takes from the front, thieves from the back
+      struct Worker {
+         std::mutex mutex;
+         std::deque<internal::SinkStrand*> strands;
+      };
+
+      std::vector<std::unique_ptr<Worker>> _workers;
+      std::vector<std::thread> _threads;
+      std::atomic<size_t> _next_worker; // for strands scheduled by other threads
+      std::mutex _idle_mutex;
+      std::condition_variable _idle;
+      std::atomic<size_t> _scheduled;   // strands in the workers' deques, counted before they are pushed
+      bool _stop;
+
+      explicit SinkExecutor(size_t threads); // Construction ONLY through factory create()
+      void schedule(internal::SinkStrand* strand);
+      internal::SinkStrand* take(size_t index);
+      void run(size_t index);
+
+      SinkExecutor(const SinkExecutor&) = delete;
+      SinkExecutor& operator=(const SinkExecutor&) = delete;
+   };
+
+
+   namespace internal {
+      /// The serial queue of one sink on a SinkExecutor. Used as the sink's background worker
+      class SinkStrand {
+      public:
+         explicit SinkStrand(std::shared_ptr<SinkExecutor> executor);
+
+         /// Waits until the sent calls have run
+         ~SinkStrand();
+
+         void send(kjellkod::Callback call);
+
+      private:
+         friend class g3::SinkExecutor;
+
+         std::shared_ptr<SinkExecutor> _executor;
+         std::mutex _mutex;
+         std::condition_variable _idle;
+         std::deque<kjellkod::Callback> _calls;
+         bool _scheduled; // in a worker's deque or running
+
+         /// runs a few calls. @return true if there are more, the strand is then scheduled again
+         bool runSome();
+
+         SinkStrand(const SinkStrand&) = delete;
+         SinkStrand& operator=(const SinkStrand&) = delete;
+      };
+   } // internal
+} // g3
@@ -10,12 +10,21 @@
 
 #include "g3log/logmessage.hpp"
 
+#include <memory>
+
 namespace g3 {
    namespace internal {
+      class SinkTelemetry;
 
       struct SinkWrapper {
          virtual ~SinkWrapper() { }
          virtual void send(LogMessageMover msg) = 0;
+
+         /// all the messages in one go, one queued call per batch instead of one per message
+         virtual void sendBatch(std::shared_ptr<const LogMessageBatch> messages) = 0;
+
+         /// set by the LogWorker before the sink gets any message. Ref: LogWorkerOptions::telemetry
+         std::shared_ptr<SinkTelemetry> telemetry;
       };
    }
 }
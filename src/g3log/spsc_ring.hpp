@@ -0,0 +1,97 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================
+*
+* Bounded, wait-free, single producer / single consumer ring buffer.
+* The producer only writes the tail index and the consumer only writes the head
+* index. Each index is padded to its own cache line to avoid false sharing between the
+* logging thread and the background thread. */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+template<typename T>
+class spsc_ring
+{
+   static const size_t kCacheLine = 64;
+   struct PaddedIndex {
+      explicit PaddedIndex(size_t start) : value(start) {}
+      char pad_before[kCacheLine];
+      std::atomic<size_t> value;
+      char pad_after[kCacheLine - sizeof(std::atomic<size_t>)];
+   };
+
+   const size_t mask_;
+   std::vector<T> buffer_;
+   PaddedIndex head_; // next slot to read, written by consumer
+   PaddedIndex tail_; // next slot to write, written by producer
+
+   spsc_ring &operator=(const spsc_ring &) = delete;
+   spsc_ring(const spsc_ring &other) = delete;
+
+   static size_t roundUpToPowerOfTwo(size_t value) {
+      size_t power = 2;
+      while (power < value) {
+         power <<= 1;
+      }
+      return power;
+   }
+
+public:
+   /// @param capacity is rounded up to the nearest power of two
+   explicit spsc_ring(size_t capacity)
+      : mask_(roundUpToPowerOfTwo(capacity) - 1)
+      , buffer_(mask_ + 1)
+      , head_(0)
+      , tail_(0) {}
+
+   /// producer only. @return false if the ring is full, the item is then untouched
+   bool push(T &item) {
+      const size_t tail = tail_.value.load(std::memory_order_relaxed);
+      if (tail - head_.value.load(std::memory_order_acquire) > mask_) {
+         return false;
+      }
+      buffer_[tail & mask_] = std::move(item);
+      tail_.value.store(tail + 1, std::memory_order_release);
+      return true;
+   }
+
+   /// consumer only. @return the oldest item without removing it, or nullptr if empty
+   T *front() {
+      const size_t head = head_.value.load(std::memory_order_relaxed);
+      if (head == tail_.value.load(std::memory_order_acquire)) {
+         return nullptr;
+      }
+      return &buffer_[head & mask_];
+   }
+
+   /// consumer only. Moves out the oldest item. @return false if empty
+   bool pop(T &popped_item) {
+      T *item = front();
+      if (nullptr == item) {
+         return false;
+      }
+      popped_item = std::move(*item);
+      head_.value.store(head_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      return true;
+   }
+
+   bool empty() const {
+      return head_.value.load(std::memory_order_acquire) == tail_.value.load(std::memory_order_acquire);
+   }
+
+   size_t size() const {
+      return tail_.value.load(std::memory_order_acquire) - head_.value.load(std::memory_order_acquire);
+   }
+
+   size_t capacity() const {
+      return mask_ + 1;
+   }
+};
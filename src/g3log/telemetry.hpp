@@ -0,0 +1,174 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#pragma once
+
+#include "g3log/logmessage.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace g3 {
+
+   /// Percentiles of the time from the LOG call until a sink starts on the message
+   struct LatencyStats {
+      uint64_t count = 0; ///< measured messages
+      std::chrono::nanoseconds p50 {0};
+      std::chrono::nanoseconds p90 {0};
+      std::chrono::nanoseconds p99 {0};
+      std::chrono::nanoseconds p999 {0};
+      std::chrono::nanoseconds max {0};
+   };
+
+
+   /// Snapshot of one sink, ref: LogWorkerStats::sinks
+   struct SinkStats {
+      uint64_t received = 0;                 ///< messages sent to the sink
+      uint64_t processed = 0;                ///< messages the sink is done with
+      uint64_t backlog = 0;                  ///< messages waiting for the sink
+      std::chrono::nanoseconds busy_time {0}; ///< time spent in the sink's log calls
+      LatencyStats latency;
+   };
+
+
+   /// Snapshot of the LogWorker's telemetry, ref: LogWorker::stats() and LogWorkerOptions::telemetry
+   /// The counters are read one at a time while the logging goes on, a snapshot taken under
+   /// load is only approximately consistent
+   struct LogWorkerStats {
+      bool enabled = false;        ///< false: only dropped is counted
+      uint64_t enqueued = 0;       ///< messages saved by the logging threads
+      uint64_t processed = 0;      ///< messages sent to the sinks by the background worker
+      uint64_t dropped = 0;        ///< messages dropped by a full bounded queue
+      uint64_t queue_depth = 0;    ///< messages saved, but not yet sent to the sinks
+      uint64_t queue_high_water = 0; ///< highest queue depth seen by the background worker, once per batch
+      uint64_t bytes_formatted = 0;  ///< size of the message texts sent to the sinks
+      LatencyStats queue_wait;       ///< from the LOG call until the background worker takes the message
+
+      // the bounded queue, ref: LogWorkerOptions::max_queue_size
+      uint64_t room_waits = 0;                     ///< LOG calls that waited for room in the full queue
+      std::chrono::nanoseconds room_wait_time {0}; ///< their total wait
+      uint64_t sink_waits = 0;                     ///< times the background worker waited for the sinks to catch up
+      std::chrono::nanoseconds sink_wait_time {0}; ///< its total wait, the queue fills up meanwhile
+
+      std::vector<SinkStats> sinks;  ///< in the order the sinks were added
+      LatencyStats latency;          ///< of all the sinks
+   };
+
+
+
+   namespace internal {
+      /// A counter that logging threads increment without contention: each thread adds to its
+      /// own cache line, the reader sums the threads. One writer per slot, the increment is a
+      /// relaxed load and store. A slot of an exited thread is taken over by the next new thread.
+      /// A thread keeps its slots of up to four counters, e.g. of several LogWorkers
+      class PerThreadCounter {
+       public:
+         PerThreadCounter();
+         void add(uint64_t count);
+         uint64_t sum() const;
+
+         struct Slot;
+
+       private:
+         const uint64_t _id; // unique per instance, used by the thread_local slot registration
+         mutable std::mutex _slots_mutex;
+         std::vector<std::shared_ptr<Slot>> _slots;
+
+         Slot& registerThread();
+
+         PerThreadCounter(const PerThreadCounter&) = delete;
+         PerThreadCounter& operator=(const PerThreadCounter&) = delete;
+      };
+
+
+      /// Log-linear latency histogram, as HdrHistogram, with one writer thread and any number of
+      /// readers. A value is kept within 1/kSubBuckets (3%) of itself
+      class AtomicLatencyHistogram {
+       public:
+         static const unsigned kSubBucketBits = 5;
+         static const uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+
+         AtomicLatencyHistogram();
+         void record(uint64_t nanoseconds); // writer thread only
+
+         /// adds the counters to counts, which is resized as needed
+         void addTo(std::vector<uint64_t>& counts, uint64_t& max) const;
+         static LatencyStats percentiles(const std::vector<uint64_t>& counts, uint64_t max);
+
+       private:
+         std::vector<std::atomic<uint64_t>> _counts;
+         std::atomic<uint64_t> _max;
+      };
+
+
+      /// Telemetry of one sink. The received messages are counted by the LogWorker's background
+      /// worker, the rest on the sink's own thread or strand
+      class SinkTelemetry {
+       public:
+         SinkTelemetry();
+
+         void received(size_t count);
+
+         /// measures the latency of the messages, and the time of the call
+         void process(const LogMessageBatch& messages, const std::function<void(const LogMessageBatch&)>& call);
+
+         SinkStats snapshot() const;
+         const AtomicLatencyHistogram& latency() const {
+            return _latency;
+         }
+
+       private:
+         std::atomic<uint64_t> _received;
+         std::atomic<uint64_t> _processed;
+         std::atomic<uint64_t> _busy_ns;
+         AtomicLatencyHistogram _latency;
+      };
+
+
+      /// Telemetry of a LogWorker. Internal use only, ref: LogWorkerOptions::telemetry
+      class WorkerTelemetry {
+       public:
+         WorkerTelemetry();
+
+         /// logging threads, at each saved message
+         void enqueued() {
+            _enqueued.add(1);
+         }
+
+         /// background worker, at each message it takes from the queue
+         void taken(const LogMessage& message);
+         void sentToSinks(size_t count, uint64_t dropped);
+         /// background worker, it waited for the sinks of the bounded queue to catch up
+         void waitedForSinks(std::chrono::nanoseconds wait);
+
+         /// logging threads, a LOG call waited for room in the full bounded queue
+         void waitedForRoom(std::chrono::nanoseconds wait);
+         void addSink(std::shared_ptr<SinkTelemetry> sink);
+
+         LogWorkerStats snapshot(uint64_t dropped) const;
+
+       private:
+         PerThreadCounter _enqueued;
+         std::atomic<uint64_t> _processed;
+         std::atomic<uint64_t> _high_water;
+         std::atomic<uint64_t> _bytes;
+         AtomicLatencyHistogram _queue_wait;
+         std::atomic<uint64_t> _room_waits;
+         std::atomic<uint64_t> _room_wait_ns;
+         std::atomic<uint64_t> _sink_waits;
+         std::atomic<uint64_t> _sink_wait_ns;
+         mutable std::mutex _sinks_mutex;
+         std::vector<std::shared_ptr<SinkTelemetry>> _sinks;
+      };
+   } // internal
+} // g3
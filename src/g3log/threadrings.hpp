@@ -0,0 +1,90 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#pragma once
+
+#include "g3log/logmessage.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace g3 {
+   namespace internal {
+      struct MessageRing;
+
+      /// Optional producer side of the LogWorker. Internal use only
+      ///
+      /// Each logging thread gets its own wait-free single producer/single consumer ring.
+      /// The ring is registered lazily, at the first LOG call from that thread, through a thread_local.
+      /// A background merging thread drains all the rings in LogMessage::_timestamp order and
+      /// forwards the messages, in batches, to the LogWorker's background worker.
+      /// The order holds across the batches: a message is held back while a thread with an empty
+      /// ring is publishing an older message. A message is ordered as of when its thread calls save()
+      ///
+      /// A full ring blocks its producer until the merging thread has caught up.
+      class ThreadRings {
+       public:
+         typedef std::vector<std::unique_ptr<LogMessage>> Messages;
+         typedef std::shared_ptr<Messages> Batch;
+         typedef std::function<void(Batch)> BatchCall;
+         typedef std::function<void(FatalMessagePtr)> FatalCall;
+
+         /// @param ring_capacity messages per thread, rounded up to the nearest power of two
+         /// @param forward_batch is called from the merging thread with messages in timestamp order
+         /// @param forward_fatal is called from the merging thread, right after the messages
+         ///        that were in the rings are forwarded
+         ThreadRings(size_t ring_capacity, BatchCall forward_batch, FatalCall forward_fatal);
+         ~ThreadRings();
+
+         void save(LogMessagePtr message);
+         void fatal(FatalMessagePtr message);
+
+         /// drains what is left in the rings and joins the merging thread.
+         /// Messages saved after this point are dropped
+         void stop();
+
+         /// @return number of messages dropped since they were saved while or after stop() ran
+         size_t dropped() const {
+            return _dropped.load();
+         }
+
+       private:
+         void run();
+         size_t mergeOnce(std::vector<std::shared_ptr<MessageRing>>& rings, bool final_drain);
+         void drainForFatal(std::vector<std::shared_ptr<MessageRing>>& rings);
+         bool anyPending(const std::vector<std::shared_ptr<MessageRing>>& rings) const;
+         void wakeMerger();
+
+         const uint64_t _id; // unique per instance, used by the thread_local ring registration
+         const size_t _ring_capacity;
+         BatchCall _forward_batch;
+         FatalCall _forward_fatal;
+
+         std::mutex _rings_mutex;
+         std::vector<std::shared_ptr<MessageRing>> _rings;
+         std::atomic<uint64_t> _rings_version;
+
+         std::mutex _wake_mutex;
+         std::condition_variable _wake;
+         std::atomic<bool> _sleeping;
+         std::atomic<bool> _stop;
+         std::vector<std::unique_ptr<FatalMessage>> _fatals; // protected by _wake_mutex
+         std::atomic<bool> _has_fatal;
+         std::atomic<size_t> _dropped;
+         std::thread _merger;
+
+         ThreadRings(const ThreadRings&) = delete;
+         ThreadRings& operator=(const ThreadRings&) = delete;
+      };
+   } // internal
+} // g3
@@ -16,6 +16,8 @@
 #include <ctime>
 #include <string>
 #include <chrono>
+#include <vector>
+#include <cstdint>
 
 // FYI:
 // namespace g3::internal ONLY in g3time.cpp
@@ -38,6 +40,30 @@ namespace g3 {
       // %6: microseconds: 6 digits: 000001  --- default for the time_format
       // %f9, %f: nanoseconds, 9 digits: 000000001
       static const std::string time_formatted = "%H:%M:%S %f6";
+
+
+      /** A time format that is parsed once, at construction. The date and time, i.e. everything
+      * but the "%f" fractions, is only formatted once per second and per thread. The following calls
+      * within the same second copy the cached text and write the fractional digits into it.
+      *
+      * Note: a change of the time zone is seen at the next second */
+      class TimeFormatter {
+       public:
+         explicit TimeFormatter(const std::string& time_format);
+
+         std::string format(const system_time_point& ts) const;
+         /// appends the formatted time to the output buffer
+         void format(const system_time_point& ts, std::string& out) const;
+         const std::string& timeFormat() const {
+            return _time_format;
+         }
+
+       private:
+         const uint64_t _id; // unique per instance, key for the per thread cache
+         const std::string _time_format;
+         std::vector<std::string> _pieces;   // std::strftime formats, one before each fraction and one last
+         std::vector<Fractional> _fractions;
+      };
    } // internal
 
 
@@ -74,6 +100,14 @@ namespace g3 {
 
 	   return time_point_cast<system_clock::duration>(sys_now + (ts - hrs_now));
    }
+
+   /// The inverse of to_system_time(), e.g. for a timestamp that is read back from a binary log file
+   inline high_resolution_time_point to_high_resolution_time(const system_time_point& ts)
+   {
+      using namespace std::chrono;
+      const auto hrs_now = high_resolution_clock::now();
+      return hrs_now + duration_cast<high_resolution_clock::duration>(ts - to_system_time(hrs_now));
+   }
 }
 
 
@@ -0,0 +1,74 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace g3 {
+
+   /// Sets FLAGS_v, the verbosity for VLOG(n) and VLOG_IS_ON(n), and updates the VLOG call sites
+   void setVLogLevel(int verbosity);
+
+   /// Sets FLAGS_vmodule, the verbosity per source file, and updates the VLOG call sites.
+   /// As glog's --vmodule: a comma separated list of <pattern>=<verbosity>, e.g. "mapreduce=2,gfs*=1"
+   /// The pattern is matched against the file name without its directory and its extension, or
+   /// against the whole path without its extension if the pattern has a '/', e.g. "*/net/*=2".
+   /// A "-inl" suffix is ignored.
+   /// '*' matches any characters and '?' any single character. The first matching pattern gives
+   /// the verbosity of the file, FLAGS_v is used for the other files. The patterns are matched
+   /// once per call site, not at each VLOG call
+   void setVModule(const std::string& vmodule);
+
+   /// The VLOG call sites cache their verbosity. Call this after FLAGS_v or FLAGS_vmodule was
+   /// changed directly, e.g. by gflags::SetCommandLineOption. Not needed for changes before the
+   /// first VLOG call
+   void updateVLogSites();
+
+
+   namespace internal {
+      /// glob match, '*' for any characters and '?' for any single character
+      bool vmoduleMatch(const char* pattern, const char* text);
+
+      constexpr int32_t kVLogUnevaluated = std::numeric_limits<int32_t>::max();
+
+      /// The cached verbosity of a VLOG call site. It is evaluated at the first call of the site,
+      /// and again after each change of the verbosity settings, ref: updateVLogSites()
+      /// Constant initialized: the function local static of the call site needs no guard
+      struct VLogSite {
+         constexpr explicit VLogSite(const char* file_path_)
+            : verbosity(kVLogUnevaluated), file_path(file_path_), registered(false), next(nullptr) {}
+
+         std::atomic<int32_t> verbosity;
+         const char* const file_path; ///< as given by __FILE__
+         // the evaluated sites are listed for updateVLogSites(), protected by the settings lock
+         bool registered;
+         VLogSite* next;
+      };
+
+      /// Evaluates the verbosity of the site, if needed. Thread safe
+      /// @return true if VLOG(level) is on at the site
+      bool vlogEvaluate(VLogSite& site, int level);
+
+      /// A disabled VLOG costs one relaxed load and one compare. An unevaluated site has
+      /// the highest verbosity, it always takes the slow path
+      inline bool vlogIsOn(VLogSite& site, int level) {
+         return level <= site.verbosity.load(std::memory_order_relaxed) && vlogEvaluate(site, level);
+      }
+   } // internal
+} // g3
+
+
+/// @return true if VLOG(verboselevel) is on at this call site, i.e. verboselevel <= FLAGS_v,
+/// or verboselevel <= the FLAGS_vmodule verbosity of the file
+#define VLOG_IS_ON(verboselevel) \
+   g3::internal::vlogIsOn([]() -> g3::internal::VLogSite& { \
+      static g3::internal::VLogSite g3_vlog_site {__FILE__}; \
+      return g3_vlog_site; }(), (verboselevel))
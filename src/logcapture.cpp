@@ -9,11 +9,15 @@
 #include "g3log/logcapture.hpp"
 #include "g3log/g3log.hpp"
 #include "g3log/crashhandler.hpp"
+#include "g3log/messagepool.hpp"
 
 #ifdef G3_DYNAMIC_MAX_MESSAGE_SIZE
 #include <vector>
 #endif /* G3_DYNAMIC_MAX_MESSAGE_SIZE */
 
+#include <algorithm>
+#include <cstring>
+
 // For Windows we need force a thread_local install per thread of three
 // signals that must have a signal handler installed per thread-basis
 // It is really a royal pain. Seriously Microsoft? Seriously?
@@ -33,6 +37,79 @@ void g3::only_change_at_initialization::setMaxMessageSize(size_t max_size) {
  }
 #endif /* G3_DYNAMIC_MAX_MESSAGE_SIZE */
 
+namespace {
+   // Reused by all LOG calls on the thread. Ref: CaptureStreamBuf
+   struct ThreadCaptureBuffer {
+      std::string buffer;
+      bool in_use = false;
+   };
+   thread_local ThreadCaptureBuffer t_capture;
+
+   const size_t kMinCaptureSize = 256;
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      CaptureStreamBuf::CaptureStreamBuf()
+         : _buffer(&_own)
+         , _uses_thread_buffer(false) {
+         if (!t_capture.in_use) {
+            t_capture.in_use = true;
+            _buffer = &t_capture.buffer;
+            _uses_thread_buffer = true;
+         }
+         // the whole capacity is used, minus one byte that is kept for the null terminator
+         _buffer->resize(std::max(_buffer->capacity(), kMinCaptureSize));
+         setp(&(*_buffer)[0], &(*_buffer)[0] + _buffer->size() - 1);
+      }
+
+      CaptureStreamBuf::~CaptureStreamBuf() {
+         if (_uses_thread_buffer) {
+            t_capture.in_use = false;
+            // an unusually long message does not keep its buffer for the rest of the thread's life
+            if (t_capture.buffer.capacity() > kMaxKeptCapacity) {
+               std::string().swap(t_capture.buffer);
+            }
+         }
+      }
+
+      const char* CaptureStreamBuf::c_str() {
+         *pptr() = '\0';
+         return pbase();
+      }
+
+      void CaptureStreamBuf::grow(size_t min_size) {
+         const auto used = pptr() - pbase();
+         _buffer->resize(std::max(min_size, 2 * _buffer->size()));
+         _buffer->resize(_buffer->capacity());
+         setp(&(*_buffer)[0], &(*_buffer)[0] + _buffer->size() - 1);
+         pbump(static_cast<int>(used));
+      }
+
+      CaptureStreamBuf::int_type CaptureStreamBuf::overflow(int_type ch) {
+         if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+         }
+         grow(_buffer->size() + 1);
+         *pptr() = traits_type::to_char_type(ch);
+         pbump(1);
+         return ch;
+      }
+
+      std::streamsize CaptureStreamBuf::xsputn(const char* text, std::streamsize count) {
+         const auto used = static_cast<size_t>(pptr() - pbase());
+         if (epptr() - pptr() < count) {
+            grow(used + static_cast<size_t>(count) + 1);
+         }
+         std::memcpy(pptr(), text, static_cast<size_t>(count));
+         pbump(static_cast<int>(count));
+         return count;
+      }
+   } // internal
+} // g3
+
+
 /** logCapture is a simple struct for capturing log/fatal entries. At destruction the
 * captured message is forwarded to background worker.
 * As a safety precaution: No memory allocated here will be moved into the background
@@ -41,12 +118,17 @@ void g3::only_change_at_initialization::setMaxMessageSize(size_t max_size) {
 LogCapture::~LogCapture() {
    using namespace g3::internal;
    SIGNAL_HANDLER_VERIFY();
-   saveMessage(_stream.str().c_str(), _file, _line, _function, _level, _expression, _fatal_signal, _stack_trace.c_str());
+   if (nullptr != _site) {
+      saveMessage(_buffer.c_str(), _site, _level, _expression, _fatal_signal, _stack_trace.c_str());
+   } else {
+      saveMessage(_buffer.c_str(), _file, _line, _function, _level, _expression, _fatal_signal, _stack_trace.c_str());
+   }
 }
 
 
 /// Called from crash handler when a fatal signal has occurred (SIGSEGV etc)
-LogCapture::LogCapture(const LEVELS &level, g3::SignalType fatal_signal, const char *dump) : LogCapture("", 0, "", level, "", fatal_signal, dump) {
+/// The call site is a constant: no lookup, and no lock, in the signal handler
+LogCapture::LogCapture(const LEVELS &level, g3::SignalType fatal_signal, const char *dump) : LogCapture(&g3::internal::kSignalSite, level, "", fatal_signal, dump) {
 }
 
 /**
@@ -57,7 +139,16 @@ LogCapture::LogCapture(const LEVELS &level, g3::SignalType fatal_signal, const c
  */
 LogCapture::LogCapture(const char *file, const int line, const char *function, const LEVELS &level,
                        const char *expression, g3::SignalType fatal_signal, const char *dump)
-   : _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal) {
+   : _stream(&_buffer), _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal), _site(nullptr) {
+
+   if (g3::internal::wasFatal(level)) {
+      _stack_trace = std::string{"\n*******\tSTACKDUMP *******\n"};
+      _stack_trace.append(g3::internal::stackdump(dump));
+   }
+}
+
+LogCapture::LogCapture(const g3::LogSite *site, const LEVELS &level, const char *expression, g3::SignalType fatal_signal, const char *dump)
+   : _stream(&_buffer), _file(site->file_path), _line(site->line), _function(site->function), _level(level), _expression(expression), _fatal_signal(fatal_signal), _site(site) {
 
    if (g3::internal::wasFatal(level)) {
       _stack_trace = std::string{"\n*******\tSTACKDUMP *******\n"};
@@ -67,7 +158,7 @@ LogCapture::LogCapture(const char *file, const int line, const char *function, c
 
 LogCapture::LogCapture(const char *file, const int line, const char* function, const g3Internal::CheckOpString result, const LEVELS &level,
                        const char *expression, g3::SignalType fatal_signal, const char *dump)
-   : _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal) {
+   : _stream(&_buffer), _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal), _site(nullptr) {
 
    stream() << "Check failed: " << (*result.str_) << " ";
    if (g3::internal::wasFatal(level)) {
@@ -78,7 +169,7 @@ LogCapture::LogCapture(const char *file, const int line, const char* function, c
 
 LogCapture::LogCapture(const char *file, const int line, const char* function, std::string result, const LEVELS &level,
                        const char *expression, g3::SignalType fatal_signal, const char *dump)
-   : _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal) {
+   : _stream(&_buffer), _file(file), _line(line), _function(function), _level(level), _expression(expression), _fatal_signal(fatal_signal), _site(nullptr) {
 
    stream() << "Check failed: " << result << " ";
    if (g3::internal::wasFatal(level)) {
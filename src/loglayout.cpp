@@ -0,0 +1,122 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/loglayout.hpp"
+#include "g3log/logmessage.hpp"
+
+namespace {
+   void appendLine(int line, std::string& out) {
+      char digits[16];
+      size_t size = 0;
+      unsigned int value = static_cast<unsigned int>(line < 0 ? -line : line);
+      do {
+         digits[size++] = static_cast<char>('0' + value % 10);
+         value /= 10;
+      } while (value > 0);
+      if (line < 0) {
+         out.push_back('-');
+      }
+      while (size > 0) {
+         out.push_back(digits[--size]);
+      }
+   }
+} // anonymous
+
+
+namespace g3 {
+
+   LogLayout::LogLayout(const std::string& pattern)
+      : _pattern(pattern) {
+      const std::string default_time_format = internal::date_formatted + " " + internal::time_formatted;
+      std::string text;
+      for (size_t pos = 0; pos < pattern.size(); ++pos) {
+         const char ch = pattern[pos];
+         if ('%' != ch || pos + 1 == pattern.size()) {
+            text.push_back(ch);
+            continue;
+         }
+
+         Field field {FieldType::Text, {}, nullptr};
+         const char type = pattern[++pos];
+         switch (type) {
+            case 'T': {
+               field.type = FieldType::Timestamp;
+               std::string time_format = default_time_format;
+               const size_t end = pattern.find('}', pos);
+               if (pos + 1 < pattern.size() && '{' == pattern[pos + 1] && std::string::npos != end) {
+                  time_format = pattern.substr(pos + 2, end - pos - 2);
+                  pos = end;
+               }
+               field.time_format = std::make_shared<internal::TimeFormatter>(time_format);
+               break;
+            }
+            case 'L': field.type = FieldType::Level; break;
+            case 'F': field.type = FieldType::File; break;
+            case 'P': field.type = FieldType::FilePath; break;
+            case 'N': field.type = FieldType::Function; break;
+            case '#': field.type = FieldType::Line; break;
+            case 't': field.type = FieldType::ThreadId; break;
+            case 'm': field.type = FieldType::Message; break;
+            case '%': text.push_back('%'); continue;
+            default: // unknown fields are kept as text
+               text.push_back('%');
+               text.push_back(type);
+               continue;
+         }
+
+         addText(text);
+         text.clear();
+         _fields.push_back(std::move(field));
+      }
+      text.push_back('\n');
+      addText(text);
+   }
+
+
+   void LogLayout::addText(const std::string& text) {
+      if (!text.empty()) {
+         _fields.push_back(Field {FieldType::Text, text, nullptr});
+      }
+   }
+
+
+   const LogLayout& LogLayout::defaultLayout() {
+      // never deleted, LogMessage::toString() can be called during static destruction
+      static const LogLayout* layout = new LogLayout("%T\t%L [%F->%N:%#]\t%m");
+      return *layout;
+   }
+
+
+   void LogLayout::format(const LogMessage& message, std::string& out) const {
+      if (message.wasFatal()) {
+         out.append(message.toString());
+         return;
+      }
+
+      for (auto& field : _fields) {
+         switch (field.type) {
+            case FieldType::Text: out.append(field.text); break;
+            case FieldType::Timestamp: field.time_format->format(to_system_time(message._timestamp), out); break;
+            case FieldType::Level: out.append(message._level.text); break;
+            case FieldType::File: out.append(message._site->file); break;
+            case FieldType::FilePath: out.append(message._site->file_path); break;
+            case FieldType::Function: out.append(message._site->function); break;
+            case FieldType::Line: appendLine(message._line, out); break;
+            case FieldType::ThreadId: out.append(message.threadID()); break;
+            case FieldType::Message: out.append(message._message); break;
+         }
+      }
+   }
+
+
+   std::string LogLayout::toString(const LogMessage& message) const {
+      std::string out;
+      format(message, out);
+      return out;
+   }
+} // g3
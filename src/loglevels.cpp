@@ -10,6 +10,7 @@
 #include <cassert>
 
 #include <iostream>
+#include <mutex>
 
 namespace g3 {
    namespace internal {
@@ -18,24 +19,83 @@ namespace g3 {
       }
 
 #ifdef G3_DYNAMIC_LOGGING
-      const std::map<int, LoggingLevel> g_log_level_defaults = {
-	     {G3LOG_DEBUG.value,{G3LOG_DEBUG}},
-         {INFO.value, {INFO}},
-         {WARNING.value, {WARNING}},
-         {ERROR.value, {ERROR}},
-         {FATAL.value, {FATAL}}
-      };
+      constexpr uint64_t levelBit(int value) {
+         return uint64_t {1} << (value % 64);
+      }
 
-      std::map<int, g3::LoggingLevel> g_log_levels = g_log_level_defaults;
+      // the default levels are all in the first word
+      constexpr uint64_t kDefaultEnabledLevels = levelBit(kDebugValue) | levelBit(kInfoValue) | levelBit(kWarningValue)
+                                                 | levelBit(kErrorValue) | levelBit(kFatalValue);
+
+      // constant initialized: LOG calls during static initialization see the defaults
+      std::atomic<uint64_t> g_enabled_levels[kLevelWords] = {{kDefaultEnabledLevels}, {0}};
 #endif
    } // internal
+} // g3
 
 #ifdef G3_DYNAMIC_LOGGING
+namespace {
+   // All added levels with their status. The status of the levels in the bitmask range is
+   // mirrored in g_enabled_levels. Writes to both are done with the lock held
+   struct LevelTable {
+      std::mutex mutex;
+      std::map<int, g3::LoggingLevel> levels;
+   };
+
+   const std::map<int, g3::LoggingLevel>& defaultLevels() {
+      static const std::map<int, g3::LoggingLevel>* defaults = new std::map<int, g3::LoggingLevel> {
+         {G3LOG_DEBUG.value, {G3LOG_DEBUG}},
+         {G3LOG_INFO.value, {G3LOG_INFO}},
+         {G3LOG_WARNING.value, {G3LOG_WARNING}},
+         {G3LOG_ERROR.value, {G3LOG_ERROR}},
+         {G3LOG_FATAL.value, {G3LOG_FATAL}}
+      };
+      return *defaults;
+   }
+
+   // never deleted. Levels can be checked during static destruction
+   LevelTable& levelTable() {
+      static LevelTable* table = new LevelTable {{}, defaultLevels()};
+      return *table;
+   }
+
+   // the lock must be held
+   void storeStatus(g3::LoggingLevel& entry, bool enabled) {
+      entry.status = enabled;
+      const int value = entry.level.value;
+      if (value < 0 || value >= g3::internal::kLevelBits) {
+         return;
+      }
+      auto& word = g3::internal::g_enabled_levels[value / 64];
+      const uint64_t bit = g3::internal::levelBit(value);
+      if (enabled) {
+         word.fetch_or(bit, std::memory_order_relaxed);
+      } else {
+         word.fetch_and(~bit, std::memory_order_relaxed);
+      }
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      bool outOfRangeLogLevel(int value) {
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         auto it = table.levels.find(value);
+         return (table.levels.end() != it) && it->second.status.value();
+      }
+   } // internal
+
+
    namespace only_change_at_initialization {
 
       void addLogLevel(LEVELS lvl, bool enabled) {
-         int value = lvl.value;
-         internal::g_log_levels[value] = {lvl, enabled};
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         auto& entry = table.levels[lvl.value];
+         entry.level = lvl;
+         storeStatus(entry, enabled);
       }
 
 
@@ -44,7 +104,13 @@ namespace g3 {
       }
 
       void reset() {
-         g3::internal::g_log_levels = g3::internal::g_log_level_defaults;
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         table.levels = defaultLevels();
+         internal::g_enabled_levels[0].store(internal::kDefaultEnabledLevels, std::memory_order_relaxed);
+         for (int word = 1; word < internal::kLevelWords; ++word) {
+            internal::g_enabled_levels[word].store(0, std::memory_order_relaxed);
+         }
       }
    } // only_change_at_initialization
 
@@ -52,24 +118,24 @@ namespace g3 {
    namespace log_levels {
 
       void setHighest(LEVELS enabledFrom) {
-         auto it = internal::g_log_levels.find(enabledFrom.value);
-         if (it != internal::g_log_levels.end()) {
-            for (auto& v : internal::g_log_levels) {
-               if (v.first < enabledFrom.value) {
-                  disable(v.second.level);
-               } else {
-                  enable(v.second.level);
-               }
-
-            }
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         if (table.levels.end() == table.levels.find(enabledFrom.value)) {
+            return;
+         }
+         for (auto& v : table.levels) {
+            storeStatus(v.second, v.first >= enabledFrom.value);
          }
       }
 
 
       void set(LEVELS level, bool enabled) {
-         auto it = internal::g_log_levels.find(level.value);
-         if (it != internal::g_log_levels.end()) {
-            internal::g_log_levels[level.value] = {level, enabled};
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         auto it = table.levels.find(level.value);
+         if (it != table.levels.end()) {
+            it->second.level = level;
+            storeStatus(it->second, enabled);
          }
       }
 
@@ -84,14 +150,18 @@ namespace g3 {
 
 
       void disableAll() {
-         for (auto& v : internal::g_log_levels) {
-            v.second.status = false;
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         for (auto& v : table.levels) {
+            storeStatus(v.second, false);
          }
       }
 
       void enableAll() {
-         for (auto& v : internal::g_log_levels) {
-            v.second.status = true;
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         for (auto& v : table.levels) {
+            storeStatus(v.second, true);
          }
       }
 
@@ -105,39 +175,33 @@ namespace g3 {
       }
 
       std::string to_string() {
-         return to_string(internal::g_log_levels);
+         return to_string(getAll());
       }
 
 
       std::map<int, g3::LoggingLevel> getAll() {
-         return internal::g_log_levels;
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         return table.levels;
       }
 
       // status : {Absent, Enabled, Disabled};
       status getStatus(LEVELS level) {
-         const auto it = internal::g_log_levels.find(level.value);
-         if (internal::g_log_levels.end() == it) {
+         auto& table = levelTable();
+         std::lock_guard<std::mutex> lock(table.mutex);
+         auto it = table.levels.find(level.value);
+         if (table.levels.end() == it) {
             return status::Absent;
          }
 
-         return (it->second.status.get().load() ? status::Enabled : status::Disabled);
+         return (it->second.status.value() ? status::Enabled : status::Disabled);
 
       }
    } // log_levels
-
+} // g3
 #endif
 
 
-   bool logLevel(LEVELS log_level) {
-#ifdef G3_DYNAMIC_LOGGING
-      int level = log_level.value;
-      bool status = internal::g_log_levels[level].status.value();
-      return status;
-#endif
-      return true;
-   }
-} // g3
-
 LEVELS::LEVELS(int id):value(id){
       switch(id){
             case 0: text = "DEBUG"; break;
@@ -9,35 +9,25 @@
 #include "g3log/logmessage.hpp"
 #include "g3log/crashhandler.hpp"
 #include "g3log/time.hpp"
+#include "g3log/fastlog.hpp"
+#include "g3log/loglayout.hpp"
 #include <mutex>
 
-namespace {
-   std::string splitFileName(const std::string& str) {
-      size_t found;
-      found = str.find_last_of("(/\\");
-      return str.substr(found + 1);
-   }
-} // anonymous
-
-
-
 namespace g3 {
 
 
    // helper for setting the normal log details in an entry
    std::string LogDetailsToString(const LogMessage& msg) {
-      std::string out;
-      out.append(msg.timestamp() + "\t"
-                 + msg.level() + " [" + msg.file() + "->" + msg.function() + ":" + msg.line() + "]\t");
+      std::string out = msg.timestamp();
+      out.append("\t").append(msg._level.text).append(" [").append(msg._site->file).append("->")
+      .append(msg._site->function).append(":").append(msg.line()).append("]\t");
       return out;
    }
 
 
    // helper for normal
    std::string normalToString(const LogMessage& msg) {
-      auto out = LogDetailsToString(msg);
-      out.append(msg.message() + '\n');
-      return out;
+      return LogLayout::defaultLayout().toString(msg);
    }
 
    // helper for fatal signal
@@ -110,6 +100,11 @@ namespace g3 {
 
 
 
+   std::string LogMessage::timestamp() const {
+      static const internal::TimeFormatter default_format {internal::date_formatted + " " + internal::time_formatted};
+      return default_format.format(to_system_time(_timestamp));
+   }
+
    std::string LogMessage::timestamp(const std::string& time_look) const {
       return g3::localtime_formatted(to_system_time(_timestamp), time_look);
    }
@@ -125,47 +120,54 @@ namespace g3 {
 
    LogMessage::LogMessage(const std::string& file, const int line,
                           const std::string& function, const LEVELS& level)
+      : LogMessage(internal::registerSite(file.c_str(), line, function.c_str()), level) {
+      _line = line; // the site can be the shared record of a full registry
+   }
+
+
+   LogMessage::LogMessage(const LogSite* site, const LEVELS& level)
       : _timestamp(std::chrono::high_resolution_clock::now())
       , _call_thread_id(std::this_thread::get_id())
-#if defined(G3_LOG_FULL_FILENAME)
-      , _file(file)
-#else
-      , _file(splitFileName(file))
-#endif
-      , _file_path(file)
-      , _line(line)
-      , _function(function)
-      , _level(level) {
+      , _site(site)
+      , _line(site->line)
+      , _level(level)
+      , _fast_format(nullptr) {
    }
 
 
    LogMessage::LogMessage(const std::string& fatalOsSignalCrashMessage)
-      : LogMessage( {""}, 0, {""}, internal::FATAL_SIGNAL) {
+      : LogMessage(&internal::kSignalSite, internal::FATAL_SIGNAL) {
       _message.append(fatalOsSignalCrashMessage);
    }
 
    LogMessage::LogMessage(const LogMessage& other)
       : _timestamp(other._timestamp)
       , _call_thread_id(other._call_thread_id)
-      , _file(other._file)
-      , _file_path(other._file_path)
+      , _site(other._site)
       , _line(other._line)
-      , _function(other._function)
       , _level(other._level)
       , _expression(other._expression)
-      , _message(other._message) {
+      , _message(other._message)
+      , _fast_format(other._fast_format) {
    }
 
    LogMessage::LogMessage(LogMessage&& other)
       : _timestamp(other._timestamp)
       , _call_thread_id(other._call_thread_id)
-      , _file(std::move(other._file))
-      , _file_path(std::move(other._file_path))
+      , _site(other._site)
       , _line(other._line)
-      , _function(std::move(other._function))
       , _level(other._level)
       , _expression(std::move(other._expression))
-      , _message(std::move(other._message)) {
+      , _message(std::move(other._message))
+      , _fast_format(other._fast_format) {
+      other._fast_format = nullptr;
+   }
+
+   void LogMessage::formatFastMessage() {
+      if (nullptr != _fast_format) {
+         _message = internal::fast::format(_fast_format, _message);
+         _fast_format = nullptr;
+      }
    }
 
 
@@ -0,0 +1,140 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/logsite.hpp"
+#include "g3log/generated_definitions.hpp"
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace {
+   // distinct call sites kept by the registry, after that the new sites share kOverflowSite
+   const size_t kMaxSites = 64 * 1024;
+
+   struct SiteEntry {
+      SiteEntry(const char* file_path, size_t basename_offset, int line, const char* function, uint32_t id)
+         : file_path_copy(file_path)
+         , function_copy(function) {
+         site.file_path = file_path_copy.c_str();
+#if defined(G3_LOG_FULL_FILENAME)
+         (void)basename_offset;
+         site.file = site.file_path;
+#else
+         site.file = site.file_path + basename_offset;
+#endif
+         site.function = function_copy.c_str();
+         site.line = line;
+         site.id = id;
+      }
+
+      const std::string file_path_copy;
+      const std::string function_copy;
+      g3::LogSite site;
+   };
+
+   struct SiteRegistry {
+      std::mutex mutex;
+      std::deque<SiteEntry> entries; // deque: the entries are never moved
+      std::unordered_multimap<uint64_t, const g3::LogSite*> lookup; // by siteHash
+   };
+
+   // never deleted. LOG calls can happen during static destruction
+   SiteRegistry& registry() {
+      static SiteRegistry* instance = new SiteRegistry;
+      return *instance;
+   }
+
+   // the registered sites get the ids 1 to kMaxSites
+   const g3::LogSite kOverflowSite = {"(too many g3log call sites)", "(too many g3log call sites)", "", 0,
+                                      static_cast<uint32_t>(kMaxSites + 1)
+                                     };
+
+
+   uint64_t siteHash(const char* file_path, int line, const char* function) {
+      uint64_t hash = 14695981039346656037ULL; // FNV-1a
+      auto add = [&hash](const char* text) {
+         for (; '\0' != *text; ++text) {
+            hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ULL;
+         }
+         hash = (hash ^ 0xff) * 1099511628211ULL;
+      };
+      add(file_path);
+      add(function);
+      return hash ^ static_cast<uint64_t>(static_cast<uint32_t>(line));
+   }
+
+   bool sameSite(const g3::LogSite* site, const char* file_path, int line, const char* function) {
+      return site->line == line && 0 == std::strcmp(site->file_path, file_path) && 0 == std::strcmp(site->function, function);
+   }
+
+
+   // The thread's recently used sites, found without the lock. A hit is verified on the content:
+   // the caller's strings can be temporaries whose addresses are reused
+   struct CachedSite {
+      const char* file_path;
+      const char* function;
+      int line;
+      const g3::LogSite* site;
+   };
+   const size_t kCachedSites = 64;
+   thread_local CachedSite t_cached_sites[kCachedSites];
+
+   CachedSite& cachedSite(const char* file_path, int line, const char* function) {
+      const auto key = reinterpret_cast<uintptr_t>(file_path) ^ (reinterpret_cast<uintptr_t>(function) >> 3) ^ static_cast<uintptr_t>(line);
+      return t_cached_sites[(key ^ (key >> 11)) % kCachedSites];
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      const LogSite kSignalSite = {"", "", "", 0, 0};
+
+
+      const LogSite* registerSite(const char* file_path, size_t basename_offset, int line, const char* function) {
+         CachedSite& cached = cachedSite(file_path, line, function);
+         if (nullptr != cached.site && cached.file_path == file_path && cached.function == function
+               && sameSite(cached.site, file_path, line, function)) {
+            return cached.site;
+         }
+
+         const uint64_t hash = siteHash(file_path, line, function);
+         const LogSite* site = nullptr;
+         {
+            auto& sites = registry();
+            std::lock_guard<std::mutex> lock(sites.mutex);
+            auto range = sites.lookup.equal_range(hash);
+            for (auto found = range.first; found != range.second && nullptr == site; ++found) {
+               if (sameSite(found->second, file_path, line, function)) {
+                  site = found->second;
+               }
+            }
+
+            if (nullptr == site && sites.entries.size() < kMaxSites) {
+               const auto id = static_cast<uint32_t>(sites.entries.size() + 1);
+               sites.entries.emplace_back(file_path, basename_offset, line, function, id);
+               site = &sites.entries.back().site;
+               sites.lookup.emplace(hash, site);
+            }
+         }
+         if (nullptr == site) {
+            return &kOverflowSite; // not cached: the caller's line is kept by the LogMessage
+         }
+
+         cached = {file_path, function, line, site};
+         return site;
+      }
+
+      const LogSite* registerSite(const char* file_path, int line, const char* function) {
+         return registerSite(file_path, basenameOffset(file_path), line, function);
+      }
+   } // internal
+} // g3
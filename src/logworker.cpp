@@ -12,11 +12,14 @@
 #include "g3log/g3log.hpp"
 #include "g3log/future.hpp"
 #include "g3log/crashhandler.hpp"
+#include "g3log/messagepool.hpp"
 #ifdef HAVE_SYS_UTSNAME_H
 #include <sys/utsname.h>
 #endif
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 
 static const std::string GetHostName() {
@@ -80,22 +83,259 @@ static const std::string DefaultLogPrefix(const std::string& argv0) {
 }
 
 namespace g3 {
+   namespace {
+      // max messages in one batch to the sinks
+      const size_t kMaxBatchSize = 1024;
+   } // anonymous
+
+   LogWorkerImpl::LogWorkerImpl(const LogWorkerOptions& options)
+      : _options(options)
+      , _dropped(0)
+      , _dropped_reported(0)
+      , _batching(true)
+      , _bg(kjellkod::Active::createActive()) {
+      if (options.per_thread_rings) {
+         auto forward_batch = [this](g3::internal::ThreadRings::Batch batch) {
+            if (_options.max_queue_size > 0) {
+               for (auto& entry : *batch) {
+                  enqueue(std::move(entry));
+               }
+               return;
+            }
+            _bg->send([this, batch] {
+               for (auto& entry : *batch) {
+                  bgSave(LogMessagePtr {std::move(entry)});
+               }
+            });
+         };
+         auto forward_fatal = [this](FatalMessagePtr fatal_message) { fatal(fatal_message); };
+         _rings.reset(new g3::internal::ThreadRings(options.ring_capacity, forward_batch, forward_fatal));
+      }
+      if (!options.flight_recorder_file.empty()) {
+         _recorder.reset(new g3::internal::FlightRecorder(options.flight_recorder_file, options.flight_recorder_bytes));
+      }
+      if (options.telemetry) {
+         _telemetry.reset(new g3::internal::WorkerTelemetry);
+      }
+      if (options.max_queue_size > 0) {
+         _sink_backlog = std::make_shared<SinkBacklog>();
+      }
+   }
 
-   LogWorkerImpl::LogWorkerImpl() : _bg(kjellkod::Active::createActive()) { }
+   void LogWorkerImpl::save(std::unique_ptr<LogMessage> message) {
+      if (_options.max_queue_size > 0) {
+         enqueue(std::move(message));
+         return;
+      }
+      LogMessagePtr msg {std::move(message)};
+      _bg->send([this, msg] {bgSave(msg); });
+   }
+
+   void LogWorkerImpl::fatal(FatalMessagePtr fatal_message) {
+      // the bounded queue is drained first, the fatal message must be the last message
+      _bg->send([this, fatal_message] {
+         bgDrainPending();
+         bgFatal(fatal_message);
+      });
+   }
+
+   // Bounded queue. The background worker is only notified when the queue goes from empty to
+   // non-empty, it then drains the whole queue in one go
+   void LogWorkerImpl::enqueue(std::unique_ptr<LogMessage> message) {
+      std::unique_lock<std::mutex> lock(_pending_mutex);
+      if (_pending.size() >= _options.max_queue_size) {
+         bool wait_for_room = false;
+         switch (_options.overflow_policy) {
+            case OverflowPolicy::DropNewest:
+               ++_dropped;
+               return;
+            case OverflowPolicy::DropOldest:
+               _pending.pop_front();
+               ++_dropped;
+               break;
+            case OverflowPolicy::DropBelowLevel:
+               if (message->_level.value < _options.drop_below_level.value) {
+                  ++_dropped;
+                  return;
+               }
+               wait_for_room = true;
+               break;
+            case OverflowPolicy::Block:
+               wait_for_room = true;
+               break;
+         }
+         if (wait_for_room) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            _pending_room.wait(lock, [this] { return _pending.size() < _options.max_queue_size; });
+            if (_telemetry) {
+               _telemetry->waitedForRoom(std::chrono::high_resolution_clock::now() - start);
+            }
+         }
+      }
+
+      const bool notify_bg = _pending.empty();
+      _pending.push_back(std::move(message));
+      lock.unlock();
+      if (notify_bg) {
+         _bg->send([this] {bgDrainPending(); });
+      }
+   }
+
+   // The messages that were queued at the wakeup are drained in chunks, each as large as the
+   // room left at the sinks. The messages in flight are then at most max_queue_size in the
+   // queue and max_queue_size taken by the background worker or waiting for the sinks
+   void LogWorkerImpl::bgDrainPending() {
+      bgFlushBatch();
+      size_t to_drain = 0;
+      {
+         std::lock_guard<std::mutex> lock(_pending_mutex);
+         to_drain = _pending.size();
+      }
+
+      bool drained_all = true;
+      while (to_drain > 0) {
+         const size_t room = bgWaitForSinkRoom();
+         std::deque<std::unique_ptr<LogMessage>> drained;
+         {
+            std::lock_guard<std::mutex> lock(_pending_mutex);
+            if (room >= _pending.size()) {
+               drained.swap(_pending);
+            } else {
+               for (size_t index = 0; index < room; ++index) {
+                  drained.push_back(std::move(_pending.front()));
+                  _pending.pop_front();
+               }
+            }
+            // a queue that is never empty gets no new wakeup from the logging threads
+            drained_all = _pending.empty();
+         }
+         _pending_room.notify_all();
+         if (drained.empty()) {
+            break; // emptied by OverflowPolicy::DropOldest meanwhile
+         }
+
+         to_drain -= std::min(to_drain, drained.size());
+         for (auto& message : drained) {
+            bgSave(LogMessagePtr {std::move(message)});
+         }
+         bgFlushBatch();
+      }
+      if (!drained_all) {
+         _bg->send([this] {bgDrainPending(); });
+      }
+
+      // The pressure has subsided if the queue is still empty. Report the dropped messages
+      // The drops are counted under the same lock. Any later drop needs a full queue, which
+      // means another drain will follow and report it
+      bool subsided = false;
+      size_t dropped = 0;
+      {
+         std::lock_guard<std::mutex> lock(_pending_mutex);
+         subsided = _pending.empty();
+         dropped = _dropped.load();
+      }
+      if (subsided && dropped != _dropped_reported) {
+         std::unique_ptr<LogMessage> summary {new LogMessage(__FILE__, __LINE__, __FUNCTION__, G3LOG_WARNING)};
+         summary->write().append(std::to_string(dropped - _dropped_reported)).append(" messages dropped");
+         _dropped_reported = dropped;
+         if (_telemetry) {
+            _telemetry->enqueued();
+         }
+         bgSave(LogMessagePtr {std::move(summary)});
+      }
+   }
 
    void LogWorkerImpl::bgSave(g3::LogMessagePtr msgPtr) {
-      std::unique_ptr<LogMessage> uniqueMsg(std::move(msgPtr.get()));
+      // LOG_FAST messages are formatted here, off the calling thread
+      msgPtr.get()->formatFastMessage();
+      if (_telemetry) {
+         _telemetry->taken(*msgPtr.get());
+      }
+      // FLAGS_stderrthreshold: one copy per message, whatever the sinks. With FLAGS_logtostderr
+      // or FLAGS_alsologtostderr the file sinks write every message to stderr already
+      if (msgPtr.get()->_level.value >= FLAGS_stderrthreshold && !FLAGS_logtostderr && !FLAGS_alsologtostderr) {
+         std::cerr << msgPtr.get()->toString() << std::flush;
+      }
+
+      // one read-only message is shared by all sinks. It goes back to the pool when they are done with it
+      std::shared_ptr<const LogMessage> sharedMsg(msgPtr.get().release(), g3::internal::recycleLogMessage);
+
+      // The batch is flushed after all the work that is already queued for the background worker,
+      // i.e. everything drained in this wakeup goes to the sinks in one go
+      const bool first_in_batch = _batch.empty();
+      _batch.push_back(LogMessageMover(sharedMsg));
+      if (!_batching || _batch.size() >= kMaxBatchSize) {
+         bgFlushBatch();
+      } else if (first_in_batch) {
+         _bg->send([this] {bgFlushBatch(); });
+      }
+   }
 
+   void LogWorkerImpl::bgFlushBatch() {
+      if (_batch.empty()) {
+         return;
+      }
+
+      auto batch = bgNewSinkBatch(_batch.size());
+      batch->swap(_batch);
+      if (_telemetry) {
+         _telemetry->sentToSinks(batch->size(), _dropped.load());
+      }
       for (auto& sink : _sinks) {
-         LogMessage msg(*(uniqueMsg));
-         sink->send(LogMessageMover(std::move(msg)));
+         if (sink->telemetry) {
+            sink->telemetry->received(batch->size());
+         }
+         sink->sendBatch(batch);
       }
 
       if (_sinks.empty()) {
-         std::string err_msg {"g3logworker has no sinks. Message: ["};
-         err_msg.append(uniqueMsg.get()->toString()).append("]\n");
-         std::cerr << err_msg;
+         for (auto& message : *batch) {
+            std::string err_msg {"g3logworker has no sinks. Message: ["};
+            err_msg.append(message.get().toString()).append("]\n");
+            std::cerr << err_msg;
+         }
+      }
+   }
+
+   // With the bounded queue the background worker waits while the sinks are max_queue_size
+   // messages behind. It stops draining the queue meanwhile, and the overflow policy applies
+   // to the logging threads. @return how many more messages the sinks can be sent
+   size_t LogWorkerImpl::bgWaitForSinkRoom() {
+      if (!_sink_backlog || _sinks.empty()) {
+         return std::numeric_limits<size_t>::max();
+      }
+
+      std::unique_lock<std::mutex> lock(_sink_backlog->mutex);
+      auto has_room = [this] {
+         return _sink_backlog->messages < _options.max_queue_size;
+      };
+      if (!has_room()) {
+         const auto start = std::chrono::high_resolution_clock::now();
+         _sink_backlog->done.wait(lock, has_room);
+         if (_telemetry) {
+            _telemetry->waitedForSinks(std::chrono::high_resolution_clock::now() - start);
+         }
       }
+      return _options.max_queue_size - _sink_backlog->messages;
+   }
+
+   // The messages count until the last sink has released the batch, ref: bgWaitForSinkRoom
+   std::shared_ptr<LogMessageBatch> LogWorkerImpl::bgNewSinkBatch(size_t messages) {
+      if (!_sink_backlog || _sinks.empty()) {
+         return std::make_shared<LogMessageBatch>();
+      }
+
+      auto backlog = _sink_backlog;
+      {
+         std::lock_guard<std::mutex> lock(backlog->mutex);
+         backlog->messages += messages;
+      }
+      return std::shared_ptr<LogMessageBatch>(new LogMessageBatch, [backlog, messages](LogMessageBatch * batch) {
+         delete batch;
+         std::lock_guard<std::mutex> lock(backlog->mutex);
+         backlog->messages -= messages;
+         backlog->done.notify_all();
+      });
    }
 
    void LogWorkerImpl::bgFatal(FatalMessagePtr msgPtr) {
@@ -118,10 +358,13 @@ namespace g3 {
       uniqueMsg->write().append("). ").append(exiting).append(" ").append(reason)
       .append("\nLog content flushed sucessfully to sink\n\n");
 
+      // all messages before the fatal message are sent to the sinks first
+      bgFlushBatch();
+
       std::cerr << uniqueMsg->toString() << std::flush;
+      std::shared_ptr<const LogMessage> sharedMsg(std::move(uniqueMsg));
       for (auto& sink : _sinks) {
-         LogMessage msg(*(uniqueMsg));
-         sink->send(LogMessageMover(std::move(msg)));
+         sink->send(LogMessageMover(sharedMsg));
       }
 
 
@@ -137,6 +380,12 @@ namespace g3 {
    LogWorker::~LogWorker() {
       g3::internal::shutDownLoggingForActiveOnly(this);
 
+      // all messages still in the per thread rings are forwarded to the background worker
+      // before the sinks are cleared below
+      if (_impl._rings) {
+         _impl._rings->stop();
+      }
+
       // The sinks WILL automatically be cleared at exit of this destructor
       // However, the waiting below ensures that all messages until this point are taken care of
       // before any internals/LogWorkerImpl of LogWorker starts to be destroyed.
@@ -146,7 +395,12 @@ namespace g3 {
       //   Any messages put into the queue will be OK due to:
       //  *) If it is before the wait below then they will be executed
       //  *) If it is AFTER the wait below then they will be ignored and NEVER executed
-      auto bg_clear_sink_call = [this] { _impl._sinks.clear(); };
+      auto bg_clear_sink_call = [this] {
+         _impl.bgDrainPending();
+         _impl.bgFlushBatch();
+         _impl._batching = false; // the background worker is soon gone. Any late message is sent right away
+         _impl._sinks.clear();
+      };
       auto token_cleared = g3::spawn_task(bg_clear_sink_call, _impl._bg.get());
       token_cleared.wait();
 
@@ -167,21 +421,64 @@ namespace g3 {
    }
 
    void LogWorker::save(LogMessagePtr msg) {
-      _impl._bg->send([this, msg] {_impl.bgSave(msg); });
+      if (_impl._telemetry) {
+         _impl._telemetry->enqueued();
+      }
+      if (_impl._recorder) {
+         _impl._recorder->record(*msg.get());
+      }
+      if (_impl._rings) {
+         _impl._rings->save(msg);
+         return;
+      }
+      _impl.save(std::move(msg.get()));
    }
 
    void LogWorker::fatal(FatalMessagePtr fatal_message) {
-      _impl._bg->send([this, fatal_message] {_impl.bgFatal(fatal_message); });
+      if (_impl._recorder) {
+         _impl._recorder->record(*fatal_message.get());
+      }
+      if (_impl._rings) {
+         _impl._rings->fatal(fatal_message);
+         return;
+      }
+      _impl.fatal(fatal_message);
+   }
+
+   size_t LogWorker::droppedMessages() const {
+      // the rings drop the messages that are saved while the LogWorker shuts down
+      const size_t dropped_by_rings = _impl._rings ? _impl._rings->dropped() : 0;
+      return _impl._dropped.load() + dropped_by_rings;
+   }
+
+   LogWorkerStats LogWorker::stats() const {
+      if (_impl._telemetry) {
+         return _impl._telemetry->snapshot(droppedMessages());
+      }
+      LogWorkerStats stats;
+      stats.dropped = droppedMessages();
+      return stats;
    }
 
    void LogWorker::addWrappedSink(std::shared_ptr<g3::internal::SinkWrapper> sink) {
-      auto bg_addsink_call = [this, sink] {_impl._sinks.push_back(sink);};
+      if (_impl._telemetry) {
+         sink->telemetry = std::make_shared<g3::internal::SinkTelemetry>();
+         _impl._telemetry->addSink(sink->telemetry);
+      }
+      auto bg_addsink_call = [this, sink] {
+         _impl.bgFlushBatch(); // the new sink only gets messages saved after it was added
+         _impl._sinks.push_back(sink);
+      };
       auto token_done = g3::spawn_task(bg_addsink_call, _impl._bg.get());
       token_done.wait();
    }
 
    std::unique_ptr<LogWorker> LogWorker::createLogWorker() {
-      return std::unique_ptr<LogWorker>(new LogWorker);
+      return createLogWorker(LogWorkerOptions());
+   }
+
+   std::unique_ptr<LogWorker> LogWorker::createLogWorker(const LogWorkerOptions& options) {
+      return std::unique_ptr<LogWorker>(new LogWorker(options));
    }
 
    std::unique_ptr<FileSinkHandle>LogWorker::addDefaultLogger(const std::string& argv0, const std::string& log_directory, const std::string& default_id) {
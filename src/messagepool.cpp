@@ -0,0 +1,122 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/messagepool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+   typedef std::vector<std::unique_ptr<g3::LogMessage>> Messages;
+
+   // messages moved between a thread's cache and the shared list at a time
+   const size_t kChunk = 32;
+   // most messages kept in the shared list, the rest are deleted
+   const size_t kMaxPooled = 4096;
+
+   struct SharedPool {
+      std::mutex mutex;
+      Messages messages;
+   };
+
+   // never destroyed: the sinks can give back messages while the statics are destroyed
+   SharedPool& sharedPool() {
+      static SharedPool* pool = new SharedPool;
+      return *pool;
+   }
+
+   // moves up to count messages from the back of one list to the other
+   void moveMessages(Messages& from, Messages& to, size_t count) {
+      count = std::min(count, from.size());
+      std::move(from.end() - count, from.end(), std::back_inserter(to));
+      from.resize(from.size() - count);
+   }
+
+   struct ThreadCache {
+      Messages messages;
+
+      ThreadCache() {
+         messages.reserve(2 * kChunk);
+      }
+
+      ~ThreadCache();
+   };
+
+   // trivial, still readable while the thread's cache is destroyed at thread exit
+   thread_local bool t_cache_gone = false;
+   thread_local ThreadCache t_cache;
+
+   ThreadCache::~ThreadCache() {
+      t_cache_gone = true;
+      SharedPool& pool = sharedPool();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      moveMessages(messages, pool.messages, kMaxPooled - std::min(kMaxPooled, pool.messages.size()));
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      std::unique_ptr<LogMessage> takeLogMessage(const LogSite* site, const LEVELS& level) {
+         if (t_cache_gone) {
+            return std::unique_ptr<LogMessage>(new LogMessage(site, level));
+         }
+
+         Messages& cache = t_cache.messages;
+         if (cache.empty()) {
+            SharedPool& pool = sharedPool();
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            moveMessages(pool.messages, cache, kChunk);
+         }
+         if (cache.empty()) {
+            return std::unique_ptr<LogMessage>(new LogMessage(site, level));
+         }
+
+         std::unique_ptr<LogMessage> message = std::move(cache.back());
+         cache.pop_back();
+         message->_timestamp = std::chrono::high_resolution_clock::now();
+         message->_call_thread_id = std::this_thread::get_id();
+         message->_site = site;
+         message->_line = site->line;
+         message->_level = level;
+         message->_expression.clear();
+         message->_message.clear();
+         message->_fast_format = nullptr;
+         return message;
+      }
+
+
+      void recycleLogMessage(const LogMessage* message) {
+         if (nullptr == message) {
+            return;
+         }
+         std::unique_ptr<LogMessage> recycled(const_cast<LogMessage*>(message));
+         if (t_cache_gone || recycled->_message.capacity() > kMaxKeptCapacity
+               || recycled->_expression.capacity() > kMaxKeptCapacity) {
+            return;
+         }
+
+         Messages& cache = t_cache.messages;
+         cache.push_back(std::move(recycled));
+         if (cache.size() < 2 * kChunk) {
+            return;
+         }
+
+         SharedPool& pool = sharedPool();
+         std::lock_guard<std::mutex> lock(pool.mutex);
+         const size_t room = kMaxPooled - std::min(kMaxPooled, pool.messages.size());
+         moveMessages(cache, pool.messages, std::min(kChunk, room));
+         if (cache.size() >= 2 * kChunk) {
+            cache.resize(kChunk); // the pool is full
+         }
+      }
+   } // internal
+} // g3
@@ -0,0 +1,293 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+
+#include "g3log/mmapfilesink.hpp"
+#include "filesinkhelper.ipp"
+#include "g3log/g3log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+   const std::chrono::seconds kSyncInterval {1};
+
+   size_t pageSize() {
+      static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      return size;
+   }
+
+   size_t roundUpToPage(size_t bytes) {
+      const size_t page = pageSize();
+      return ((std::max(bytes, page) + page - 1) / page) * page;
+   }
+
+   int openLogFd(const std::string &file_with_path) {
+      const int fd = ::open(file_with_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (fd < 0) {
+         std::cerr << "FILE ERROR:  could not open log file:[" << file_with_path << "] " << std::strerror(errno) << std::endl;
+      }
+      return fd;
+   }
+
+   // makes sure that the file has disk space for [offset, offset + bytes)
+   bool reserve(int fd, size_t offset, size_t bytes) {
+#if defined(__linux__)
+      const int result = posix_fallocate(fd, static_cast<off_t>(offset), static_cast<off_t>(bytes));
+      if (0 == result) {
+         return true;
+      }
+      if (EINVAL != result && EOPNOTSUPP != result) {
+         return false; // e.g. ENOSPC
+      }
+      // the file system does not support fallocate
+#endif
+      return 0 == ::ftruncate(fd, static_cast<off_t>(offset + bytes));
+   }
+} // anonymous
+
+
+namespace g3 {
+   using namespace internal;
+
+
+   MmapFileSink::MmapFileSink(const std::string &log_prefix, const std::string &log_directory, const std::string &logger_id,
+                              size_t chunk_bytes, const LogLayout &layout)
+      : _log_file_with_path(log_directory)
+      , _log_prefix_backup(log_prefix)
+      , _chunk_bytes(roundUpToPage(chunk_bytes))
+      , _layout(layout)
+      , _fd(-1)
+      , _mapping(nullptr)
+      , _mapping_offset(0)
+      , _written(0)
+      , _last_sync(std::chrono::steady_clock::now())
+      , _write_failed(false) {
+      _log_prefix_backup = prefixSanityFix(log_prefix);
+      if (!isValidFilename(_log_prefix_backup)) {
+         std::cerr << "g3log: forced abort due to illegal log prefix [" << log_prefix << "]" << std::endl;
+         abort();
+      }
+
+      std::string file_name = createLogFileName(_log_prefix_backup, logger_id);
+      _log_file_with_path = pathSanityFix(_log_file_with_path, file_name);
+      int fd = openLogFd(_log_file_with_path);
+      if (fd < 0) {
+         std::cerr << "Cannot write log file to location, attempting current directory" << std::endl;
+         _log_file_with_path = "./" + file_name;
+         fd = openLogFd(_log_file_with_path);
+      }
+      assert(fd >= 0 && "cannot open log file at startup");
+      useFile(fd, _log_file_with_path);
+      append(header());
+   }
+
+
+   MmapFileSink::~MmapFileSink() {
+      std::string exit_msg {"g3log g3MmapFileSink shutdown at: "};
+      auto now = std::chrono::system_clock::now();
+      exit_msg.append(localtime_formatted(now, internal::time_formatted)).append("\n");
+      append(exit_msg);
+      closeFile();
+
+      exit_msg.append("Log file at: [").append(_log_file_with_path).append("]\n");
+      std::cerr << exit_msg << std::flush;
+   }
+
+
+   // The actual log receiving function
+   void MmapFileSink::fileWrite(LogMessageMover message) {
+      const LogMessage &entry = message.get();
+      _line.clear();
+      _layout.format(entry, _line);
+      if (FLAGS_logtostderr || FLAGS_alsologtostderr) {
+         std::cerr << _line << std::flush;
+      }
+
+      if (FLAGS_logtostderr) return;
+
+      const bool sync_due = std::chrono::steady_clock::now() - _last_sync >= kSyncInterval;
+      if (sync_due) {
+         followTruncation();
+      }
+      append(_line);
+
+      // The mapped pages survive a crash of the process, but not of the machine.
+      // A FATAL entry is the last one before the process exits, it is synced right away
+      if (entry.wasFatal()) {
+         sync(MS_SYNC);
+      } else if (sync_due) {
+         sync(MS_ASYNC);
+      }
+   }
+
+
+   std::string MmapFileSink::changeLogFile(const std::string &directory, const std::string &logger_id) {
+      auto now = std::chrono::system_clock::now();
+      auto now_formatted = g3::localtime_formatted(now, {internal::date_formatted + " " + internal::time_formatted});
+
+      std::string file_name = createLogFileName(_log_prefix_backup, logger_id);
+      std::string prospect_log = directory + file_name;
+      const int fd = openLogFd(prospect_log);
+      if (fd < 0) {
+         append("\n" + now_formatted + " Unable to change log file. Illegal filename or busy? Unsuccessful log name was: " + prospect_log);
+         return {}; // no success
+      }
+
+      std::string old_log = _log_file_with_path;
+      append(now_formatted + "\n\tChanging log file from : " + old_log + "\n\tto new location: " + prospect_log + "\n");
+      closeFile();
+
+      _log_file_with_path = prospect_log;
+      useFile(fd, _log_file_with_path);
+      append(header());
+      append(now_formatted + "\n\tNew log file. The previous log file was at: " + old_log + "\n");
+      return _log_file_with_path;
+   }
+
+
+   std::string MmapFileSink::fileName() {
+      return _log_file_with_path;
+   }
+
+
+   void MmapFileSink::flush() {
+      sync(MS_SYNC);
+   }
+
+
+   void MmapFileSink::useFile(int fd, const std::string &file_with_path) {
+      _fd = fd;
+      _mapping = nullptr;
+      _mapping_offset = 0;
+      _written = 0;
+      if (false == setSymlink(file_with_path)) {
+         std::cerr << "SYMLINK ERROR: could not set symlink for the latest log file!\n" << std::flush;
+      }
+   }
+
+
+   // the pre-extended, unwritten, tail of the file is cut away
+   void MmapFileSink::closeFile() {
+      unmapChunk();
+      if (_fd >= 0) {
+         if (0 != ::ftruncate(_fd, static_cast<off_t>(_written))) {
+            std::cerr << "FILE ERROR: could not truncate log file:[" << _log_file_with_path << "]" << std::endl;
+         }
+         ::close(_fd);
+         _fd = -1;
+      }
+   }
+
+
+   // A file truncated by another process is shorter than what is mapped, or written. The mapping
+   // is dropped before it is written to, and the writing goes on from the new end of the file
+   void MmapFileSink::followTruncation() {
+      struct stat status;
+      if (_fd < 0 || 0 != ::fstat(_fd, &status)) {
+         return;
+      }
+      const size_t size = static_cast<size_t>(status.st_size);
+      const size_t expected = (nullptr == _mapping) ? _written : _mapping_offset + _chunk_bytes;
+      if (size >= expected) {
+         return;
+      }
+
+      unmapChunk();
+      if (size < _written) {
+         std::cerr << "FILE ERROR: log file:[" << _log_file_with_path << "] was truncated by another process from "
+                   << _written << " to " << size << " bytes" << std::endl;
+         _written = size;
+      }
+   }
+
+
+   // maps the chunk that starts at the page of the next byte to write
+   bool MmapFileSink::mapChunk() {
+      followTruncation();
+      unmapChunk();
+      if (_fd < 0) {
+         return false;
+      }
+
+      const size_t offset = _written - (_written % pageSize());
+      if (!reserve(_fd, offset, _chunk_bytes)) {
+         return false;
+      }
+      void *mapping = ::mmap(nullptr, _chunk_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+      if (MAP_FAILED == mapping) {
+         return false;
+      }
+      _mapping = static_cast<char *>(mapping);
+      _mapping_offset = offset;
+      return true;
+   }
+
+
+   void MmapFileSink::unmapChunk() {
+      if (nullptr != _mapping) {
+         ::munmap(_mapping, _chunk_bytes);
+         _mapping = nullptr;
+      }
+   }
+
+
+   void MmapFileSink::sync(int flags) {
+      _last_sync = std::chrono::steady_clock::now();
+      if (nullptr != _mapping && _written > _mapping_offset) {
+         ::msync(_mapping, _written - _mapping_offset, flags);
+      }
+   }
+
+
+   // pwrite can write less than asked for, it is repeated until all is written or it fails
+   void MmapFileSink::writeWithoutMapping(const char *data, size_t size) {
+      while (size > 0 && _fd >= 0) {
+         const ssize_t bytes = ::pwrite(_fd, data, size, static_cast<off_t>(_written));
+         if (bytes < 0 && EINTR == errno) {
+            continue;
+         }
+         if (bytes <= 0) {
+            if (!_write_failed) {
+               std::cerr << "FILE ERROR: could not write to log file:[" << _log_file_with_path << "] "
+                         << std::strerror(errno) << std::endl;
+               _write_failed = true;
+            }
+            return;
+         }
+         _written += static_cast<size_t>(bytes);
+         data += bytes;
+         size -= static_cast<size_t>(bytes);
+      }
+      _write_failed = false;
+   }
+
+
+   void MmapFileSink::append(const char *data, size_t size) {
+      while (size > 0) {
+         if (nullptr == _mapping || _written >= _mapping_offset + _chunk_bytes) {
+            if (!mapChunk()) {
+               // no new chunk, e.g. the disk is full. Written without the mapping instead
+               writeWithoutMapping(data, size);
+               return;
+            }
+         }
+
+         const size_t bytes = std::min(size, _mapping_offset + _chunk_bytes - _written);
+         std::memcpy(_mapping + (_written - _mapping_offset), data, bytes);
+         _written += bytes;
+         data += bytes;
+         size -= bytes;
+      }
+   }
+} // g3
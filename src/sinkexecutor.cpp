@@ -0,0 +1,162 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/sinkexecutor.hpp"
+
+#include <algorithm>
+
+namespace {
+   // a strand runs at most this many calls before the other strands of its worker get a turn
+   const size_t kCallsPerTurn = 64;
+
+   // the executor and worker index of a worker thread
+   thread_local const g3::SinkExecutor* tl_executor = nullptr;
+   thread_local size_t tl_worker_index = 0;
+} // anonymous
+
+
+namespace g3 {
+   std::shared_ptr<SinkExecutor> SinkExecutor::create(size_t threads) {
+      if (0 == threads) {
+         threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+      std::shared_ptr<SinkExecutor> executor(new SinkExecutor(threads));
+      for (size_t index = 0; index < threads; ++index) {
+         executor->_threads.emplace_back(&SinkExecutor::run, executor.get(), index);
+      }
+      return executor;
+   }
+
+
+   SinkExecutor::SinkExecutor(size_t threads)
+      : _next_worker(0)
+      , _scheduled(0)
+      , _stop(false) {
+      for (size_t index = 0; index < threads; ++index) {
+         _workers.emplace_back(new Worker);
+      }
+   }
+
+
+   SinkExecutor::~SinkExecutor() {
+      {
+         std::lock_guard<std::mutex> lock(_idle_mutex);
+         _stop = true;
+      }
+      _idle.notify_all();
+      for (auto& thread : _threads) {
+         thread.join();
+      }
+   }
+
+
+   // a worker keeps its own strands, other threads spread them over the workers.
+   // The strand is counted before it is published: a take() of it must not decrement first
+   void SinkExecutor::schedule(internal::SinkStrand* strand) {
+      const size_t index = (this == tl_executor) ? tl_worker_index : _next_worker.fetch_add(1) % _workers.size();
+      {
+         std::lock_guard<std::mutex> lock(_idle_mutex);
+         ++_scheduled;
+      }
+      {
+         std::lock_guard<std::mutex> lock(_workers[index]->mutex);
+         _workers[index]->strands.push_back(strand);
+      }
+      _idle.notify_one();
+   }
+
+
+   // the oldest strand of the own deque, or the newest one of another worker's deque
+   internal::SinkStrand* SinkExecutor::take(size_t index) {
+      for (size_t offset = 0; offset < _workers.size(); ++offset) {
+         Worker& worker = *_workers[(index + offset) % _workers.size()];
+         std::lock_guard<std::mutex> lock(worker.mutex);
+         if (worker.strands.empty()) {
+            continue;
+         }
+         internal::SinkStrand* strand = nullptr;
+         if (0 == offset) {
+            strand = worker.strands.front();
+            worker.strands.pop_front();
+         } else {
+            strand = worker.strands.back();
+            worker.strands.pop_back();
+         }
+         --_scheduled;
+         return strand;
+      }
+      return nullptr;
+   }
+
+
+   void SinkExecutor::run(size_t index) {
+      tl_executor = this;
+      tl_worker_index = index;
+      while (true) {
+         internal::SinkStrand* strand = take(index);
+         if (nullptr == strand) {
+            std::unique_lock<std::mutex> lock(_idle_mutex);
+            _idle.wait(lock, [this] { return _stop || _scheduled.load() > 0; });
+            if (_stop && 0 == _scheduled.load()) {
+               return;
+            }
+            continue;
+         }
+
+         if (strand->runSome()) {
+            schedule(strand);
+         }
+      }
+   }
+
+
+
+   namespace internal {
+      SinkStrand::SinkStrand(std::shared_ptr<SinkExecutor> executor)
+         : _executor(std::move(executor))
+         , _scheduled(false) {}
+
+
+      SinkStrand::~SinkStrand() {
+         std::unique_lock<std::mutex> lock(_mutex);
+         _idle.wait(lock, [this] { return !_scheduled; });
+      }
+
+
+      void SinkStrand::send(kjellkod::Callback call) {
+         {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _calls.push_back(std::move(call));
+            if (_scheduled) {
+               return; // runs after the calls before it
+            }
+            _scheduled = true;
+         }
+         _executor->schedule(this);
+      }
+
+
+      bool SinkStrand::runSome() {
+         for (size_t count = 0; count < kCallsPerTurn; ++count) {
+            kjellkod::Callback call;
+            {
+               std::lock_guard<std::mutex> lock(_mutex);
+               if (_calls.empty()) {
+                  _scheduled = false;
+                  _idle.notify_all(); // the strand must not be touched after this
+                  return false;
+               }
+               call = std::move(_calls.front());
+               _calls.pop_front();
+            }
+            call();
+         }
+         return true;
+      }
+   } // internal
+} // g3
@@ -0,0 +1,348 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/telemetry.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace g3 {
+   namespace internal {
+      // padded to a cache line of its own on each side: the count is written by one thread only
+      struct PerThreadCounter::Slot {
+         char padding_before[64];
+         std::atomic<uint64_t> count;
+         std::atomic<bool> thread_gone;
+         char padding_after[64];
+
+         Slot() : count(0), thread_gone(false) {}
+      };
+   } // internal
+} // g3
+
+
+namespace {
+   std::atomic<uint64_t> g_counter_id{0};
+
+   // counters that a thread adds to without registering again, e.g. those of two LogWorkers
+   const size_t kThreadSlots = 4;
+
+   // The calling thread's counter slots, one per counter. A thread that adds to more counters
+   // gives up the slot it registered the longest ago, and lazily registers again if needed.
+   // A trivial type for the fast path: one thread_local lookup, no init or exit guard at each add
+   struct ThreadLocalFastSlots {
+      struct Entry {
+         uint64_t owner_id;
+         g3::internal::PerThreadCounter::Slot* slot;
+      };
+      Entry entries[kThreadSlots];
+      size_t next_replaced;
+   };
+#if (defined(__GNUC__) || defined(__clang__)) && !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+   // initial-exec: a fixed offset from the thread pointer, no __tls_get_addr call in the shared library
+   __attribute__((tls_model("initial-exec")))
+#endif
+   thread_local ThreadLocalFastSlots t_fast_slots = {};
+
+   // keeps the slots alive, and hands them over to new threads when this thread exits
+   struct ThreadLocalSlots {
+      std::shared_ptr<g3::internal::PerThreadCounter::Slot> slots[kThreadSlots];
+
+      void reset(size_t index) {
+         if (slots[index]) {
+            slots[index]->thread_gone.store(true, std::memory_order_release);
+         }
+         slots[index].reset();
+         t_fast_slots.entries[index] = {0, nullptr};
+      }
+
+      ~ThreadLocalSlots() {
+         for (size_t index = 0; index < kThreadSlots; ++index) {
+            reset(index);
+         }
+      }
+   };
+
+   thread_local ThreadLocalSlots t_slots;
+
+
+   unsigned highestBit(uint64_t value) {
+      unsigned bit = 0;
+      while (value >>= 1) {
+         ++bit;
+      }
+      return bit;
+   }
+
+   // [0, 2*kSubBuckets): one counter per value. Above: kSubBuckets counters per power of two
+   size_t bucketIndex(uint64_t value) {
+      using g3::internal::AtomicLatencyHistogram;
+      if (value < 2 * AtomicLatencyHistogram::kSubBuckets) {
+         return static_cast<size_t>(value);
+      }
+      const unsigned shift = highestBit(value) - AtomicLatencyHistogram::kSubBucketBits;
+      return static_cast<size_t>(shift * AtomicLatencyHistogram::kSubBuckets + (value >> shift));
+   }
+
+   uint64_t highestValueAt(size_t index) {
+      using g3::internal::AtomicLatencyHistogram;
+      if (index < 2 * AtomicLatencyHistogram::kSubBuckets) {
+         return index;
+      }
+      const unsigned shift = static_cast<unsigned>(index / AtomicLatencyHistogram::kSubBuckets) - 1;
+      const uint64_t top = index - shift * AtomicLatencyHistogram::kSubBuckets;
+      return ((top + 1) << shift) - 1;
+   }
+
+   // a value from the single writer thread, no read-modify-write needed
+   void addRelaxed(std::atomic<uint64_t>& value, uint64_t count) {
+      value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      PerThreadCounter::PerThreadCounter()
+         : _id(++g_counter_id) {}
+
+
+      void PerThreadCounter::add(uint64_t count) {
+         ThreadLocalFastSlots& fast = t_fast_slots;
+         for (size_t index = 0; index < kThreadSlots; ++index) {
+            if (fast.entries[index].owner_id == _id) {
+               addRelaxed(fast.entries[index].slot->count, count);
+               return;
+            }
+         }
+         addRelaxed(registerThread().count, count);
+      }
+
+
+      // a free entry of the thread, else the one registered the longest ago
+      PerThreadCounter::Slot& PerThreadCounter::registerThread() {
+         ThreadLocalFastSlots& fast = t_fast_slots;
+         size_t index = 0;
+         while (index < kThreadSlots && nullptr != fast.entries[index].slot) {
+            ++index;
+         }
+         if (kThreadSlots == index) {
+            index = fast.next_replaced;
+            fast.next_replaced = (fast.next_replaced + 1) % kThreadSlots;
+         }
+         t_slots.reset(index);
+
+         std::shared_ptr<Slot> slot;
+         {
+            std::lock_guard<std::mutex> lock(_slots_mutex);
+            for (auto& candidate : _slots) {
+               if (candidate->thread_gone.load(std::memory_order_acquire)) {
+                  slot = candidate;
+                  slot->thread_gone.store(false, std::memory_order_relaxed);
+                  break;
+               }
+            }
+            if (!slot) {
+               slot = std::make_shared<Slot>();
+               _slots.push_back(slot);
+            }
+         }
+         t_slots.slots[index] = slot;
+         fast.entries[index] = {_id, slot.get()};
+         return *slot;
+      }
+
+
+      uint64_t PerThreadCounter::sum() const {
+         std::lock_guard<std::mutex> lock(_slots_mutex);
+         uint64_t total = 0;
+         for (const auto& slot : _slots) {
+            total += slot->count.load(std::memory_order_relaxed);
+         }
+         return total;
+      }
+
+
+
+      AtomicLatencyHistogram::AtomicLatencyHistogram()
+         : _counts((65 - kSubBucketBits) * kSubBuckets)
+         , _max(0) {
+         for (auto& count : _counts) {
+            count.store(0, std::memory_order_relaxed);
+         }
+      }
+
+
+      void AtomicLatencyHistogram::record(uint64_t nanoseconds) {
+         addRelaxed(_counts[bucketIndex(nanoseconds)], 1);
+         if (nanoseconds > _max.load(std::memory_order_relaxed)) {
+            _max.store(nanoseconds, std::memory_order_relaxed);
+         }
+      }
+
+
+      void AtomicLatencyHistogram::addTo(std::vector<uint64_t>& counts, uint64_t& max) const {
+         counts.resize(_counts.size(), 0);
+         for (size_t index = 0; index < _counts.size(); ++index) {
+            counts[index] += _counts[index].load(std::memory_order_relaxed);
+         }
+         max = std::max(max, _max.load(std::memory_order_relaxed));
+      }
+
+
+      // each percentile is the highest value of its counter, but never above the max
+      LatencyStats AtomicLatencyHistogram::percentiles(const std::vector<uint64_t>& counts, uint64_t max) {
+         LatencyStats stats;
+         for (const auto count : counts) {
+            stats.count += count;
+         }
+         if (0 == stats.count) {
+            return stats;
+         }
+
+         struct Wanted {
+            double percent;
+            std::chrono::nanoseconds* value;
+         };
+         const Wanted wanted[] = {{50.0, &stats.p50}, {90.0, &stats.p90}, {99.0, &stats.p99}, {99.9, &stats.p999}};
+         const size_t kWanted = sizeof(wanted) / sizeof(wanted[0]);
+         size_t next = 0;
+         uint64_t seen = 0;
+         for (size_t index = 0; index < counts.size() && next < kWanted; ++index) {
+            seen += counts[index];
+            while (next < kWanted && seen >= std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(wanted[next].percent / 100.0 * stats.count)))) {
+               *wanted[next].value = std::chrono::nanoseconds(std::min(highestValueAt(index), max));
+               ++next;
+            }
+         }
+         stats.max = std::chrono::nanoseconds(max);
+         return stats;
+      }
+
+
+
+      SinkTelemetry::SinkTelemetry()
+         : _received(0)
+         , _processed(0)
+         , _busy_ns(0) {}
+
+
+      void SinkTelemetry::received(size_t count) {
+         addRelaxed(_received, count);
+      }
+
+
+      void SinkTelemetry::process(const LogMessageBatch& messages, const std::function<void(const LogMessageBatch&)>& call) {
+         const auto start = std::chrono::high_resolution_clock::now();
+         for (const auto& message : messages) {
+            const auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(start - message.get()._timestamp).count();
+            _latency.record(static_cast<uint64_t>(std::max<int64_t>(0, latency)));
+         }
+
+         call(messages);
+
+         const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+         addRelaxed(_busy_ns, static_cast<uint64_t>(std::max<int64_t>(0, busy)));
+         _processed.store(_processed.load(std::memory_order_relaxed) + messages.size(), std::memory_order_release);
+      }
+
+
+      SinkStats SinkTelemetry::snapshot() const {
+         SinkStats stats;
+         stats.processed = _processed.load(std::memory_order_acquire);
+         stats.received = std::max(stats.processed, _received.load(std::memory_order_relaxed));
+         stats.backlog = stats.received - stats.processed;
+         stats.busy_time = std::chrono::nanoseconds(_busy_ns.load(std::memory_order_relaxed));
+         std::vector<uint64_t> counts;
+         uint64_t max = 0;
+         _latency.addTo(counts, max);
+         stats.latency = AtomicLatencyHistogram::percentiles(counts, max);
+         return stats;
+      }
+
+
+
+      WorkerTelemetry::WorkerTelemetry()
+         : _processed(0)
+         , _high_water(0)
+         , _bytes(0)
+         , _room_waits(0)
+         , _room_wait_ns(0)
+         , _sink_waits(0)
+         , _sink_wait_ns(0) {}
+
+
+      void WorkerTelemetry::taken(const LogMessage& message) {
+         addRelaxed(_bytes, message._message.size());
+         const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - message._timestamp).count();
+         _queue_wait.record(static_cast<uint64_t>(std::max<int64_t>(0, wait)));
+      }
+
+
+      void WorkerTelemetry::waitedForSinks(std::chrono::nanoseconds wait) {
+         addRelaxed(_sink_waits, 1);
+         addRelaxed(_sink_wait_ns, static_cast<uint64_t>(std::max<int64_t>(0, wait.count())));
+      }
+
+
+      // any logging thread: read-modify-write, only on the slow path of a full queue
+      void WorkerTelemetry::waitedForRoom(std::chrono::nanoseconds wait) {
+         _room_waits.fetch_add(1, std::memory_order_relaxed);
+         _room_wait_ns.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, wait.count())), std::memory_order_relaxed);
+      }
+
+
+      // the queue depth is sampled before the batch leaves the queue
+      void WorkerTelemetry::sentToSinks(size_t count, uint64_t dropped) {
+         const uint64_t processed = _processed.load(std::memory_order_relaxed);
+         const uint64_t enqueued = _enqueued.sum();
+         const uint64_t depth = (enqueued > processed + dropped) ? enqueued - processed - dropped : 0;
+         if (depth > _high_water.load(std::memory_order_relaxed)) {
+            _high_water.store(depth, std::memory_order_relaxed);
+         }
+         _processed.store(processed + count, std::memory_order_relaxed);
+      }
+
+
+      void WorkerTelemetry::addSink(std::shared_ptr<SinkTelemetry> sink) {
+         std::lock_guard<std::mutex> lock(_sinks_mutex);
+         _sinks.push_back(sink);
+      }
+
+
+      LogWorkerStats WorkerTelemetry::snapshot(uint64_t dropped) const {
+         LogWorkerStats stats;
+         stats.enabled = true;
+         stats.dropped = dropped;
+         stats.processed = _processed.load(std::memory_order_relaxed);
+         stats.enqueued = std::max(_enqueued.sum(), stats.processed + stats.dropped);
+         stats.queue_depth = stats.enqueued - stats.processed - stats.dropped;
+         stats.queue_high_water = std::max(stats.queue_depth, _high_water.load(std::memory_order_relaxed));
+         stats.bytes_formatted = _bytes.load(std::memory_order_relaxed);
+         stats.room_waits = _room_waits.load(std::memory_order_relaxed);
+         stats.room_wait_time = std::chrono::nanoseconds(_room_wait_ns.load(std::memory_order_relaxed));
+         stats.sink_waits = _sink_waits.load(std::memory_order_relaxed);
+         stats.sink_wait_time = std::chrono::nanoseconds(_sink_wait_ns.load(std::memory_order_relaxed));
+
+         std::vector<uint64_t> counts;
+         uint64_t max = 0;
+         _queue_wait.addTo(counts, max);
+         stats.queue_wait = AtomicLatencyHistogram::percentiles(counts, max);
+
+         counts.clear();
+         max = 0;
+         std::lock_guard<std::mutex> lock(_sinks_mutex);
+         for (const auto& sink : _sinks) {
+            stats.sinks.push_back(sink->snapshot());
+            sink->latency().addTo(counts, max);
+         }
+         stats.latency = AtomicLatencyHistogram::percentiles(counts, max);
+         return stats;
+      }
+   } // internal
+} // g3
@@ -0,0 +1,301 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/threadrings.hpp"
+#include "g3log/spsc_ring.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+   const int64_t kNotPublishing = std::numeric_limits<int64_t>::max();
+
+   int64_t timestampOf(const g3::LogMessage& message) {
+      return static_cast<int64_t>(message._timestamp.time_since_epoch().count());
+   }
+} // anonymous
+
+namespace g3 {
+   namespace internal {
+      struct MessageRing {
+         explicit MessageRing(size_t capacity) : messages(capacity), producer_gone(false), publishing(kNotPublishing) {}
+         spsc_ring<std::unique_ptr<LogMessage>> messages;
+         std::atomic<bool> producer_gone;
+         std::atomic<int64_t> publishing; // timestamp of the message the producer is pushing, or kNotPublishing
+      };
+   } // internal
+} // g3
+
+
+namespace {
+   std::atomic<uint64_t> g_thread_rings_id{0};
+
+   // max messages forwarded in one batch to the LogWorker's background worker
+   const size_t kMaxBatch = 1024;
+
+   // The calling thread's ring. A thread only logs to one LogWorker at a time,
+   // if the LogWorker is replaced the thread will lazily register a new ring.
+   struct ThreadLocalRing {
+      uint64_t owner_id = 0;
+      std::shared_ptr<g3::internal::MessageRing> ring;
+
+      void reset() {
+         if (ring) {
+            ring->producer_gone.store(true, std::memory_order_release);
+         }
+         ring.reset();
+         owner_id = 0;
+      }
+
+      ~ThreadLocalRing() {
+         reset();
+      }
+   };
+
+   thread_local ThreadLocalRing t_ring;
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+
+      ThreadRings::ThreadRings(size_t ring_capacity, BatchCall forward_batch, FatalCall forward_fatal)
+         : _id(++g_thread_rings_id)
+         , _ring_capacity(ring_capacity)
+         , _forward_batch(forward_batch)
+         , _forward_fatal(forward_fatal)
+         , _rings_version(0)
+         , _sleeping(false)
+         , _stop(false)
+         , _has_fatal(false)
+         , _dropped(0) {
+         _merger = std::thread(&ThreadRings::run, this);
+      }
+
+      ThreadRings::~ThreadRings() {
+         stop();
+      }
+
+      void ThreadRings::stop() {
+         {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            _stop.store(true);
+            _wake.notify_one();
+         }
+         if (_merger.joinable()) {
+            _merger.join();
+         }
+
+         // A producer that saw _stop unset may have pushed after the merging thread's last look
+         // at its ring. Once it is done pushing, whatever is left in the rings is dropped
+         std::lock_guard<std::mutex> lock(_rings_mutex);
+         for (auto& ring : _rings) {
+            while (kNotPublishing != ring->publishing.load()) {
+               std::this_thread::yield();
+            }
+            std::unique_ptr<LogMessage> entry;
+            while (ring->messages.pop(entry)) {
+               ++_dropped;
+            }
+         }
+      }
+
+      void ThreadRings::wakeMerger() {
+         if (_sleeping.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            _wake.notify_one();
+         }
+      }
+
+
+      void ThreadRings::save(LogMessagePtr message) {
+         if (_stop.load(std::memory_order_relaxed)) {
+            ++_dropped;
+            return;
+         }
+
+         if (t_ring.owner_id != _id) {
+            t_ring.reset();
+            auto ring = std::make_shared<MessageRing>(_ring_capacity);
+            {
+               std::lock_guard<std::mutex> lock(_rings_mutex);
+               _rings.push_back(ring);
+               _rings_version.fetch_add(1, std::memory_order_release);
+            }
+            t_ring.ring = ring;
+            t_ring.owner_id = _id;
+         }
+
+         // publishing is set before _stop is read again: either stop() sees the push in progress,
+         // and waits for it, or the message is dropped here
+         MessageRing& ring = *t_ring.ring;
+         ring.publishing.store(timestampOf(*message.get()));
+         if (_stop.load()) {
+            ring.publishing.store(kNotPublishing, std::memory_order_release);
+            ++_dropped;
+            return;
+         }
+         std::unique_ptr<LogMessage> entry = message.release();
+         while (false == ring.messages.push(entry)) {
+            // full ring: back pressure until the merging thread has caught up
+            if (_stop.load(std::memory_order_relaxed)) {
+               ring.publishing.store(kNotPublishing, std::memory_order_release);
+               ++_dropped;
+               return;
+            }
+            wakeMerger();
+            std::this_thread::yield();
+         }
+         ring.publishing.store(kNotPublishing, std::memory_order_release);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         wakeMerger();
+      }
+
+
+      void ThreadRings::fatal(FatalMessagePtr message) {
+         std::lock_guard<std::mutex> lock(_wake_mutex);
+         _fatals.push_back(message.release());
+         _has_fatal.store(true);
+         _wake.notify_one();
+      }
+
+
+      // k-way merge of the ring heads. The oldest message, by LogMessage::_timestamp,
+      // is always picked first. The merge stops at a message that is newer than one still being
+      // pushed to an empty ring, unless it is the final drain. @return number of forwarded messages
+      size_t ThreadRings::mergeOnce(std::vector<std::shared_ptr<MessageRing>>& rings, bool final_drain) {
+         Batch batch = std::make_shared<Messages>();
+         while (batch->size() < kMaxBatch) {
+            MessageRing* oldest = nullptr;
+            int64_t oldest_time = kNotPublishing;
+            int64_t publishing = kNotPublishing;
+            for (auto& ring : rings) {
+               // read before the head: once the push is done the message is seen in the ring
+               const int64_t in_progress = ring->publishing.load(std::memory_order_acquire);
+               auto front = ring->messages.front();
+               if (nullptr == front) {
+                  publishing = std::min(publishing, in_progress);
+                  continue;
+               }
+               const int64_t time = timestampOf(**front);
+               if (nullptr == oldest || time < oldest_time) {
+                  oldest = ring.get();
+                  oldest_time = time;
+               }
+            }
+            if (nullptr == oldest || (!final_drain && publishing < oldest_time)) {
+               break;
+            }
+
+            std::unique_ptr<LogMessage> entry;
+            oldest->messages.pop(entry);
+            batch->push_back(std::move(entry));
+         }
+
+         const size_t forwarded = batch->size();
+         if (forwarded > 0) {
+            _forward_batch(batch);
+         }
+         return forwarded;
+      }
+
+
+      // The fatal message is forwarded right after the messages that are in the rings now,
+      // even if the other threads keep on logging
+      void ThreadRings::drainForFatal(std::vector<std::shared_ptr<MessageRing>>& rings) {
+         {
+            std::lock_guard<std::mutex> lock(_rings_mutex);
+            rings = _rings;
+         }
+         size_t pending = 0;
+         for (const auto& ring : rings) {
+            pending += ring->messages.size();
+         }
+         while (pending > 0) {
+            const size_t forwarded = mergeOnce(rings, true);
+            if (0 == forwarded) {
+               break;
+            }
+            pending -= std::min(pending, forwarded);
+         }
+
+         std::vector<std::unique_ptr<FatalMessage>> fatals;
+         {
+            std::lock_guard<std::mutex> lock(_wake_mutex);
+            fatals.swap(_fatals);
+            _has_fatal.store(false);
+         }
+         for (auto& fatal_message : fatals) {
+            _forward_fatal(FatalMessagePtr {std::move(fatal_message)});
+         }
+      }
+
+
+      bool ThreadRings::anyPending(const std::vector<std::shared_ptr<MessageRing>>& rings) const {
+         return std::any_of(rings.begin(), rings.end(), [](const std::shared_ptr<MessageRing>& ring) {
+            return !ring->messages.empty();
+         });
+      }
+
+
+      void ThreadRings::run() {
+         std::vector<std::shared_ptr<MessageRing>> rings;
+         uint64_t version = 0;
+
+         while (true) {
+            if (version != _rings_version.load(std::memory_order_acquire)) {
+               std::lock_guard<std::mutex> lock(_rings_mutex);
+               // rings from exited threads are removed once they are empty
+               _rings.erase(std::remove_if(_rings.begin(), _rings.end(), [](const std::shared_ptr<MessageRing>& ring) {
+                  return ring->producer_gone.load(std::memory_order_acquire) && ring->messages.empty();
+               }), _rings.end());
+               rings = _rings;
+               version = _rings_version.load(std::memory_order_acquire);
+            }
+
+            if (_has_fatal.load()) {
+               drainForFatal(rings);
+               continue;
+            }
+
+            if (mergeOnce(rings, false) > 0) {
+               continue;
+            }
+
+            const bool pending = anyPending(rings);
+            if (_stop.load()) {
+               if (!pending && version == _rings_version.load(std::memory_order_acquire)) {
+                  break; // all rings are drained
+               }
+               std::this_thread::yield();
+               continue;
+            }
+
+            if (pending) {
+               // held back until an older message, from another thread, is in its ring
+               std::this_thread::yield();
+               continue;
+            }
+
+            // Go to sleep. The producers only notify if this thread is asleep
+            std::unique_lock<std::mutex> lock(_wake_mutex);
+            _sleeping.store(true, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const bool keep_going = anyPending(rings) || _stop.load() || _has_fatal.load()
+                                    || version != _rings_version.load(std::memory_order_acquire);
+            if (!keep_going) {
+               // timeout is only used for the cleanup of rings from exited threads
+               _wake.wait_for(lock, std::chrono::milliseconds(100));
+               _rings_version.fetch_add(1, std::memory_order_release);
+            }
+            _sleeping.store(false, std::memory_order_relaxed);
+         }
+      }
+   } // internal
+} // g3
@@ -14,7 +14,9 @@
 #include <cmath>
 #include <chrono>
 #include <cassert>
+#include <memory>
 #include <iomanip>
+#include <atomic>
 #ifdef __MACH__
 #include <sys/time.h>
 #endif
@@ -96,6 +98,98 @@ namespace g3 {
 } // g3
 
 
+namespace {
+   std::atomic<uint64_t> g_time_formatter_id{0};
+
+   // The formatted date and time of the last second, per formatter. Direct mapped on
+   // the formatter id. With more formatters in use, on the same thread, they may evict each other
+   struct CachedSecond {
+      uint64_t formatter_id = 0;
+      std::time_t second = 0;
+      std::string text;                   // fractions are zero filled
+      std::vector<size_t> fraction_offsets;
+   };
+   const size_t kCachedFormatters = 4;
+   thread_local CachedSecond t_cached_seconds[kCachedFormatters];
+
+   size_t fractionalDigits(g3::internal::Fractional fractional) {
+      switch (fractional) {
+         case g3::internal::Fractional::Millisecond: return 3;
+         case g3::internal::Fractional::Microsecond: return 6;
+         default: return 9;
+      }
+   }
+} // anonymous
+
+
+namespace g3 {
+   namespace internal {
+      TimeFormatter::TimeFormatter(const std::string& time_format)
+         : _id(++g_time_formatter_id)
+         , _time_format(time_format) {
+         // same parsing of "%f[3|6|9]" as localtime_formatted_fractions
+         size_t start = 0;
+         for (size_t pos = 0; (pos = time_format.find(kFractionalIdentier, pos)) != std::string::npos;) {
+            auto type = getFractional(time_format, pos);
+            _pieces.push_back(time_format.substr(start, pos - start));
+            _fractions.push_back(type);
+            pos += kFractionalIdentierSize + (type != Fractional::NanosecondDefault ? 1 : 0);
+            start = pos;
+         }
+         _pieces.push_back(time_format.substr(start));
+      }
+
+      std::string TimeFormatter::format(const system_time_point& ts) const {
+         std::string formatted;
+         format(ts, formatted);
+         return formatted;
+      }
+
+      void TimeFormatter::format(const system_time_point& ts, std::string& out) const {
+         auto duration = ts.time_since_epoch();
+         auto sec_duration = std::chrono::duration_cast<std::chrono::seconds>(duration);
+         if (sec_duration > duration) {
+            sec_duration -= std::chrono::seconds(1); // before the epoch: the fraction is counted from the earlier second
+         }
+         const std::time_t second = static_cast<std::time_t>(sec_duration.count());
+
+         CachedSecond& cached = t_cached_seconds[_id % kCachedFormatters];
+         if (cached.formatter_id != _id || cached.second != second) {
+            std::tm t = g3::localtime(second);
+            cached.text.clear();
+            cached.fraction_offsets.clear();
+            for (size_t index = 0; index < _pieces.size(); ++index) {
+               if (!_pieces[index].empty()) {
+                  cached.text.append(g3::put_time(&t, _pieces[index].c_str()));
+               }
+               if (index < _fractions.size()) {
+                  cached.fraction_offsets.push_back(cached.text.size());
+                  cached.text.append(fractionalDigits(_fractions[index]), '0');
+               }
+            }
+            cached.formatter_id = _id;
+            cached.second = second;
+         }
+
+         const size_t start = out.size();
+         out.append(cached.text);
+         const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - sec_duration).count();
+         for (size_t index = 0; index < _fractions.size(); ++index) {
+            const size_t digits = fractionalDigits(_fractions[index]);
+            auto value = ns;
+            for (size_t cut = digits; cut < 9; ++cut) {
+               value /= 10;
+            }
+            for (size_t digit = digits; digit > 0; --digit) {
+               out[start + cached.fraction_offsets[index] + digit - 1] = static_cast<char>('0' + value % 10);
+               value /= 10;
+            }
+         }
+      }
+   } // internal
+} // g3
+
+
 
 namespace g3 {
    // This mimics the original "std::put_time(const std::tm* tmb, const charT* fmt)"
@@ -141,9 +235,11 @@ namespace g3 {
 
 
    std::string localtime_formatted(const g3::system_time_point& ts, const std::string& time_format) {
-      auto format_buffer = internal::localtime_formatted_fractions(ts, time_format);
-      auto time_point = std::chrono::system_clock::to_time_t(ts);
-      std::tm t = localtime(time_point);
-      return g3::put_time(&t, format_buffer.c_str()); // format example: //"%Y/%m/%d %H:%M:%S");
+      // the last used format is kept parsed, per thread
+      thread_local std::unique_ptr<internal::TimeFormatter> last_format;
+      if (!last_format || last_format->timeFormat() != time_format) {
+         last_format.reset(new internal::TimeFormatter(time_format));
+      }
+      return last_format->format(ts); // format example: //"%Y/%m/%d %H:%M:%S");
    }
 } // g3
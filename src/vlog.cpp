@@ -0,0 +1,168 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include "g3log/vlog.hpp"
+#include "g3log/g3log.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+   struct ModulePattern {
+      std::string pattern;
+      bool with_path; // matched against the path, the pattern has a '/'
+      int32_t verbosity;
+   };
+
+   struct VLogSettings {
+      std::mutex mutex;
+      g3::internal::VLogSite* sites = nullptr; // the evaluated sites
+      std::string parsed_vmodule;              // FLAGS_vmodule as parsed into the patterns
+      std::vector<ModulePattern> patterns;
+   };
+
+   // never deleted. VLOG calls can happen during static destruction
+   VLogSettings& settings() {
+      static VLogSettings* instance = new VLogSettings;
+      return *instance;
+   }
+
+   // "<pattern>=<verbosity>,..." A malformed entry is reported and skipped
+   std::vector<ModulePattern> parseVModule(const std::string& vmodule) {
+      std::vector<ModulePattern> patterns;
+      std::istringstream entries(vmodule);
+      std::string entry;
+      while (std::getline(entries, entry, ',')) {
+         const auto equal = entry.rfind('=');
+         char* end = nullptr;
+         const long verbosity = (std::string::npos == equal) ? 0 : std::strtol(entry.c_str() + equal + 1, &end, 10);
+         if (std::string::npos == equal || 0 == equal || end == entry.c_str() + equal + 1 || '\0' != *end) {
+            if (!entry.empty()) {
+               std::cerr << "g3log: ignored the vmodule entry [" << entry << "], expected <pattern>=<verbosity>" << std::endl;
+            }
+            continue;
+         }
+         const std::string pattern = entry.substr(0, equal);
+         patterns.push_back({pattern, std::string::npos != pattern.find('/'),
+                             static_cast<int32_t>(std::max<long>(std::min<long>(verbosity, g3::internal::kVLogUnevaluated - 1), -g3::internal::kVLogUnevaluated))});
+      }
+      return patterns;
+   }
+
+   // the module name of a source file: without the extension and a "-inl" suffix, with or without its directory
+   std::string moduleName(const char* file_path, bool with_path) {
+      std::string module {file_path};
+      const auto slash = module.find_last_of("/\\");
+      const auto dot = module.rfind('.');
+      if (std::string::npos != dot && (std::string::npos == slash || dot > slash)) {
+         module.erase(dot);
+      }
+      const std::string inl {"-inl"};
+      if (module.size() > inl.size() && 0 == module.compare(module.size() - inl.size(), inl.size(), inl)) {
+         module.erase(module.size() - inl.size());
+      }
+      if (!with_path && std::string::npos != slash) {
+         module.erase(0, slash + 1);
+      }
+      return module;
+   }
+
+   // the settings lock must be held
+   int32_t siteVerbosity(VLogSettings& vlog, const char* file_path) {
+      if (vlog.parsed_vmodule != FLAGS_vmodule) {
+         vlog.parsed_vmodule = FLAGS_vmodule;
+         vlog.patterns = parseVModule(vlog.parsed_vmodule);
+      }
+      for (const auto& module : vlog.patterns) {
+         if (g3::internal::vmoduleMatch(module.pattern.c_str(), moduleName(file_path, module.with_path).c_str())) {
+            return module.verbosity;
+         }
+      }
+      return std::min<int32_t>(FLAGS_v, g3::internal::kVLogUnevaluated - 1);
+   }
+} // anonymous
+
+
+namespace g3 {
+   void setVLogLevel(int verbosity) {
+      {
+         std::lock_guard<std::mutex> lock(settings().mutex);
+         FLAGS_v = verbosity;
+      }
+      updateVLogSites();
+   }
+
+
+   void setVModule(const std::string& vmodule) {
+      {
+         std::lock_guard<std::mutex> lock(settings().mutex);
+         FLAGS_vmodule = vmodule;
+      }
+      updateVLogSites();
+   }
+
+
+   void updateVLogSites() {
+      auto& vlog = settings();
+      std::lock_guard<std::mutex> lock(vlog.mutex);
+      for (auto site = vlog.sites; nullptr != site; site = site->next) {
+         site->verbosity.store(internal::kVLogUnevaluated, std::memory_order_release);
+      }
+   }
+
+
+   namespace internal {
+      bool vmoduleMatch(const char* pattern, const char* text) {
+         const char* star = nullptr; // the last '*' in the pattern
+         const char* star_text = nullptr;
+         while ('\0' != *text) {
+            if ('*' == *pattern) {
+               star = pattern++;
+               star_text = text;
+            } else if ('?' == *pattern || *pattern == *text) {
+               ++pattern;
+               ++text;
+            } else if (nullptr != star) {
+               pattern = star + 1; // the '*' takes one more character
+               text = ++star_text;
+            } else {
+               return false;
+            }
+         }
+         while ('*' == *pattern) {
+            ++pattern;
+         }
+         return '\0' == *pattern;
+      }
+
+
+      bool vlogEvaluate(VLogSite& site, int level) {
+         int32_t verbosity = site.verbosity.load(std::memory_order_acquire);
+         if (kVLogUnevaluated == verbosity) {
+            auto& vlog = settings();
+            std::lock_guard<std::mutex> lock(vlog.mutex);
+            verbosity = site.verbosity.load(std::memory_order_relaxed);
+            if (kVLogUnevaluated == verbosity) {
+               if (!site.registered) {
+                  site.registered = true;
+                  site.next = vlog.sites;
+                  vlog.sites = &site;
+               }
+               verbosity = siteVerbosity(vlog, site.file_path);
+               site.verbosity.store(verbosity, std::memory_order_release);
+            }
+         }
+         return level <= verbosity;
+      }
+   } // internal
+} // g3
@@ -11,7 +11,7 @@
 
 
 
-   # . performance test (average + worst case) for KjellKod's g3log
+   # . performance test (average + worst case) and microbenchmarks for KjellKod's g3log
    #    Do 'cmake -DUSE_G3LOG_PERFORMANCE=ON' to enable this 
    option (ADD_G3LOG_PERFORMANCE "g3log performance test" OFF)
 
@@ -38,13 +38,19 @@
 
      # WORST CASE PERFORMANCE TEST
      add_executable(g3log-performance-threaded_worst 
-                    ${DIR_PERFORMANCE}/main_threaded_worst.cpp ${DIR_PERFORMANCE}/performance.h)
+                    ${DIR_PERFORMANCE}/main_threaded_worst.cpp ${DIR_PERFORMANCE}/performance.h
+                    ${DIR_PERFORMANCE}/latency_histogram.h)
      # Turn on G3LOG performance flag
      set_target_properties(g3log-performance-threaded_worst  PROPERTIES 
                            COMPILE_DEFINITIONS "G3LOG_PERFORMANCE=1")
      target_link_libraries(g3log-performance-threaded_worst  
                             ${G3LOG_LIBRARY}  ${PLATFORM_LINK_LIBRIES})
 
+     # MICROBENCHMARKS: ns/op and allocations/op of the hot path components
+     add_executable(g3log-microbench ${DIR_PERFORMANCE}/main_microbench.cpp)
+     target_link_libraries(g3log-microbench
+                            ${G3LOG_LIBRARY}  ${PLATFORM_LINK_LIBRIES})
+
    ELSE()
       message( STATUS "-DADD_G3LOG_BENCH_PERFORMANCE=OFF" )
    ENDIF(ADD_G3LOG_BENCH_PERFORMANCE)
@@ -0,0 +1,239 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace g3_test
+{
+/** A latency histogram in the style of HdrHistogram. The counters are allocated at
+ * construction, record() only increments one of them, so the measurement does not
+ * allocate or sort anything.
+ *
+ * Values below 2 * kSubBuckets nanoseconds get a counter each. Above that, each power of
+ * two range is split into kSubBuckets counters of equal width, so that a value is known
+ * within 1/kSubBuckets (0.4%) of itself, up to the full uint64_t range.
+ *
+ * Histograms with the same layout are merged by adding their counters, e.g. the
+ * histograms of several threads into one for the aggregate percentiles.
+ */
+class LatencyHistogram
+{
+public:
+  static const unsigned kSubBucketBits = 8;
+  static const uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+
+  LatencyHistogram()
+    : _counts((65 - kSubBucketBits) * kSubBuckets, 0)
+    , _total(0)
+    , _sum(0)
+    , _min(std::numeric_limits<uint64_t>::max())
+    , _max(0) {}
+
+  void record(uint64_t nanoseconds)
+  {
+    ++_counts[index(nanoseconds)];
+    ++_total;
+    _sum += nanoseconds;
+    _min = std::min(_min, nanoseconds);
+    _max = std::max(_max, nanoseconds);
+  }
+
+  void merge(const LatencyHistogram& other)
+  {
+    for (size_t idx = 0; idx < _counts.size(); ++idx)
+    {
+      _counts[idx] += other._counts[idx];
+    }
+    _total += other._total;
+    _sum += other._sum;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+  }
+
+  uint64_t count() const { return _total; }
+  uint64_t min() const { return (0 == _total) ? 0 : _min; }
+  uint64_t max() const { return _max; }
+  double mean() const { return (0 == _total) ? 0.0 : static_cast<double>(_sum) / _total; }
+
+  /// @return the value that percent % of the recorded values are at or below, e.g. percentile(99.9)
+  /// It is the highest value of its counter, but never above the recorded max
+  uint64_t percentile(double percent) const
+  {
+    if (0 == _total)
+    {
+      return 0;
+    }
+    const double wanted = std::ceil(std::min(100.0, std::max(0.0, percent)) / 100.0 * _total);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(wanted));
+    uint64_t seen = 0;
+    for (size_t idx = 0; idx < _counts.size(); ++idx)
+    {
+      seen += _counts[idx];
+      if (seen >= rank)
+      {
+        return std::min(highestValueAt(idx), _max);
+      }
+    }
+    return _max;
+  }
+
+private:
+  std::vector<uint64_t> _counts;
+  uint64_t _total;
+  uint64_t _sum;
+  uint64_t _min;
+  uint64_t _max;
+
+  static unsigned highestBit(uint64_t value)
+  {
+    unsigned bit = 0;
+    while (value >>= 1)
+    {
+      ++bit;
+    }
+    return bit;
+  }
+
+  // [0, 2*kSubBuckets): one counter per value. Above: kSubBuckets counters per power of two,
+  // the value shifted down to [kSubBuckets, 2*kSubBuckets) gives the counter within the range
+  static size_t index(uint64_t value)
+  {
+    if (value < 2 * kSubBuckets)
+    {
+      return static_cast<size_t>(value);
+    }
+    const unsigned shift = highestBit(value) - kSubBucketBits;
+    return static_cast<size_t>(shift * kSubBuckets + (value >> shift));
+  }
+
+  static uint64_t highestValueAt(size_t idx)
+  {
+    if (idx < 2 * kSubBuckets)
+    {
+      return idx;
+    }
+    const unsigned shift = static_cast<unsigned>(idx / kSubBuckets) - 1;
+    const uint64_t top = idx - shift * kSubBuckets;
+    return ((top + 1) << shift) - 1;
+  }
+};
+
+
+/// The percentiles that are reported, as "p50", "p99", ...
+struct LatencyPercentile
+{
+  const char* name;
+  double percent;
+};
+const LatencyPercentile g_reported_percentiles[] = {
+  {"p50", 50.0}, {"p99", 99.0}, {"p99.9", 99.9}, {"p99.99", 99.99}
+};
+
+
+/// A named histogram for the report: one per thread, and the merged one of all threads
+struct LatencyRow
+{
+  std::string name;
+  const LatencyHistogram* histogram;
+};
+
+
+/// Human readable table of the rows, in microseconds
+inline void writeLatencyTable(std::ostream& out, const std::vector<LatencyRow>& rows)
+{
+  out << std::left << std::setw(20) << "[us]" << std::right << std::setw(12) << "count";
+  for (const auto& percentile : g_reported_percentiles)
+  {
+    out << std::setw(12) << percentile.name;
+  }
+  out << std::setw(12) << "max" << "\n";
+  out << std::fixed << std::setprecision(3);
+  for (const auto& row : rows)
+  {
+    out << std::left << std::setw(20) << row.name << std::right << std::setw(12) << row.histogram->count();
+    for (const auto& percentile : g_reported_percentiles)
+    {
+      out << std::setw(12) << row.histogram->percentile(percentile.percent) / 1000.0;
+    }
+    out << std::setw(12) << row.histogram->max() / 1000.0 << "\n";
+  }
+  out.unsetf(std::ios_base::floatfield);
+}
+
+
+/// Appends one line per row to the CSV file, in nanoseconds. The header is written to a new file.
+/// Each run adds its rows with the same timestamp, to track the latency over time
+inline bool appendLatencyCsv(const std::string& filename, const std::string& run, const std::vector<LatencyRow>& rows)
+{
+  const bool exists = std::ifstream(filename.c_str()).good();
+  std::ofstream out(filename.c_str(), std::ios_base::out | std::ios_base::app);
+  if (!out.is_open())
+  {
+    return false;
+  }
+  if (!exists)
+  {
+    out << "timestamp,run,name,count,min_ns,mean_ns";
+    for (const auto& percentile : g_reported_percentiles)
+    {
+      out << "," << percentile.name << "_ns";
+    }
+    out << ",max_ns\n";
+  }
+  const std::time_t now = std::time(nullptr);
+  for (const auto& row : rows)
+  {
+    const LatencyHistogram& histogram = *row.histogram;
+    out << now << "," << run << "," << row.name << "," << histogram.count() << "," << histogram.min()
+        << "," << static_cast<uint64_t>(histogram.mean());
+    for (const auto& percentile : g_reported_percentiles)
+    {
+      out << "," << histogram.percentile(percentile.percent);
+    }
+    out << "," << histogram.max() << "\n";
+  }
+  return true;
+}
+
+
+/// Appends the run as one JSON object on one line (JSON Lines), in nanoseconds
+inline bool appendLatencyJson(const std::string& filename, const std::string& run, const std::vector<LatencyRow>& rows)
+{
+  std::ofstream out(filename.c_str(), std::ios_base::out | std::ios_base::app);
+  if (!out.is_open())
+  {
+    return false;
+  }
+  // the names are made by the harness, they need no escaping
+  out << "{\"timestamp\":" << std::time(nullptr) << ",\"run\":\"" << run << "\",\"unit\":\"ns\",\"histograms\":[";
+  for (size_t idx = 0; idx < rows.size(); ++idx)
+  {
+    const LatencyHistogram& histogram = *rows[idx].histogram;
+    out << (0 == idx ? "" : ",") << "{\"name\":\"" << rows[idx].name << "\",\"count\":" << histogram.count()
+        << ",\"min\":" << histogram.min() << ",\"mean\":" << static_cast<uint64_t>(histogram.mean());
+    for (const auto& percentile : g_reported_percentiles)
+    {
+      out << ",\"" << percentile.name << "\":" << histogram.percentile(percentile.percent);
+    }
+    out << ",\"max\":" << histogram.max() << "}";
+  }
+  out << "]}\n";
+  return true;
+}
+} // end namespace
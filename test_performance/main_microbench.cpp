@@ -0,0 +1,433 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+// g3log-microbench: isolated benchmarks of the hot path components. Each benchmark runs
+// until it has been measured for at least --min_time seconds and reports the time and
+// the heap allocations per operation. Only the allocations of the measuring threads are
+// counted, e.g. not those of the LogWorker's background thread.
+//
+// usage: g3log-microbench [--filter=<text>] [--min_time=<seconds>]
+//    --filter     only run the benchmarks with <text> in their name
+//    --min_time   minimum measured time per benchmark, default 0.5 seconds
+
+#include <g3log/g3log.hpp>
+#include <g3log/logworker.hpp>
+#include <g3log/filesink.hpp>
+#include <g3log/shared_queue.hpp>
+#include <g3log/time.hpp>
+#include <g3log/telemetry.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include <unistd.h>
+#endif
+
+
+// every heap allocation of the process goes through here, counted per thread
+namespace {
+   thread_local uint64_t tl_allocations = 0;
+
+   void* countedAllocation(std::size_t size) {
+      ++tl_allocations;
+      if (void* memory = std::malloc(0 == size ? 1 : size)) {
+         return memory;
+      }
+      throw std::bad_alloc();
+   }
+} // anonymous
+
+void* operator new(std::size_t size) {
+   return countedAllocation(size);
+}
+void* operator new[](std::size_t size) {
+   return countedAllocation(size);
+}
+void operator delete(void* memory) noexcept {
+   std::free(memory);
+}
+void operator delete[](void* memory) noexcept {
+   std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept {
+   std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept {
+   std::free(memory);
+}
+
+
+
+namespace {
+   typedef std::chrono::steady_clock clock_type;
+
+   /// The measurement of one run of a benchmark. The benchmark does its setup, then calls
+   /// start(), runs iterations() operations, and calls stop(). The operations can be measured
+   /// in parts by several start() and stop() calls. Threads that take part in the
+   /// measurement report their allocations with threadStart() and threadStop()
+   class State {
+   public:
+      explicit State(size_t iterations)
+         : _iterations(iterations), _elapsed(0), _allocations_at_start(0), _allocations(0), _thread_allocations(0) {}
+
+      size_t iterations() const {
+         return _iterations;
+      }
+
+      void start() {
+         _allocations_at_start = tl_allocations;
+         _start = clock_type::now();
+      }
+
+      void stop() {
+         _elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - _start).count();
+         _allocations += tl_allocations - _allocations_at_start;
+      }
+
+      /// @return the allocation count of the calling thread, to pass to threadStop()
+      uint64_t threadStart() const {
+         return tl_allocations;
+      }
+
+      void threadStop(uint64_t allocations_at_start) {
+         _thread_allocations += tl_allocations - allocations_at_start;
+      }
+
+      double nanoseconds() const {
+         return static_cast<double>(_elapsed);
+      }
+
+      uint64_t allocations() const {
+         return _allocations + _thread_allocations.load();
+      }
+
+   private:
+      const size_t _iterations;
+      clock_type::time_point _start;
+      uint64_t _elapsed;
+      uint64_t _allocations_at_start;
+      uint64_t _allocations;
+      std::atomic<uint64_t> _thread_allocations;
+   };
+
+
+   struct Benchmark {
+      std::string name;
+      std::function<void(State&)> run;
+   };
+
+
+   /// keeps the compiler from removing the computation of a value that is not used
+   template <typename T>
+   void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+      asm volatile("" : : "g"(&value) : "memory");
+#else
+      static volatile const void* sink;
+      sink = &value;
+#endif
+   }
+
+
+   // the messages of the logging benchmarks, and the messages the NullSink received
+   std::atomic<uint64_t> g_logged {0};
+   std::atomic<uint64_t> g_received {0};
+
+   struct NullSink {
+      void receive(g3::LogMessageMover message) {
+         doNotOptimize(message);
+         g_received.fetch_add(1, std::memory_order_release);
+      }
+   };
+
+   /// Outside of the measurement: waits until the sink has the logged messages. The next run
+   /// starts with an empty queue, and the backlog of one run cannot grow into the next one
+   void waitForTheSink(size_t logged) {
+      const uint64_t expected = (g_logged += logged);
+      while (g_received.load(std::memory_order_acquire) < expected) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+   }
+
+
+   std::string tempDirectory() {
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+      return "./";
+#else
+      std::string directory = "/tmp/g3log-microbench-XXXXXX";
+      if (nullptr == mkdtemp(&directory[0])) {
+         return "/tmp/";
+      }
+      return directory + "/";
+#endif
+   }
+
+   // the log file, its "<prefix>.log" link and the directory
+   void removeLogFiles(const std::string& directory, const std::string& prefix, const std::string& file) {
+      std::remove(file.c_str());
+      std::remove((directory + prefix + ".log").c_str());
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+      rmdir(directory.c_str());
+#else
+      (void)directory;
+#endif
+   }
+
+
+   const g3::LogSite* benchmarkSite() {
+      return G3LOG_SITE();
+   }
+
+   void logCaptureConstructDestroy(State& state) {
+      const g3::LogSite* site = benchmarkSite();
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         LogCapture capture(site, G3LOG_INFO);
+      }
+      state.stop();
+   }
+
+   void logStream(State& state) {
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         LOG(G3LOG_INFO) << "count: " << count << ", a short message";
+      }
+      state.stop();
+      waitForTheSink(state.iterations());
+   }
+
+   void saveMessage(State& state) {
+      const g3::LogSite* site = benchmarkSite();
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         g3::internal::saveMessage("a short message", site, G3LOG_INFO, "", SIGABRT, "");
+      }
+      state.stop();
+      waitForTheSink(state.iterations());
+   }
+
+   void disabledLog(State& state) {
+#ifdef G3_DYNAMIC_LOGGING
+      g3::log_levels::disable(G3LOG_DEBUG);
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         LOG(G3LOG_DEBUG) << "count: " << count << ", a short message";
+      }
+      state.stop();
+      g3::log_levels::enable(G3LOG_DEBUG);
+#else
+      // without dynamic logging levels a LOG call cannot be disabled, the empty loop is the baseline
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         doNotOptimize(count);
+      }
+      state.stop();
+#endif
+   }
+
+   void disabledVLog(State& state) {
+      g3::setVLogLevel(0);
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         VLOG(2) << "count: " << count << ", a short message";
+      }
+      state.stop();
+   }
+
+   void logMessageToString(State& state) {
+      g3::LogMessage message(benchmarkSite(), G3LOG_INFO);
+      message.write().append("count: 12345, a short message");
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         std::string text = message.toString();
+         doNotOptimize(text);
+      }
+      state.stop();
+   }
+
+   void localtimeFormatted(State& state) {
+      const std::string format = g3::internal::date_formatted + " " + g3::internal::time_formatted;
+      const auto now = std::chrono::system_clock::now();
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         std::string text = g3::localtime_formatted(now, format);
+         doNotOptimize(text);
+      }
+      state.stop();
+   }
+
+   void fileSinkWrite(State& state) {
+      const std::string directory = tempDirectory();
+      const std::string prefix = "microbench";
+      std::string file;
+      {
+         g3::FileSink sink(prefix, directory, "");
+         file = sink.fileName();
+         // the messages are made outside of the measurement, a batch at a time
+         const size_t batch_size = 4096;
+         std::vector<g3::LogMessage> messages;
+         for (size_t done = 0; done < state.iterations(); done += messages.size()) {
+            messages.clear();
+            for (size_t count = done; count < state.iterations() && messages.size() < batch_size; ++count) {
+               messages.emplace_back(benchmarkSite(), G3LOG_INFO);
+               messages.back().write().append("count: 12345, a short message");
+            }
+
+            state.start();
+            for (auto& message : messages) {
+               sink.fileWrite(g3::LogMessageMover(std::move(message)));
+            }
+            state.stop();
+         }
+      }
+      removeLogFiles(directory, prefix, file);
+   }
+
+   // the cost that LogWorkerOptions::telemetry adds to each LOG call
+   void telemetryEnqueued(State& state) {
+      g3::internal::PerThreadCounter counter;
+      state.start();
+      for (size_t count = 0; count < state.iterations(); ++count) {
+         counter.add(1);
+      }
+      state.stop();
+      const uint64_t sum = counter.sum();
+      doNotOptimize(sum);
+   }
+
+   /// producers push iterations() items in total, one consumer pops them
+   void sharedQueueContention(State& state, size_t producers) {
+      shared_queue<uint64_t> queue;
+      std::atomic<bool> go {false};
+      std::vector<std::thread> threads;
+      const size_t per_producer = state.iterations() / producers;
+      const size_t items = per_producer * producers;
+      for (size_t producer = 0; producer < producers; ++producer) {
+         threads.emplace_back([&] {
+            while (!go.load()) {
+               std::this_thread::yield();
+            }
+            const uint64_t allocations = state.threadStart();
+            for (size_t count = 0; count < per_producer; ++count) {
+               queue.push(count);
+            }
+            state.threadStop(allocations);
+         });
+      }
+
+      state.start();
+      go.store(true);
+      uint64_t item = 0;
+      for (size_t count = 0; count < items; ++count) {
+         queue.wait_and_pop(item);
+      }
+      state.stop();
+      for (auto& thread : threads) {
+         thread.join();
+      }
+      doNotOptimize(item);
+   }
+
+
+   std::vector<Benchmark> benchmarks() {
+      using namespace std::placeholders;
+      return {
+         {"LogCapture_ConstructDestroy", logCaptureConstructDestroy},
+         {"LOG_Stream", logStream},
+         {"saveMessage", saveMessage},
+         {"LOG_DisabledLevel", disabledLog},
+         {"VLOG_Off", disabledVLog},
+         {"LogMessage_toString", logMessageToString},
+         {"localtime_formatted", localtimeFormatted},
+         {"FileSink_fileWrite", fileSinkWrite},
+         {"Telemetry_Enqueued", telemetryEnqueued},
+         {"shared_queue_PushPop/1_producer", std::bind(sharedQueueContention, _1, 1)},
+         {"shared_queue_PushPop/2_producers", std::bind(sharedQueueContention, _1, 2)},
+         {"shared_queue_PushPop/4_producers", std::bind(sharedQueueContention, _1, 4)},
+      };
+   }
+
+
+   /// runs the benchmark with more iterations until it was measured for at least min_time
+   void runBenchmark(const Benchmark& benchmark, double min_time) {
+      const double min_nanoseconds = min_time * 1e9;
+      const size_t max_iterations = 100 * 1000 * 1000;
+      size_t iterations = 1;
+      while (true) {
+         State state(iterations);
+         benchmark.run(state);
+         const double elapsed = state.nanoseconds();
+         if (elapsed >= min_nanoseconds || iterations >= max_iterations) {
+            std::cout << std::left << std::setw(36) << benchmark.name << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(12) << elapsed / iterations
+                      << std::setprecision(2) << std::setw(14) << static_cast<double>(state.allocations()) / iterations
+                      << std::setw(14) << iterations << std::endl;
+            return;
+         }
+         // as Google Benchmark: aim a bit beyond the goal, grow by at most 10 times per run
+         const double factor = (elapsed <= 0) ? 10.0 : std::min(10.0, std::max(2.0, 1.4 * min_nanoseconds / elapsed));
+         iterations = std::min(max_iterations, static_cast<size_t>(iterations * factor));
+      }
+   }
+} // anonymous
+
+
+
+int main(int argc, char** argv) {
+   std::string filter;
+   double min_time = 0.5;
+   for (int index = 1; index < argc; ++index) {
+      const std::string argument = argv[index];
+      if (0 == argument.find("--filter=")) {
+         filter = argument.substr(std::string("--filter=").size());
+      } else if (0 == argument.find("--min_time=")) {
+         min_time = std::atof(argument.c_str() + std::string("--min_time=").size());
+      } else {
+         std::cerr << "usage: " << argv[0] << " [--filter=<text>] [--min_time=<seconds>]" << std::endl;
+         return 2;
+      }
+   }
+
+#ifndef G3_DYNAMIC_LOGGING
+   std::cerr << "G3_DYNAMIC_LOGGING is DISABLED: LOG_DisabledLevel only measures the empty loop" << std::endl;
+#endif
+
+   // the logging benchmarks go through a LogWorker with a sink that does nothing. The queue is
+   // unbounded, as by default: a bounded queue with OverflowPolicy::Block would measure the
+   // background worker's speed whenever the queue is full. Each run waits for the sink after
+   // its measurement, ref: waitForTheSink
+   auto worker = g3::LogWorker::createLogWorker();
+   worker->addSink(std::unique_ptr<NullSink>(new NullSink), &NullSink::receive);
+   g3::initializeLogging(worker.get());
+   waitForTheSink(0);
+   g_logged.store(g_received.load()); // the messages logged at the initialization
+
+   std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(12) << "ns/op"
+             << std::setw(14) << "allocs/op" << std::setw(14) << "iterations" << std::endl;
+   std::cout << std::string(76, '-') << std::endl;
+   for (const auto& benchmark : benchmarks()) {
+      if (std::string::npos != benchmark.name.find(filter)) {
+         runBenchmark(benchmark, min_time);
+      }
+   }
+
+   g3::internal::shutDownLogging();
+   return 0;
+}
@@ -11,9 +11,7 @@
 
 #include <thread>
 #include <vector>
-#include <map>
 #include <algorithm>
-#include <cmath>
 
 #if defined(G3LOG_PERFORMANCE)
 const std::string title {
@@ -64,7 +62,8 @@ int main(int argc, char** argv)
 
    const std::string  g_prefix_log_name = title + "-performance-" + thread_count_oss.str() + "threads-WORST_LOG";
    const std::string  g_measurement_dump = g_path + g_prefix_log_name + "_RESULT.txt";
-   const std::string  g_measurement_bucket_dump = g_path + g_prefix_log_name + "_RESULT_buckets.txt";
+   const std::string  g_measurement_csv = g_path + g_prefix_log_name + "_RESULT.csv";
+   const std::string  g_measurement_json = g_path + g_prefix_log_name + "_RESULT.json";
    const uint64_t us_to_ms {
       1000
    };
@@ -93,14 +92,8 @@ int main(int argc, char** argv)
 #endif
 
    std::thread* threads = new std::thread[number_of_threads];
-   std::vector<uint64_t>* threads_result = new std::vector<uint64_t>[number_of_threads];
-
-   // kiss: just loop, create threads, store them then join
-   // could probably do this more elegant with lambdas
-   for (uint64_t idx = 0; idx < number_of_threads; ++idx)
-   {
-      threads_result[idx].reserve(g_iterations);
-   }
+   // one preallocated histogram per thread: recording a measurement allocates nothing
+   std::vector<LatencyHistogram> threads_result(number_of_threads);
 
    auto start_time = std::chrono::high_resolution_clock::now();
    for (uint64_t idx = 0; idx < number_of_threads; ++idx)
@@ -136,67 +129,33 @@ int main(int argc, char** argv)
    oss << "\nAverage time per log entry:" << std::endl;
    oss << "[Application: " << application_time_us / (number_of_threads * g_iterations) << " us]" << std::endl;
 
+   // the latency percentiles per thread, and of all threads merged
+   LatencyHistogram all_measurements;
+   std::vector<LatencyRow> rows;
    for (uint64_t idx = 0; idx < number_of_threads; ++idx)
    {
-      std::vector<uint64_t> &t_result = threads_result[idx];
-      uint64_t worstUs = (*std::max_element(t_result.begin(), t_result.end()));
-      oss << "[Application t" << idx + 1 << " worst took: " <<  worstUs / uint64_t(1000) << " ms  (" << worstUs << " us)] " << std::endl;
+      all_measurements.merge(threads_result[idx]);
+      std::ostringstream name;
+      name << "t" << idx + 1;
+      rows.push_back({name.str(), &threads_result[idx]});
    }
+   rows.push_back({"all", &all_measurements});
+
+   oss << "\nLOG call latency:" << std::endl;
+   writeLatencyTable(oss, rows);
    writeTextToFile(g_measurement_dump, oss.str(), kAppend);
    std::cout << "Result can be found at:" << g_measurement_dump << std::endl;
 
-   // now split the result in buckets of 10ms each so that it's obvious how the peaks go
-   std::vector<uint64_t> all_measurements;
-   all_measurements.reserve(g_iterations * number_of_threads);
-   for (uint64_t idx = 0; idx < number_of_threads; ++idx)
+   // machine readable, one run appended after the other to track the latency over time
+   const std::string run = title + "_" + thread_count_oss.str() + "threads";
+   if (appendLatencyCsv(g_measurement_csv, run, rows) && appendLatencyJson(g_measurement_json, run, rows))
    {
-      std::vector<uint64_t> &t_result = threads_result[idx];
-      all_measurements.insert(all_measurements.end(), t_result.begin(), t_result.end());
+      std::cout << "Percentiles in nanoseconds were appended to: " << g_measurement_csv << " and " << g_measurement_json << std::endl;
    }
-   delete [] threads_result; // finally get rid of them
-
-   std::sort (all_measurements.begin(), all_measurements.end());
-   std::map<uint64_t, uint64_t> value_amounts;
-   std::map<uint64_t, uint64_t> value_amounts_for_0ms_bucket;
-
-   for (auto iter = all_measurements.begin(); iter != all_measurements.end(); ++iter)
+   else
    {
-      uint64_t value = (*iter) / us_to_ms; // convert to ms
-      ++value_amounts[value]; // asuming uint64_t is default 0 when initialized
-
-      if (0 == value) {
-         ++value_amounts_for_0ms_bucket[*iter];
-      }
+      std::cerr << "Could not write the percentiles to: " << g_measurement_csv << " or " << g_measurement_json << std::endl;
    }
 
-   oss.str("");
-   oss << "Number of values rounded to milliseconds and put to [millisecond bucket] were dumped to file: " << g_measurement_bucket_dump << std::endl;
-   if (1 == value_amounts.size()) {
-      oss << "Format:  bucket of us inside bucket0 for ms\nFormat:bucket_of_ms, number_of_values_in_bucket\n\n" << std::endl;
-      oss << "\n";
-   }
-   else {
-      oss << "Format:bucket_of_ms, number_of_values_in_bucket\n\n" << std::endl;
-   }
-   std::cout << oss.str() << std::endl;
-
-   //
-   // If all values are for the 0ms bucket then instead show us buckets
-   //
-   if (1 == value_amounts.size()) {
-      oss << "\n\n***** Microsecond bucket measurement for all measurements that went inside the '0 millisecond bucket' ****\n";
-      for (auto us_bucket : value_amounts_for_0ms_bucket) {
-         oss << us_bucket.first << "\t" << us_bucket.second << std::endl;
-      }
-      oss << "\n\n***** Millisecond bucket measurement ****\n";
-   }
-
-   for (auto ms_bucket : value_amounts)
-   {
-      oss << ms_bucket.first << "\t, " << ms_bucket.second << std::endl;
-   }
-   writeTextToFile(g_measurement_bucket_dump, oss.str(), kAppend,  false);
-
-
    return 0;
 }
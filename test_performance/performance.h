@@ -19,6 +19,8 @@
 #include <chrono>
 #include <cassert>
 
+#include "latency_histogram.h"
+
 #if defined(G3LOG_PERFORMANCE)
 #include <g3log/g3log.hpp>
 #include <g3log/logworker.hpp>
@@ -33,6 +35,7 @@ using namespace g3::internal;
 typedef std::chrono::high_resolution_clock::time_point time_point;
 typedef std::chrono::duration<uint64_t,std::ratio<1, 1000> > millisecond;
 typedef std::chrono::duration<uint64_t,std::ratio<1, 1000000> > microsecond;
+typedef std::chrono::duration<uint64_t,std::nano> nanosecond;
 
 namespace g3_test
 {
@@ -82,8 +85,9 @@ uint64_t mean(const std::vector<uint64_t> &v)
 
 
 
-void measurePeakDuringLogWrites(const std::string& title, std::vector<uint64_t>& result);
-inline void measurePeakDuringLogWrites(const std::string& title, std::vector<uint64_t>& result)
+// the latency of each LOG call is recorded, in nanoseconds, to the thread's own preallocated histogram
+void measurePeakDuringLogWrites(const std::string& title, LatencyHistogram& result);
+inline void measurePeakDuringLogWrites(const std::string& title, LatencyHistogram& result)
 {
 
 
@@ -100,8 +104,7 @@ inline void measurePeakDuringLogWrites(const std::string& title, std::vector<uin
     auto start_time = std::chrono::high_resolution_clock::now();
     LOG(INFO) << title << " iteration #" << count << " " << charptrmsg << strmsg << " and a float: " << std::setprecision(6) << pi_f;
     auto stop_time = std::chrono::high_resolution_clock::now();
-    uint64_t time_us = std::chrono::duration_cast<microsecond>(stop_time - start_time).count();
-    result.push_back(time_us);
+    result.record(std::chrono::duration_cast<nanosecond>(stop_time - start_time).count());
   }
 }
 
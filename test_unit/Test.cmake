@@ -44,9 +44,11 @@
 
      IF (MSVC OR MINGW)  
         SET(OS_SPECIFIC_TEST test_crashhandler_windows)
+     ELSE()
+        SET(OS_SPECIFIC_TEST test_crashhandler_unix)
      ENDIF(MSVC OR MINGW)
 
-      SET(tests_to_run test_message test_filechange test_io test_cpp_future_concepts test_concept_sink test_sink ${OS_SPECIFIC_TEST})
+      SET(tests_to_run test_message test_filechange test_io test_cpp_future_concepts test_concept_sink test_sink test_queue test_capture test_latency_histogram test_flightrecorder ${OS_SPECIFIC_TEST})
       SET(helper ${DIR_UNIT_TEST}/testing_helpers.h ${DIR_UNIT_TEST}/testing_helpers.cpp)
       include_directories(${DIR_UNIT_TEST})
 
@@ -67,6 +69,12 @@
 		add_test( ${test} ${test} )
       ENDFOREACH(test)
    
+    # the raw stack dump test runs the offline symbolizer, ref: tools/Tools.cmake
+    IF (TARGET g3log-symbolize AND TARGET test_crashhandler_unix)
+       add_dependencies(test_crashhandler_unix g3log-symbolize)
+       set_property(TARGET test_crashhandler_unix APPEND PROPERTY COMPILE_DEFINITIONS "G3LOG_SYMBOLIZE=\"$<TARGET_FILE:g3log-symbolize>\"")
+    ENDIF()
+
     #
     # Test for Linux, runtime loading of dynamic libraries
     #     
@@ -0,0 +1,191 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <string>
+#include <thread>
+#include "g3log/g3log.hpp"
+#include "g3log/logcapture.hpp"
+#include "g3log/logworker.hpp"
+#include "g3log/messagepool.hpp"
+#include "g3log/std2_make_unique.hpp"
+
+// Counting global operator new. Only allocations made by the current thread,
+// while counting is turned on, are counted
+namespace {
+   thread_local size_t t_allocations = 0;
+   thread_local bool t_counting = false;
+
+   struct CountAllocations {
+      CountAllocations() {
+         t_allocations = 0;
+         t_counting = true;
+      }
+      ~CountAllocations() {
+         t_counting = false;
+      }
+      size_t count() const {
+         return t_allocations;
+      }
+   };
+
+   // The captured messages below the minimum log level are thrown away in saveMessage
+   // so that only the LOG capture is measured
+   struct OnlyCapture {
+      const int _original;
+      OnlyCapture() : _original(FLAGS_minloglevel) {
+         FLAGS_minloglevel = g3::kWarningValue;
+      }
+      ~OnlyCapture() {
+         FLAGS_minloglevel = _original;
+      }
+   };
+
+   struct CountingSink {
+      std::atomic<size_t>* received;
+      explicit CountingSink(std::atomic<size_t>* counter) : received(counter) {}
+      void receiveMsg(g3::LogMessageMover) {
+         ++(*received);
+      }
+      void sync() {}
+      void block(std::shared_future<void> release) {
+         release.wait();
+      }
+   };
+} // anonymous
+
+namespace {
+   void* countedAllocation(std::size_t size) {
+      if (t_counting) {
+         ++t_allocations;
+      }
+      if (void* memory = std::malloc(0 == size ? 1 : size)) {
+         return memory;
+      }
+      throw std::bad_alloc();
+   }
+} // anonymous
+
+void* operator new(std::size_t size) {
+   return countedAllocation(size);
+}
+
+void operator delete(void* memory) noexcept {
+   std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+   std::free(memory);
+}
+
+
+TEST(LogCapture, SteadyState_NoHeapAllocations) {
+   OnlyCapture filter;
+   const std::string text {"a std::string that is too long for the small string optimization"};
+   auto logSomething = [&text](int index) {
+      LOG(G3LOG_INFO) << "Hello " << index << " " << 3.1415 << " " << text << ' ' << true << " " << &text;
+   };
+
+   logSomething(0); // the thread's capture buffer is allocated at the first LOG call
+
+   CountAllocations allocations;
+   for (int index = 0; index < 1000; ++index) {
+      logSomething(index);
+   }
+   EXPECT_EQ(0u, allocations.count());
+}
+
+// Only with the per thread rings, the default queue allocates a std::function and a queue node per message
+TEST(LogCapture, PerThreadRings_EnabledLevel_SteadyState_NoHeapAllocations) {
+   std::atomic<size_t> received{0};
+   g3::LogWorkerOptions options;
+   options.per_thread_rings = true; // the logging thread only writes to its own ring
+   auto worker = g3::LogWorker::createLogWorker(options);
+   auto handle = worker->addSink(std2::make_unique<CountingSink>(&received), &CountingSink::receiveMsg);
+   g3::initializeLogging(worker.get());
+
+   const std::string text {"a std::string that is too long for the small string optimization"};
+   auto logSomething = [&text](int index) {
+      LOG(G3LOG_INFO) << "Hello " << index << " " << 3.1415 << " " << text;
+   };
+
+   // the sinks give the messages back to the pool once they are done with them. The sink is
+   // held during the warmup: all its messages are in flight at once, the pool then has more
+   // messages than the measurement below can have in flight, whatever the sink's timing
+   const size_t kWarmup = 2000;
+   std::promise<void> release;
+   handle->call(&CountingSink::block, release.get_future().share());
+   for (size_t index = 0; index < kWarmup; ++index) {
+      logSomething(static_cast<int>(index));
+   }
+   release.set_value();
+   for (int attempt = 0; attempt < 5000 && received.load() < kWarmup; ++attempt) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   ASSERT_EQ(kWarmup, received.load());
+   handle->call(&CountingSink::sync).get(); // the sink thread has released the last batch
+
+   size_t count = 0;
+   {
+      CountAllocations allocations;
+      for (int index = 0; index < 1000; ++index) {
+         logSomething(index);
+      }
+      count = allocations.count();
+   }
+   EXPECT_EQ(0u, count);
+}
+
+TEST(LogCapture, LongMessage_BufferGrowsAndIsReused) {
+   OnlyCapture filter;
+   const std::string long_text(10000, 'x');
+   {
+      LogCapture capture("file", 1, "function", G3LOG_INFO);
+      capture.stream() << long_text << 42;
+      EXPECT_EQ(long_text + "42", std::string(capture._buffer.c_str()));
+   }
+
+   CountAllocations allocations;
+   {
+      LogCapture capture("file", 1, "function", G3LOG_INFO);
+      capture.stream() << long_text << 42;
+   }
+   EXPECT_EQ(0u, allocations.count());
+}
+
+TEST(LogCapture, NestedCapture_UsesItsOwnBuffer) {
+   OnlyCapture filter;
+   LogCapture outer("file", 1, "function", G3LOG_INFO);
+   outer.stream() << "outer";
+   {
+      LogCapture inner("file", 2, "function", G3LOG_INFO);
+      inner.stream() << "inner " << 123;
+      EXPECT_STREQ("inner 123", inner._buffer.c_str());
+   }
+   outer.stream() << " done";
+   EXPECT_STREQ("outer done", outer._buffer.c_str());
+}
+
+TEST(LogCapture, HugeMessage_BufferIsReleased) {
+   OnlyCapture filter;
+   const std::string huge_text(4 * g3::internal::kMaxKeptCapacity, 'x');
+   {
+      LogCapture capture("file", 1, "function", G3LOG_INFO);
+      capture.stream() << huge_text;
+      EXPECT_LT(huge_text.size(), capture._buffer.capacity());
+   }
+
+   LogCapture capture("file", 1, "function", G3LOG_INFO);
+   EXPECT_GE(g3::internal::kMaxKeptCapacity, capture._buffer.capacity());
+}
@@ -0,0 +1,202 @@
+/** ==========================================================================
+ * 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+ * with no warranties. This code is yours to share, use and modify with no
+ * strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+ * ============================================================================*/
+
+
+#include <gtest/gtest.h>
+
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include "g3log/g3log.hpp"
+#include "g3log/logworker.hpp"
+#include "g3log/crashhandler.hpp"
+#include "g3log/std2_make_unique.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+   // Keeps the LogWorker busy: the fatal message cannot reach any sink
+   struct StuckSink {
+      void receiveMsg(std::string) {
+         std::this_thread::sleep_for(std::chrono::hours(1));
+      }
+   };
+
+   std::string readFile(const std::string &file_name) {
+      std::ifstream in(file_name);
+      std::stringstream content;
+      content << in.rdbuf();
+      return content.str();
+   }
+
+   // the fatal handling of the child may never finish, the alarm ends it
+   int waitForCrashedChild(pid_t child) {
+      int status = 0;
+      waitpid(child, &status, 0);
+      return status;
+   }
+} // anonymous
+
+
+TEST(CrashHandler_Unix, FatalSignal_MinimalRecordIsWrittenToTheCrashReportFd) {
+   const std::string file_name = "./crash_report_fd.txt";
+   const pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if (0 == child) {
+      alarm(2);
+      const int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      g3::addCrashReportFd(fd);
+      g3::installCrashHandler();
+      raise(SIGSEGV);
+      _exit(0);
+   }
+
+   const int status = waitForCrashedChild(child);
+   EXPECT_TRUE(WIFSIGNALED(status));
+   const std::string record = readFile(file_name);
+   EXPECT_NE(std::string::npos, record.find("FATAL SIGNAL RECEIVED")) << record;
+   EXPECT_NE(std::string::npos, record.find("SIGSEGV(11)")) << record;
+   EXPECT_NE(std::string::npos, record.find("PID: " + std::to_string(child))) << record;
+   EXPECT_NE(std::string::npos, record.find("[0x")) << "expected the raw stack frames\n" << record;
+   std::remove(file_name.c_str());
+}
+
+
+TEST(CrashHandler_Unix, RawStackDump_ReturnAddressesAndLoadMap) {
+   g3::setRawStackDump(true);
+   const std::string dump = g3::internal::stackdump();
+   g3::setRawStackDump(false);
+
+   EXPECT_NE(std::string::npos, dump.find("raw frame [1] 0x")) << dump;
+   EXPECT_EQ(std::string::npos, dump.find("stack dump [")) << "no symbols in a raw stack dump\n" << dump;
+#if defined(__linux__)
+   EXPECT_NE(std::string::npos, dump.find("load map 0x")) << dump;
+   EXPECT_NE(std::string::npos, dump.find(" build-id ")) << dump;
+   EXPECT_NE(std::string::npos, dump.find("test_crashhandler_unix\n")) << "expected the path of the main program\n" << dump;
+#endif
+}
+
+
+TEST(CrashHandler_Unix, FatalSignal_RawStackDump_CrashRecordHasTheRawFrames) {
+   const std::string file_name = "./crash_report_raw.txt";
+   const pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if (0 == child) {
+      alarm(2);
+      const int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      g3::addCrashReportFd(fd);
+      g3::setRawStackDump(true);
+      g3::installCrashHandler();
+      raise(SIGSEGV);
+      _exit(0);
+   }
+
+   const int status = waitForCrashedChild(child);
+   EXPECT_TRUE(WIFSIGNALED(status));
+   const std::string record = readFile(file_name);
+   EXPECT_NE(std::string::npos, record.find("Received fatal signal: SIGSEGV(11)")) << record;
+   EXPECT_NE(std::string::npos, record.find("******* RAW STACKDUMP *******")) << record;
+   EXPECT_NE(std::string::npos, record.find("raw frame [1] 0x")) << record;
+#if defined(__linux__)
+   EXPECT_NE(std::string::npos, record.find("load map 0x")) << "expected the load map made at the install\n" << record;
+#endif
+   std::remove(file_name.c_str());
+}
+
+
+#if defined(G3LOG_SYMBOLIZE)
+// the g3log-symbolize tool, on a raw stack dump of this process
+TEST(CrashHandler_Unix, RawStackDump_IsSymbolizedOffline) {
+   g3::setRawStackDump(true);
+   const std::string dump = g3::internal::stackdump();
+   g3::setRawStackDump(false);
+
+   // a recorded module that does not match its file, and a frame outside of all modules
+   std::string mismatch = dump.substr(dump.find("\tload map 0x"));
+   mismatch = mismatch.substr(0, mismatch.find('\n') + 1);
+   const auto build_id = mismatch.find(" build-id ") + std::string(" build-id ").size();
+   mismatch.replace(build_id, mismatch.find(' ', build_id) - build_id, "0123456789abcdef");
+   const std::string recorded = "before the dump\n" + dump
+                                + "\n\traw frame [1] 0x10\n\traw frame [2] " + mismatch.substr(mismatch.find("0x"), mismatch.find('-') - mismatch.find("0x"))
+                                + "\n" + mismatch + "after the dump\n";
+
+   const std::string raw_file = "./raw_stack_dump.txt";
+   const std::string symbolized_file = "./raw_stack_dump_symbolized.txt";
+   {
+      std::ofstream out(raw_file);
+      out << recorded;
+   }
+   const std::string command = std::string(G3LOG_SYMBOLIZE) + " " + raw_file + " > " + symbolized_file;
+   ASSERT_EQ(0, std::system(command.c_str())) << command;
+   const std::string symbolized = readFile(symbolized_file);
+
+   EXPECT_EQ(0u, symbolized.find("before the dump\n")) << symbolized;
+   EXPECT_NE(std::string::npos, symbolized.find("after the dump\n")) << symbolized;
+   EXPECT_EQ(std::string::npos, symbolized.find("raw frame [")) << symbolized;
+   // the first frame is the caller of stackdump()
+   EXPECT_NE(std::string::npos, symbolized.find("\tstack dump [1]  ")) << symbolized;
+   EXPECT_NE(std::string::npos, symbolized.find("test_crashhandler_unix : CrashHandler_Unix_RawStackDump_IsSymbolizedOffline_Test::TestBody()+0x"))
+         << symbolized;
+   EXPECT_NE(std::string::npos, symbolized.find("stack dump [1]  [unknown module] [0x10]")) << symbolized;
+   EXPECT_NE(std::string::npos, symbolized.find(" (build-id mismatch) [0x")) << symbolized;
+   std::remove(raw_file.c_str());
+   std::remove(symbolized_file.c_str());
+}
+#endif
+
+
+TEST(CrashHandler_Unix, FatalSignal_StuckLogWorker_FileSinkStillGetsTheCrashRecord) {
+   const std::string directory = "./";
+   int name_pipe[2];
+   ASSERT_EQ(0, pipe(name_pipe));
+   const pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if (0 == child) {
+      alarm(2);
+      auto worker = g3::LogWorker::createLogWorker();
+      auto file_handle = worker->addDefaultLogger("crash_report", directory);
+      auto stuck_handle = worker->addSink(std2::make_unique<StuckSink>(), &StuckSink::receiveMsg);
+      g3::initializeLogging(worker.get());
+      LOG(INFO) << "the LogWorker is stuck at this message";
+
+      const std::string log_file = file_handle->call(&g3::FileSink::fileName).get();
+      if (write(name_pipe[1], log_file.data(), log_file.size()) < 0) {
+         _exit(1);
+      }
+      close(name_pipe[1]);
+      raise(SIGSEGV);
+      _exit(0);
+   }
+
+   close(name_pipe[1]);
+   std::string log_file;
+   char buffer[256];
+   ssize_t bytes = 0;
+   while ((bytes = read(name_pipe[0], buffer, sizeof(buffer))) > 0) {
+      log_file.append(buffer, static_cast<size_t>(bytes));
+   }
+   close(name_pipe[0]);
+
+   const int status = waitForCrashedChild(child);
+   EXPECT_TRUE(WIFSIGNALED(status));
+   ASSERT_FALSE(log_file.empty());
+   const std::string content = readFile(log_file);
+   EXPECT_NE(std::string::npos, content.find("g3log created log at:")) << content;
+   EXPECT_NE(std::string::npos, content.find("Received fatal signal: SIGSEGV(11)")) << content;
+   std::remove(log_file.c_str());
+   std::remove((directory + "crash_report.log").c_str()); // the symlink
+}
+#endif
@@ -19,6 +19,15 @@
 #include <thread>
 #include "g3log/g3log.hpp"
 #include "g3log/logworker.hpp"
+#include "g3log/binaryfilesink.hpp"
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include "g3log/mmapfilesink.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef G3_HAS_ZLIB
+#include <zlib.h>
+#endif
 #include "testing_helpers.h"
 
 using namespace testing_helpers;
@@ -142,6 +151,452 @@ TEST(TestOf_LegalLogFileNam,  With_parenthesis) {
    EXPECT_TRUE(std::string::npos != post_legal.find("(test)")) << "filename was: " << post_legal;
 }
 
+namespace {
+   g3::LogMessageMover fileEntry(const std::string& text, const LEVELS& level) {
+      g3::LogMessage message("test_filechange.cpp", 1, "fileEntry", level);
+      message.write().append(text);
+      return g3::LogMessageMover(std::move(message));
+   }
+} // anonymous
+
+TEST(TestOf_FlushPolicy, Default_EveryEntryIsFlushed) {
+   g3::FileSink sink("FlushPolicy", "./", "default");
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+   sink.fileWrite(fileEntry("first entry", G3LOG_DEBUG));
+   EXPECT_NE(std::string::npos, readFileToText(sink.fileName()).find("first entry"));
+}
+
+TEST(TestOf_FlushPolicy, ByteThreshold_EntriesAreBufferedUntilThresholdOrLevel) {
+   g3::FlushPolicy policy;
+   policy.max_buffered_bytes = 64 * 1024;
+   g3::FileSink sink("FlushPolicy", "./", "bytes", policy);
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+
+   sink.fileWrite(fileEntry("buffered entry", G3LOG_DEBUG));
+   EXPECT_EQ(std::string::npos, readFileToText(sink.fileName()).find("buffered entry"));
+
+   sink.fileWrite(fileEntry("error entry", G3LOG_ERROR));
+   auto content = readFileToText(sink.fileName());
+   EXPECT_NE(std::string::npos, content.find("buffered entry"));
+   EXPECT_NE(std::string::npos, content.find("error entry"));
+
+   const std::string big(policy.max_buffered_bytes, 'x');
+   sink.fileWrite(fileEntry(big, G3LOG_INFO));
+   EXPECT_NE(std::string::npos, readFileToText(sink.fileName()).find(big));
+
+   sink.fileWrite(fileEntry("explicit flush", G3LOG_INFO));
+   sink.flush();
+   EXPECT_NE(std::string::npos, readFileToText(sink.fileName()).find("explicit flush"));
+}
+
+TEST(TestOf_FlushPolicy, FatalEntry_IsAlwaysFlushed) {
+   g3::FlushPolicy policy;
+   policy.max_buffered_bytes = 64 * 1024;
+   policy.flush_level = G3LOG_FATAL;
+   g3::FileSink sink("FlushPolicy", "./", "fatal", policy);
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+
+   sink.fileWrite(fileEntry("before fatal", G3LOG_WARNING));
+   sink.fileWrite(fileEntry("contract broken", G3LOG_FATAL));
+   auto content = readFileToText(sink.fileName());
+   EXPECT_NE(std::string::npos, content.find("before fatal"));
+   EXPECT_NE(std::string::npos, content.find("contract broken"));
+}
+
+TEST(TestOf_FlushPolicy, MaxLatency_TimerFlushesTheBuffer) {
+   g3::FlushPolicy policy;
+   policy.max_buffered_bytes = 64 * 1024;
+   policy.max_latency = std::chrono::milliseconds(20);
+   g3::FileSink sink("FlushPolicy", "./", "latency", policy);
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+
+   sink.fileWrite(fileEntry("waits for the timer", G3LOG_DEBUG));
+   bool flushed = false;
+   for (int retry = 0; retry < 200 && !flushed; ++retry) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      flushed = (std::string::npos != readFileToText(sink.fileName()).find("waits for the timer"));
+   }
+   EXPECT_TRUE(flushed);
+}
+
+TEST(TestOf_FlushPolicy, Shutdown_BufferIsWritten) {
+   g3::FlushPolicy policy;
+   policy.max_buffered_bytes = 64 * 1024;
+   std::string file_name;
+   {
+      g3::FileSink sink("FlushPolicy", "./", "shutdown", policy);
+      file_name = sink.fileName();
+      g_cleaner_ptr->addLogToClean(file_name);
+      sink.fileWrite(fileEntry("written at shutdown", G3LOG_DEBUG));
+   }
+   EXPECT_NE(std::string::npos, readFileToText(file_name).find("written at shutdown"));
+}
+
+TEST(TestOf_FileSinkLayout, LinesUseTheLayoutGivenAtConstruction) {
+   g3::FileSink sink("FileSinkLayout", "./", "layout", g3::FlushPolicy(), g3::LogLayout("%L: %m (%F:%#)"));
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+   sink.fileWrite(fileEntry("custom look", G3LOG_INFO));
+   EXPECT_NE(std::string::npos, readFileToText(sink.fileName()).find("INFO: custom look (test_filechange.cpp:1)\n"));
+}
+
+namespace {
+   bool fileExists(const std::string& file_name) {
+      return std::ifstream(file_name).good();
+   }
+} // anonymous
+
+TEST(TestOf_Rotation, BySize_OnlyTheNewestFilesAreKept) {
+   g3::RotationPolicy rotation;
+   rotation.max_file_bytes = 2000;
+   rotation.max_files = 3;
+   std::vector<std::string> files;
+   {
+      g3::FileSink sink("Rotation", "./", "size", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+      for (int index = 0; index < 200; ++index) {
+         sink.fileWrite(fileEntry("rotated entry " + std::to_string(index), G3LOG_INFO));
+         if (files.empty() || files.back() != sink.fileName()) {
+            files.push_back(sink.fileName());
+         }
+      }
+   }
+
+   ASSERT_GT(files.size(), 3u);
+   for (size_t index = 0; index < files.size(); ++index) {
+      const bool kept = index + 3 >= files.size();
+      EXPECT_EQ(kept, fileExists(files[index])) << files[index];
+      if (kept) {
+         g_cleaner_ptr->addLogToClean(files[index]);
+      }
+   }
+   EXPECT_NE(std::string::npos, readFileToText(files.back()).find("rotated entry 199"));
+   EXPECT_NE(std::string::npos, readFileToText(files.back()).find("The previous log file was at: " + files[files.size() - 2]));
+   EXPECT_LT(readFileToText(files[files.size() - 2]).size(), 2000u + 500u);
+}
+
+TEST(TestOf_Rotation, ByTime_EntryAfterTheIntervalGoesToANewFile) {
+   g3::RotationPolicy rotation;
+   rotation.interval = std::chrono::seconds(1);
+   g3::FileSink sink("Rotation", "./", "time", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+   const std::string first = sink.fileName();
+   g_cleaner_ptr->addLogToClean(first);
+   sink.fileWrite(fileEntry("before the interval", G3LOG_INFO));
+
+   std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+   sink.fileWrite(fileEntry("after the interval", G3LOG_INFO));
+   const std::string second = sink.fileName();
+   g_cleaner_ptr->addLogToClean(second);
+
+   ASSERT_NE(first, second);
+   EXPECT_NE(std::string::npos, readFileToText(first).find("before the interval"));
+   EXPECT_EQ(std::string::npos, readFileToText(first).find("after the interval"));
+   EXPECT_NE(std::string::npos, readFileToText(second).find("after the interval"));
+}
+
+TEST(TestOf_Rotation, Retention_CountsTheLogFilesOfEarlierRuns) {
+   const std::vector<std::string> earlier = {"./RotationScan.scan.20200101-000000.log",
+                                             "./RotationScan.scan.20200101-000000.1.log",
+                                             "./RotationScan.scan.20200102-000000.log.gz"};
+   const std::vector<std::string> others = {"./RotationScan.other.20200101-000000.log",
+                                            "./RotationScan.scan.notes.log"};
+   for (auto& file : earlier) {
+      std::ofstream(file) << "from an earlier run";
+   }
+   for (auto& file : others) {
+      std::ofstream(file) << "not a log file of the sink";
+      g_cleaner_ptr->addLogToClean(file);
+   }
+
+   g3::RotationPolicy rotation;
+   rotation.max_files = 2;
+   g3::FileSink sink("RotationScan", "./", "scan", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+   g_cleaner_ptr->addLogToClean(sink.fileName());
+   g_cleaner_ptr->addLogToClean(earlier[2]);
+
+   // the newest earlier file is kept with the current one, the order is by date and sequence number
+   EXPECT_FALSE(fileExists(earlier[0]));
+   EXPECT_FALSE(fileExists(earlier[1]));
+   EXPECT_TRUE(fileExists(earlier[2]));
+   for (auto& file : others) {
+      EXPECT_TRUE(fileExists(file)) << file;
+   }
+   std::remove("./RotationScan.log");
+}
+
+#ifdef G3_HAS_ZLIB
+namespace {
+   std::string readCompressedFile(const std::string& file_name) {
+      std::string text;
+      gzFile in = gzopen(file_name.c_str(), "rb");
+      if (nullptr == in) {
+         return text;
+      }
+      char chunk[4096];
+      int bytes = 0;
+      while ((bytes = gzread(in, chunk, sizeof(chunk))) > 0) {
+         text.append(chunk, static_cast<size_t>(bytes));
+      }
+      gzclose(in);
+      return text;
+   }
+} // anonymous
+
+TEST(TestOf_Rotation, Compress_RotatedFilesAreGzipped) {
+   g3::RotationPolicy rotation;
+   rotation.max_file_bytes = 2000;
+   rotation.compress = true;
+   std::vector<std::string> files;
+   {
+      g3::FileSink sink("Rotation", "./", "compress", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+      for (int index = 0; index < 50; ++index) {
+         sink.fileWrite(fileEntry("compressed entry " + std::to_string(index), G3LOG_INFO));
+         if (files.empty() || files.back() != sink.fileName()) {
+            files.push_back(sink.fileName());
+         }
+      }
+   } // the pending compressions are done at the sink's destruction
+
+   ASSERT_GT(files.size(), 1u);
+   g_cleaner_ptr->addLogToClean(files.back());
+   EXPECT_FALSE(fileExists(files.back() + ".gz"));
+   for (size_t index = 0; index + 1 < files.size(); ++index) {
+      EXPECT_FALSE(fileExists(files[index])) << files[index];
+      EXPECT_TRUE(fileExists(files[index] + ".gz")) << files[index];
+      g_cleaner_ptr->addLogToClean(files[index] + ".gz");
+   }
+   const std::string first = readCompressedFile(files.front() + ".gz");
+   EXPECT_NE(std::string::npos, first.find("compressed entry 0"));
+   EXPECT_NE(std::string::npos, first.find("Rotating log file to: " + files[1]));
+}
+
+TEST(TestOf_Rotation, Compress_RetentionCountsTheCompressedSize) {
+   g3::RotationPolicy rotation;
+   rotation.max_file_bytes = 2000;
+   rotation.max_total_bytes = 5000; // two uncompressed files, many compressed ones
+   rotation.compress = true;
+   std::vector<std::string> files;
+   {
+      g3::FileSink sink("Rotation", "./", "compressedsize", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+      files.push_back(sink.fileName());
+      for (int index = 0; files.size() < 6; ++index) {
+         sink.fileWrite(fileEntry("compressed entry " + std::to_string(index), G3LOG_INFO));
+         if (files.back() != sink.fileName()) {
+            // the compression is done before the next rotation
+            const std::string rotated = files.back();
+            for (int wait = 0; wait < 200 && (fileExists(rotated) || !fileExists(rotated + ".gz")); ++wait) {
+               std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            files.push_back(sink.fileName());
+         }
+      }
+   }
+
+   g_cleaner_ptr->addLogToClean(files.back());
+   for (size_t index = 0; index + 1 < files.size(); ++index) {
+      EXPECT_TRUE(fileExists(files[index] + ".gz")) << files[index];
+      g_cleaner_ptr->addLogToClean(files[index] + ".gz");
+   }
+}
+#endif // G3_HAS_ZLIB
+
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+TEST(TestOf_Rotation, LatestLinkFollowsTheRotation) {
+   g3::RotationPolicy rotation;
+   rotation.max_file_bytes = 200;
+   std::vector<std::string> files;
+   {
+      g3::FileSink sink("RotationLink", "./", "link", g3::FlushPolicy(), g3::LogLayout::defaultLayout(), rotation);
+      files.push_back(sink.fileName());
+      sink.fileWrite(fileEntry(std::string(300, 'x'), G3LOG_INFO));
+      files.push_back(sink.fileName());
+      EXPECT_EQ(files[1], sink.fileName());
+      char target[1024] = {0};
+      ASSERT_LT(0, readlink("./RotationLink.log", target, sizeof(target) - 1));
+      EXPECT_EQ(files[1], "./" + std::string(target));
+   }
+   for (auto& file : files) {
+      g_cleaner_ptr->addLogToClean(file);
+   }
+   std::remove("./RotationLink.log");
+}
+
+namespace {
+   size_t fileSize(const std::string& file_name) {
+      struct stat info;
+      return (0 == stat(file_name.c_str(), &info)) ? static_cast<size_t>(info.st_size) : 0;
+   }
+} // anonymous
+
+TEST(TestOf_MmapFileSink, EntriesOverManyChunks_FileIsTruncatedToContent) {
+   std::string file_name;
+   const size_t kEntries = 2000;
+   {
+      g3::MmapFileSink sink("MmapFileSink", "./", "chunks", 4096);
+      file_name = sink.fileName();
+      g_cleaner_ptr->addLogToClean(file_name);
+      for (size_t index = 0; index < kEntries; ++index) {
+         sink.fileWrite(fileEntry("mmap entry " + std::to_string(index), G3LOG_INFO));
+      }
+      // already readable while the sink is alive
+      EXPECT_NE(std::string::npos, readFileToText(file_name).find("mmap entry 1999\n"));
+   }
+
+   const std::string content = readFileToText(file_name);
+   EXPECT_EQ(content.size(), fileSize(file_name));
+   EXPECT_EQ(std::string::npos, content.find('\0'));
+   size_t previous = 0;
+   for (size_t index = 0; index < kEntries; ++index) {
+      const size_t pos = content.find("mmap entry " + std::to_string(index) + "\n");
+      ASSERT_NE(std::string::npos, pos) << index;
+      ASSERT_LE(previous, pos);
+      previous = pos;
+   }
+   EXPECT_NE(std::string::npos, content.find("g3MmapFileSink shutdown at:"));
+}
+
+TEST(TestOf_MmapFileSink, TruncatedByAnotherProcess_WritesOnFromTheNewEnd) {
+   std::string file_name;
+   {
+      g3::MmapFileSink sink("MmapFileSink", "./", "truncated", 4096);
+      file_name = sink.fileName();
+      g_cleaner_ptr->addLogToClean(file_name);
+      sink.fileWrite(fileEntry("before the truncation", G3LOG_INFO));
+      ASSERT_EQ(0, ::truncate(file_name.c_str(), 0));
+
+      // the file size is checked once per second, before the mapping is written to again
+      std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+      for (size_t index = 0; index < 200; ++index) {
+         sink.fileWrite(fileEntry("after the truncation " + std::to_string(index), G3LOG_INFO));
+      }
+   }
+
+   const std::string content = readFileToText(file_name);
+   EXPECT_EQ(content.size(), fileSize(file_name));
+   EXPECT_EQ(std::string::npos, content.find("before the truncation"));
+   EXPECT_EQ(std::string::npos, content.find('\0'));
+   EXPECT_NE(std::string::npos, content.find("after the truncation 0\n"));
+   EXPECT_NE(std::string::npos, content.find("after the truncation 199\n"));
+}
+
+TEST(TestOf_MmapFileSink, ChangeLogFile_BothFilesAreComplete) {
+   auto worker = g3::LogWorker::createLogWorker();
+   auto handle = worker->addSink(std2::make_unique<g3::MmapFileSink>("MmapFileSink", "./", "change", 4096), &g3::MmapFileSink::fileWrite);
+   const std::string first_file = handle->call(&g3::MmapFileSink::fileName).get();
+   g_cleaner_ptr->addLogToClean(first_file);
+
+   g3::LogMessagePtr first{std2::make_unique<g3::LogMessage>(fileEntry("in the first file", G3LOG_INFO).release())};
+   worker->save(first);
+   // the message goes through the worker, the file change straight to the sink: wait until it is written
+   for (int attempt = 0; attempt < 5000 && std::string::npos == readFileToText(first_file).find("in the first file"); ++attempt) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   const std::string second_file = handle->call(&g3::MmapFileSink::changeLogFile, std::string("./MmapChanged_"), std::string("change")).get();
+   ASSERT_FALSE(second_file.empty());
+   g_cleaner_ptr->addLogToClean(second_file);
+   g3::LogMessagePtr second{std2::make_unique<g3::LogMessage>(fileEntry("in the second file", G3LOG_INFO).release())};
+   worker->save(second);
+   worker.reset();
+
+   const std::string first_content = readFileToText(first_file);
+   const std::string second_content = readFileToText(second_file);
+   EXPECT_EQ(first_content.size(), fileSize(first_file));
+   EXPECT_NE(std::string::npos, first_content.find("in the first file"));
+   EXPECT_NE(std::string::npos, first_content.find("Changing log file from"));
+   EXPECT_NE(std::string::npos, second_content.find("in the second file"));
+   EXPECT_NE(std::string::npos, second_content.find("The previous log file was at: " + first_file));
+}
+#endif
+
+
+TEST(TestOf_BinaryFileSink, Decoded_AsLogMessageToString) {
+   std::vector<g3::LogMessageMover> entries;
+   entries.push_back(fileEntry("first binary entry", G3LOG_INFO));
+   entries.push_back(fileEntry("second binary entry", G3LOG_WARNING));
+   g3::LogMessage contract("test_filechange.cpp", 2, "contract", g3::internal::CONTRACT);
+   contract.setExpression("1 == 2");
+   contract.write().append("broken contract");
+   entries.push_back(g3::LogMessageMover(std::move(contract)));
+
+   std::string file_name;
+   {
+      g3::BinaryFileSink sink("BinaryFileSink", "./", "decode");
+      file_name = sink.fileName();
+      sink.receiveBatch(entries);
+   }
+   g_cleaner_ptr->addLogToClean(file_name);
+   EXPECT_NE(std::string::npos, file_name.find(".g3bin"));
+
+   g3::BinaryLogReader reader(file_name);
+   ASSERT_TRUE(reader.good());
+   std::unique_ptr<g3::LogMessage> message;
+   std::string thread_id;
+   for (auto& entry : entries) {
+      ASSERT_TRUE(reader.next(message, thread_id));
+      EXPECT_EQ(entry.get().toString(), message->toString());
+      EXPECT_EQ(entry.get().threadID(), thread_id);
+   }
+   EXPECT_FALSE(reader.next(message, thread_id));
+   EXPECT_FALSE(reader.truncated());
+}
+
+TEST(TestOf_BinaryFileSink, IncompleteLastRecord_EarlierMessagesAreRead) {
+   std::string file_name;
+   {
+      auto worker = g3::LogWorker::createLogWorker();
+      auto handle = worker->addSink(std2::make_unique<g3::BinaryFileSink>("BinaryFileSink", "./", "truncated"), &g3::BinaryFileSink::receiveBatch);
+      file_name = handle->call(&g3::BinaryFileSink::fileName).get();
+      for (int index = 0; index < 10; ++index) {
+         g3::LogMessagePtr entry{std2::make_unique<g3::LogMessage>(fileEntry("entry " + std::to_string(index), G3LOG_INFO).release())};
+         worker->save(entry);
+      }
+   }
+   g_cleaner_ptr->addLogToClean(file_name);
+
+   const std::string content = readFileToText(file_name);
+   std::ofstream(file_name, std::ios_base::binary | std::ios_base::trunc).write(content.data(), content.size() - 3);
+
+   g3::BinaryLogReader reader(file_name);
+   ASSERT_TRUE(reader.good());
+   std::unique_ptr<g3::LogMessage> message;
+   std::string thread_id;
+   int count = 0;
+   while (reader.next(message, thread_id)) {
+      EXPECT_EQ("entry " + std::to_string(count), message->message());
+      ++count;
+   }
+   EXPECT_EQ(9, count);
+   EXPECT_TRUE(reader.truncated());
+}
+
+TEST(TestOf_BinaryFileSink, DamagedRecordSize_IsTreatedAsTruncation) {
+   std::string file_name;
+   {
+      auto worker = g3::LogWorker::createLogWorker();
+      auto handle = worker->addSink(std2::make_unique<g3::BinaryFileSink>("BinaryFileSink", "./", "damaged"), &g3::BinaryFileSink::receiveBatch);
+      file_name = handle->call(&g3::BinaryFileSink::fileName).get();
+      for (int index = 0; index < 10; ++index) {
+         g3::LogMessagePtr entry{std2::make_unique<g3::LogMessage>(fileEntry("entry " + std::to_string(index), G3LOG_INFO).release())};
+         worker->save(entry);
+      }
+   }
+   g_cleaner_ptr->addLogToClean(file_name);
+
+   // a record size of almost 4 GB, followed by a few bytes
+   const uint32_t damaged_size = 0xfffffff0;
+   std::ofstream(file_name, std::ios_base::binary | std::ios_base::app)
+         .write(reinterpret_cast<const char*>(&damaged_size), sizeof(damaged_size)).write("abcdef", 6);
+
+   g3::BinaryLogReader reader(file_name);
+   ASSERT_TRUE(reader.good());
+   std::unique_ptr<g3::LogMessage> message;
+   std::string thread_id;
+   int count = 0;
+   while (reader.next(message, thread_id)) {
+      ++count;
+   }
+   EXPECT_EQ(10, count);
+   EXPECT_TRUE(reader.truncated());
+}
+
 
 int main(int argc, char* argv[]) {
    LogFileCleaner cleaner;
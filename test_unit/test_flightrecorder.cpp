@@ -0,0 +1,265 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "testing_helpers.h"
+#include "g3log/flightrecorder.hpp"
+#include "g3log/logworker.hpp"
+#include "g3log/std2_make_unique.hpp"
+
+// the flight recorder is POSIX only
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace testing_helpers;
+
+namespace {
+   std::vector<std::string> recoverMessages(const std::string& file_name, size_t* skipped = nullptr) {
+      std::vector<std::string> messages;
+      g3::FlightRecorderReader reader(file_name);
+      EXPECT_TRUE(reader.good());
+      std::unique_ptr<g3::LogMessage> message;
+      std::string thread_id;
+      while (reader.next(message, thread_id)) {
+         messages.push_back(message->message());
+      }
+      if (nullptr != skipped) {
+         *skipped = reader.skipped();
+      }
+      return messages;
+   }
+} // anonymous
+
+TEST(FlightRecorder, MessagesAreRecordedAtTheLogCall_FifoPerThread) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_fifo.g3fr";
+   const int kThreads = 4;
+   const int kMessagesPerThread = 500;
+   std::vector<std::string> delivered;
+   LogWorkerOptions options;
+   options.flight_recorder_file = file_name;
+   auto worker = LogWorker::createLogWorker(options);
+   auto handle = worker->addSink(std2::make_unique<MessageCollector>(&delivered), &MessageCollector::receiveMsg);
+
+   std::vector<std::thread> threads;
+   for (int thread = 0; thread < kThreads; ++thread) {
+      threads.push_back(std::thread([&worker, thread] {
+         for (int index = 0; index < kMessagesPerThread; ++index) {
+            saveToWorker(*worker, std::to_string(thread) + " " + std::to_string(index));
+         }
+      }));
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+
+   // read while the worker is still alive, as after a kill of the process
+   size_t skipped = 0;
+   const auto recovered = recoverMessages(file_name, &skipped);
+   EXPECT_EQ(0u, skipped);
+   ASSERT_EQ(static_cast<size_t>(kThreads * kMessagesPerThread), recovered.size());
+   std::vector<int> last_seen(kThreads, -1);
+   for (auto& message : recovered) {
+      const auto space = message.find(' ');
+      const int thread = std::stoi(message.substr(0, space));
+      const int index = std::stoi(message.substr(space + 1));
+      ASSERT_EQ(last_seen[thread] + 1, index) << "FIFO order broken for thread " << thread;
+      last_seen[thread] = index;
+   }
+   worker.reset();
+   std::remove(file_name.c_str());
+}
+
+TEST(FlightRecorder, RingWrapsAround_TheNewestMessagesAreKept) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_wrap.g3fr";
+   const int kMessages = 5000;
+   std::vector<std::string> delivered;
+   {
+      LogWorkerOptions options;
+      options.flight_recorder_file = file_name;
+      options.flight_recorder_bytes = 64 * 1024;
+      auto worker = LogWorker::createLogWorker(options);
+      auto handle = worker->addSink(std2::make_unique<MessageCollector>(&delivered), &MessageCollector::receiveMsg);
+      for (int index = 0; index < kMessages; ++index) {
+         saveToWorker(*worker, std::to_string(index) + std::string(40, '.'));
+      }
+   }
+
+   const auto recovered = recoverMessages(file_name);
+   ASSERT_FALSE(recovered.empty());
+   EXPECT_GT(static_cast<size_t>(kMessages), recovered.size());
+   const int first = std::stoi(recovered.front());
+   for (size_t index = 0; index < recovered.size(); ++index) {
+      ASSERT_EQ(first + static_cast<int>(index), std::stoi(recovered[index]));
+   }
+   EXPECT_EQ(kMessages - 1, std::stoi(recovered.back()));
+   std::remove(file_name.c_str());
+}
+
+TEST(FlightRecorder, ProcessIsKilled_MessagesAreRecovered) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_kill.g3fr";
+   const pid_t child = fork();
+   ASSERT_NE(-1, child);
+   if (0 == child) {
+      std::vector<std::string> delivered;
+      LogWorkerOptions options;
+      options.flight_recorder_file = file_name;
+      auto worker = LogWorker::createLogWorker(options);
+      auto handle = worker->addSink(std2::make_unique<MessageCollector>(&delivered), &MessageCollector::receiveMsg);
+      for (int index = 0; index < 100; ++index) {
+         saveToWorker(*worker, std::to_string(index));
+      }
+      raise(SIGKILL); // nothing is flushed, no destructor is run
+   }
+
+   int status = 0;
+   ASSERT_EQ(child, waitpid(child, &status, 0));
+   ASSERT_TRUE(WIFSIGNALED(status));
+   const auto recovered = recoverMessages(file_name);
+   ASSERT_EQ(100u, recovered.size());
+   EXPECT_EQ("0", recovered.front());
+   EXPECT_EQ("99", recovered.back());
+   std::remove(file_name.c_str());
+}
+
+namespace {
+   // a message with a self describing text: "<thread>:<index>:" and a filler that follows from both
+   std::string patternText(int thread, int index, size_t size) {
+      std::string text = std::to_string(thread) + ":" + std::to_string(index) + ":";
+      text.append(size, static_cast<char>('a' + (thread * 31 + index) % 26));
+      return text;
+   }
+
+   bool isPatternText(const std::string& text, size_t size) {
+      const auto first = text.find(':');
+      const auto second = text.find(':', first + 1);
+      if (std::string::npos == first || std::string::npos == second) {
+         return false;
+      }
+      const int thread = std::stoi(text.substr(0, first));
+      const int index = std::stoi(text.substr(first + 1, second - first - 1));
+      return text == patternText(thread, index, size);
+   }
+} // anonymous
+
+TEST(FlightRecorder, LappedWriters_RecoveredMessagesAreIntact) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_lapped.g3fr";
+   const int kThreads = 8;
+   const int kMessagesPerThread = 2000;
+   const size_t kTextSize = 4000; // the smallest ring holds 16 of them, the writers lap each other
+   {
+      internal::FlightRecorder recorder(file_name, 0);
+      ASSERT_TRUE(recorder.isOpen());
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < kThreads; ++thread) {
+         threads.push_back(std::thread([&recorder, thread, kTextSize] {
+            LogMessage message("test", 0, "test", G3LOG_DEBUG);
+            for (int index = 0; index < kMessagesPerThread; ++index) {
+               message.write() = patternText(thread, index, kTextSize);
+               recorder.record(message);
+            }
+         }));
+      }
+      for (auto& t : threads) {
+         t.join();
+      }
+   }
+
+   const auto recovered = recoverMessages(file_name);
+   EXPECT_FALSE(recovered.empty());
+   for (auto& text : recovered) {
+      ASSERT_TRUE(isPatternText(text, kTextSize)) << text.substr(0, 40);
+   }
+   std::remove(file_name.c_str());
+}
+
+TEST(FlightRecorder, DamagedRecord_IsSkipped) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_damaged.g3fr";
+   {
+      internal::FlightRecorder recorder(file_name, 0);
+      for (auto text : {"first message", "second message", "third message"}) {
+         LogMessage message("test", 0, "test", G3LOG_DEBUG);
+         message.write().append(text);
+         recorder.record(message);
+      }
+   }
+
+   // as a lapped writer would: bytes of an older record land in the complete second record
+   std::string content;
+   {
+      std::ifstream in(file_name, std::ios_base::in | std::ios_base::binary);
+      content.assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+   }
+   const auto second = content.find("second message");
+   ASSERT_NE(std::string::npos, second);
+   content[second] = 'S';
+   {
+      std::ofstream out(file_name, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+      out << content;
+   }
+
+   size_t skipped = 0;
+   const auto recovered = recoverMessages(file_name, &skipped);
+   ASSERT_EQ(2u, recovered.size());
+   EXPECT_EQ("first message", recovered[0]);
+   EXPECT_EQ("third message", recovered[1]);
+   EXPECT_EQ(1u, skipped);
+   std::remove(file_name.c_str());
+}
+
+TEST(FlightRecorder, HugeFields_RecordIsCutOrDropped_RingIsNotOverrun) {
+   using namespace g3;
+   const std::string file_name = "./flight_recorder_huge.g3fr";
+   const std::string huge(100 * 1024, 'x'); // larger than the smallest ring
+   {
+      internal::FlightRecorder recorder(file_name, 0);
+      LogMessage cut_expression("test", 0, "test", G3LOG_DEBUG);
+      cut_expression.setExpression(huge);
+      cut_expression.write().append("cut expression");
+      recorder.record(cut_expression);
+
+      LogMessage huge_file(huge, 0, huge, G3LOG_DEBUG);
+      huge_file.write().append("not recorded");
+      recorder.record(huge_file);
+
+      LogMessage last("test", 0, "test", G3LOG_DEBUG);
+      last.write().append("last");
+      recorder.record(last);
+   }
+
+   std::vector<std::unique_ptr<LogMessage>> recovered;
+   FlightRecorderReader reader(file_name);
+   std::unique_ptr<LogMessage> message;
+   std::string thread_id;
+   while (reader.next(message, thread_id)) {
+      recovered.push_back(std::move(message));
+   }
+   // the message is kept, the expression gets the room that is left
+   ASSERT_EQ(2u, recovered.size());
+   EXPECT_EQ("cut expression", recovered[0]->message());
+   EXPECT_LT(0u, recovered[0]->expression().size());
+   EXPECT_GT(64u * 1024 / 4, recovered[0]->expression().size());
+   EXPECT_EQ(0u, huge.find(recovered[0]->expression()));
+   EXPECT_EQ("last", recovered[1]->message());
+   std::remove(file_name.c_str());
+}
+#endif // the flight recorder is POSIX only
@@ -252,6 +252,72 @@ TEST(LogTest, LOG_F) {
 
 
 
+// deferred formatting log
+TEST(LogTest, LOG_FAST) {
+   std::string file_content;
+   {
+      RestoreFileLogger logger(log_directory);
+      const std::string text {"yello"};
+      const char* c_text = "c string";
+      LOG_FAST(INFO, "test INFO {}", 123);
+      LOG_FAST(G3LOG_DEBUG, "test DEBUG {} {} {}", 1.5, -7, 42u);
+      LOG_FAST(WARNING, "test WARNING {}", text);
+      LOG_FAST(INFO, "{} and {}{}{}", c_text, 'x', true, "!");
+      LOG_FAST(INFO, "braces {{}} missing {}");
+      LOG_FAST(INFO, "no placeholder", 1, 2);
+      logger.reset(); // force flush of logger
+      file_content = readFileToText(logger.logFile());
+      SCOPED_TRACE("LOG_FAST"); // Scope exit be prepared for destructor failure
+   }
+   EXPECT_TRUE(verifyContent(file_content, t_info2));
+   EXPECT_TRUE(verifyContent(file_content, "test DEBUG 1.5 -7 42"));
+   EXPECT_TRUE(verifyContent(file_content, t_warning3));
+   EXPECT_TRUE(verifyContent(file_content, "c string and x1!"));
+   EXPECT_TRUE(verifyContent(file_content, "braces {} missing {}"));
+   EXPECT_TRUE(verifyContent(file_content, "no placeholder 1 2"));
+}
+
+TEST(LogTest, LOG_FAST__CharacterTypes_AsWithStreamLog) {
+   std::string file_content;
+   {
+      RestoreFileLogger logger(log_directory);
+      const char plain = 'a';
+      const signed char signed_char = 'b';
+      const unsigned char unsigned_char = 'c';
+      const int8_t int8 = 'd';
+      const uint8_t uint8 = 'e';
+      LOG(INFO) << "stream " << plain << signed_char << unsigned_char << int8 << uint8;
+      LOG_FAST(INFO, "char {}", plain);
+      LOG_FAST(INFO, "signed char {}", signed_char);
+      LOG_FAST(INFO, "unsigned char {}", unsigned_char);
+      LOG_FAST(INFO, "int8_t {}", int8);
+      LOG_FAST(INFO, "uint8_t {}", uint8);
+      logger.reset(); // force flush of logger
+      file_content = readFileToText(logger.logFile());
+      SCOPED_TRACE("LOG_FAST characters"); // Scope exit be prepared for destructor failure
+   }
+   EXPECT_TRUE(verifyContent(file_content, "stream abcde"));
+   EXPECT_TRUE(verifyContent(file_content, "char a"));
+   EXPECT_TRUE(verifyContent(file_content, "signed char b"));
+   EXPECT_TRUE(verifyContent(file_content, "unsigned char c"));
+   EXPECT_TRUE(verifyContent(file_content, "int8_t d"));
+   EXPECT_TRUE(verifyContent(file_content, "uint8_t e"));
+}
+
+TEST(LogTest, LOG_FAST__FATAL) {
+   RestoreFileLogger logger(log_directory);
+   ASSERT_FALSE(mockFatalWasCalled());
+   LOG_FAST(FATAL, "This message should throw {}", 0);
+   EXPECT_TRUE(mockFatalWasCalled());
+   EXPECT_TRUE(verifyContent(mockFatalMessage(), "This message should throw 0")) << "\n****" << mockFatalMessage();
+   EXPECT_TRUE(verifyContent(mockFatalMessage(), "FATAL"));
+
+   auto file_content = logger.resetAndRetrieveContent();
+   EXPECT_TRUE(verifyContent(file_content, "This message should throw 0")) << "\n****" << file_content;
+}
+
+
+
 // stream-type log
 TEST(LogTest, LOG) {
    std::string file_content;
@@ -335,6 +401,79 @@ TEST(LogTest, LOG_IF) {
    EXPECT_TRUE(verifyContent(file_content, t_info2));
    EXPECT_FALSE(verifyContent(file_content, t_debug3));
 }
+
+TEST(LogTest, VLOG) {
+   std::string file_content;
+   {
+      RestoreFileLogger logger(log_directory);
+      g3::setVLogLevel(1);
+      VLOG(0) << "verbose-0";
+      VLOG(1) << "verbose-1";
+      VLOG(2) << "verbose-2-should-NOT-show-up";
+      EXPECT_TRUE(VLOG_IS_ON(1));
+      EXPECT_FALSE(VLOG_IS_ON(2));
+      g3::setVLogLevel(0);
+      logger.reset(); // force flush of logger
+      file_content = readFileToText(logger.logFile());
+   }
+   EXPECT_TRUE(verifyContent(file_content, "verbose-0"));
+   EXPECT_TRUE(verifyContent(file_content, "verbose-1"));
+   EXPECT_FALSE(verifyContent(file_content, "verbose-2-should-NOT-show-up"));
+}
+
+TEST(LogTest, VLOG_EvaluatedSite_FollowsTheVerbosityChanges) {
+   std::string file_content;
+   {
+      RestoreFileLogger logger(log_directory);
+      for (int verbosity : {0, 2, 0, 2}) {
+         g3::setVLogLevel(verbosity);
+         VLOG(2) << "verbose-at-" << verbosity;
+      }
+      FLAGS_v = 3; // directly, then the sites are updated
+      g3::updateVLogSites();
+      const bool on_after_update = VLOG_IS_ON(3);
+      g3::setVLogLevel(0);
+      EXPECT_TRUE(on_after_update);
+      logger.reset(); // force flush of logger
+      file_content = readFileToText(logger.logFile());
+   }
+   EXPECT_TRUE(verifyContent(file_content, "verbose-at-2"));
+   EXPECT_FALSE(verifyContent(file_content, "verbose-at-0"));
+}
+
+TEST(LogTest, VLOG_VModule_PerFileVerbosity) {
+   std::string file_content;
+   {
+      RestoreFileLogger logger(log_directory);
+      g3::setVModule("other=4,test_i?=3,test_*=1");
+      VLOG(3) << "verbose-3-by-vmodule";
+      VLOG(4) << "verbose-4-should-NOT-show-up";
+      g3::setVModule("*/test_unit/test_*=2");
+      VLOG(2) << "verbose-2-by-path";
+      g3::setVModule("other=4");
+      VLOG(1) << "verbose-1-should-NOT-show-up";
+      g3::setVModule("");
+      logger.reset(); // force flush of logger
+      file_content = readFileToText(logger.logFile());
+   }
+   EXPECT_TRUE(verifyContent(file_content, "verbose-3-by-vmodule"));
+   EXPECT_TRUE(verifyContent(file_content, "verbose-2-by-path"));
+   EXPECT_FALSE(verifyContent(file_content, "verbose-4-should-NOT-show-up"));
+   EXPECT_FALSE(verifyContent(file_content, "verbose-1-should-NOT-show-up"));
+}
+
+TEST(LogTest, VLOG_VModule_GlobMatch) {
+   using g3::internal::vmoduleMatch;
+   EXPECT_TRUE(vmoduleMatch("mapreduce", "mapreduce"));
+   EXPECT_FALSE(vmoduleMatch("mapreduce", "mapreduce_test"));
+   EXPECT_TRUE(vmoduleMatch("gfs*", "gfs_client"));
+   EXPECT_TRUE(vmoduleMatch("*", ""));
+   EXPECT_TRUE(vmoduleMatch("*client*", "gfs_client_impl"));
+   EXPECT_TRUE(vmoduleMatch("a?c", "abc"));
+   EXPECT_FALSE(vmoduleMatch("a?c", "ac"));
+   EXPECT_TRUE(vmoduleMatch("*a*b", "xaab"));
+   EXPECT_FALSE(vmoduleMatch("*a*b", "xaabc"));
+}
 TEST(LogTest, LOGF__FATAL) {
    RestoreFileLogger logger(log_directory);
    ASSERT_FALSE(mockFatalWasCalled());
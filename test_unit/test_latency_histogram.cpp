@@ -0,0 +1,105 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include "../test_performance/latency_histogram.h"
+
+using g3_test::LatencyHistogram;
+
+namespace {
+   // the highest value of the counter that value is recorded in. A second, much higher,
+   // value keeps the percentile from being capped by the recorded max
+   uint64_t counterTop(uint64_t value) {
+      LatencyHistogram histogram;
+      histogram.record(value);
+      histogram.record(std::numeric_limits<uint64_t>::max());
+      return histogram.percentile(50.0);
+   }
+} // anonymous
+
+TEST(LatencyHistogram, Empty_AllZero) {
+   LatencyHistogram histogram;
+   EXPECT_EQ(0u, histogram.count());
+   EXPECT_EQ(0u, histogram.min());
+   EXPECT_EQ(0u, histogram.max());
+   EXPECT_EQ(0u, histogram.percentile(50.0));
+   EXPECT_DOUBLE_EQ(0.0, histogram.mean());
+}
+
+TEST(LatencyHistogram, BucketBoundaries_ExactBelowTwoSubBucketRanges) {
+   const uint64_t kExact = 2 * LatencyHistogram::kSubBuckets;
+   for (uint64_t value = 0; value < kExact; ++value) {
+      EXPECT_EQ(value, counterTop(value)) << value;
+   }
+
+   // above, each power of two range has kSubBuckets counters. [512, 1024) counters are 2 wide
+   EXPECT_EQ(kExact + 1, counterTop(kExact));
+   EXPECT_EQ(kExact + 1, counterTop(kExact + 1));
+   EXPECT_EQ(kExact + 3, counterTop(kExact + 2));
+   EXPECT_EQ(2 * kExact - 1, counterTop(2 * kExact - 1));
+   // and [1024, 2048) counters are 4 wide
+   EXPECT_EQ(2 * kExact + 3, counterTop(2 * kExact));
+   EXPECT_EQ(2 * kExact + 7, counterTop(2 * kExact + 4));
+}
+
+TEST(LatencyHistogram, BucketBoundaries_ValueIsKeptWithinItsPrecision) {
+   for (uint64_t value = 1; value < (uint64_t(1) << 62); value = value * 3 + 1) {
+      const uint64_t top = counterTop(value);
+      EXPECT_LE(value, top) << value;
+      EXPECT_LE(top - value, value / LatencyHistogram::kSubBuckets) << value;
+   }
+}
+
+TEST(LatencyHistogram, Overflow_HighestValuesGoToTheTopBucket) {
+   const uint64_t kHighest = std::numeric_limits<uint64_t>::max();
+   LatencyHistogram histogram;
+   histogram.record(kHighest);
+   histogram.record(kHighest - 1);
+   histogram.record(kHighest - (kHighest >> LatencyHistogram::kSubBucketBits) / 2);
+   EXPECT_EQ(3u, histogram.count());
+   EXPECT_EQ(kHighest, histogram.max());
+   // all three share the top counter, its highest value is the uint64_t max
+   EXPECT_EQ(kHighest, histogram.percentile(0.0));
+   EXPECT_EQ(kHighest, histogram.percentile(100.0));
+}
+
+TEST(LatencyHistogram, Percentiles_OfAKnownDistribution) {
+   LatencyHistogram histogram;
+   for (uint64_t value = 1; value <= 1000; ++value) {
+      histogram.record(value);
+   }
+   EXPECT_EQ(1000u, histogram.count());
+   EXPECT_EQ(1u, histogram.min());
+   EXPECT_EQ(1000u, histogram.max());
+   EXPECT_DOUBLE_EQ(500.5, histogram.mean());
+
+   EXPECT_EQ(1u, histogram.percentile(0.0));  // the lowest recorded value
+   EXPECT_EQ(500u, histogram.percentile(50.0)); // exact, below 2 * kSubBuckets
+   EXPECT_EQ(991u, histogram.percentile(99.0)); // 990 shares a counter with 991
+   EXPECT_EQ(1000u, histogram.percentile(99.9));
+   EXPECT_EQ(1000u, histogram.percentile(100.0)); // never above the recorded max
+   EXPECT_EQ(1000u, histogram.percentile(150.0));
+}
+
+TEST(LatencyHistogram, Merge_SameAsOneHistogram) {
+   LatencyHistogram all, low, high;
+   for (uint64_t value = 1; value <= 1000; ++value) {
+      all.record(value * 1000);
+      (value <= 500 ? low : high).record(value * 1000);
+   }
+   low.merge(high);
+   EXPECT_EQ(all.count(), low.count());
+   EXPECT_EQ(all.min(), low.min());
+   EXPECT_EQ(all.max(), low.max());
+   for (double percent : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+      EXPECT_EQ(all.percentile(percent), low.percentile(percent)) << percent;
+   }
+}
@@ -9,9 +9,14 @@
 #include <gtest/gtest.h>
 #include <g3log/g3log.hpp>
 #include <g3log/time.hpp>
+#include <g3log/loglayout.hpp>
 #include <iostream>
 #include <ctime>
 #include <cstdlib>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include <g3log/generated_definitions.hpp>
 
 namespace {
@@ -189,6 +194,146 @@ TEST(Message, localtime_formatted) {
 }
 #endif // timezone 
 
+namespace {
+   // the formatting as it was done before the TimeFormatter
+   std::string referenceFormatted(const g3::system_time_point& ts, const std::string& time_format) {
+      auto format_buffer = g3::internal::localtime_formatted_fractions(ts, time_format);
+      std::tm t = g3::localtime(std::chrono::system_clock::to_time_t(ts));
+      return g3::put_time(&t, format_buffer.c_str());
+   }
+} // anonymous
+
+TEST(Message, TimeFormatter_SameAsUncachedFormatting) {
+   const std::vector<std::string> formats = {"%Y/%m/%d %H:%M:%S %f6", "%H:%M:%S %f3", "%f at %H:%M:%S", "%f9.%f3", "%Y-%m-%d", "%f"};
+   const auto start = std::chrono::system_clock::from_time_t(k2017_April_27th);
+   for (auto& time_format : formats) {
+      g3::internal::TimeFormatter formatter(time_format);
+      // steps within the same second and over the next seconds
+      for (auto step = 0; step < 50; ++step) {
+         const auto ts = start + std::chrono::microseconds(step * 123457);
+         EXPECT_EQ(referenceFormatted(ts, time_format), formatter.format(ts)) << time_format;
+         EXPECT_EQ(referenceFormatted(ts, time_format), g3::localtime_formatted(ts, time_format)) << time_format;
+      }
+   }
+}
+
+TEST(Message, TimeFormatter_ManyFormattersOnOneThread) {
+   const auto ts = std::chrono::system_clock::from_time_t(k2017_April_27th) + std::chrono::milliseconds(7);
+   std::vector<std::unique_ptr<g3::internal::TimeFormatter>> formatters;
+   for (auto index = 0; index < 10; ++index) {
+      formatters.emplace_back(new g3::internal::TimeFormatter(std::to_string(index) + " %S %f3"));
+   }
+   for (auto round = 0; round < 2; ++round) {
+      for (size_t index = 0; index < formatters.size(); ++index) {
+         EXPECT_EQ(referenceFormatted(ts, formatters[index]->timeFormat()), formatters[index]->format(ts));
+      }
+   }
+}
+
+
+TEST(Message, LogLayout_DefaultLayoutIsTheToStringLook) {
+   g3::LogMessage msg("some/path/file.cpp", 123, "someFunction", G3LOG_INFO);
+   msg.write().append("hello layout");
+   const std::string expected = msg.timestamp() + "\t" + msg.level() + " [" + msg.file() + "->" + msg.function()
+                                + ":" + msg.line() + "]\t" + msg.message() + "\n";
+   EXPECT_EQ(expected, msg.toString());
+   EXPECT_EQ(expected, g3::LogLayout::defaultLayout().toString(msg));
+}
+
+TEST(Message, LogLayout_CustomPattern) {
+   g3::LogMessage msg("some/path/file.cpp", 123, "someFunction", G3LOG_WARNING);
+   msg.write().append("hello layout");
+   g3::LogLayout layout("%T{%H:%M} %L [%F->%N:%#] %m %% %x %P %t");
+   const std::string expected = msg.timestamp("%H:%M") + " WARNING [file.cpp->someFunction:123] hello layout % %x "
+                                + msg.file_path() + " " + msg.threadID() + "\n";
+   EXPECT_EQ(expected, layout.toString(msg));
+
+   // appended to what is already in the buffer
+   std::string out = "previous\n";
+   layout.format(msg, out);
+   EXPECT_EQ("previous\n" + expected, out);
+}
+
+TEST(Message, LogLayout_FatalMessageKeepsItsLook) {
+   g3::LogMessage msg("file.cpp", 1, "someFunction", G3LOG_FATAL);
+   msg.write().append("bye");
+   g3::LogLayout layout("%L %m");
+   EXPECT_EQ(msg.toString(), layout.toString(msg));
+}
+
+namespace {
+   const g3::LogSite* siteOfThisLine() {
+      return G3LOG_SITE();
+   }
+} // anonymous
+
+TEST(Message, LogSite_BasenameIsComputedAtCompileTime) {
+   static_assert(g3::internal::basenameOffset("/a/b/file.cpp") == 5, "basename offset");
+   static_assert(g3::internal::basenameOffset("C:\\a\\file.cpp") == 5, "basename offset");
+   static_assert(g3::internal::basenameOffset("file.cpp") == 0, "basename offset");
+   const g3::LogSite* site = siteOfThisLine();
+#if !defined(G3_LOG_FULL_FILENAME)
+   EXPECT_STREQ("test_message.cpp", site->file);
+#endif
+   EXPECT_EQ(std::string(__FILE__), site->file_path);
+   EXPECT_NE(std::string::npos, std::string(site->function).find("siteOfThisLine"));
+}
+
+TEST(Message, LogSite_SameSiteSameRecord) {
+   const g3::LogSite* first = siteOfThisLine();
+   const g3::LogSite* second = siteOfThisLine();
+   const g3::LogSite* other = G3LOG_SITE();
+   EXPECT_EQ(first, second);
+   EXPECT_NE(first, other);
+   EXPECT_NE(first->id, other->id);
+
+   // a site registered at runtime, with the same file, line and function, gets the same record
+   EXPECT_EQ(first, g3::internal::registerSite(first->file_path, first->line, first->function));
+
+   g3::LogMessage message(first, G3LOG_INFO);
+   EXPECT_EQ(first, message._site);
+   EXPECT_EQ(std::to_string(first->line), message.line());
+   EXPECT_EQ(first->file, message.file());
+}
+
+TEST(Message, LogSite_RuntimeSite_ReusedStringsAreComparedOnContent) {
+   std::string file = "runtime_site.cpp";
+   std::string function = "one";
+   const g3::LogSite* one = g3::internal::registerSite(file.c_str(), 10, function.c_str());
+   function = "two"; // same address, the small string is stored inline
+   const g3::LogSite* two = g3::internal::registerSite(file.c_str(), 10, function.c_str());
+   function = "one";
+   EXPECT_NE(one, two);
+   EXPECT_STREQ("two", two->function);
+   EXPECT_EQ(one, g3::internal::registerSite(file.c_str(), 10, function.c_str()));
+}
+
+TEST(Message, LogSite_SignalMessage_HasTheConstantSite) {
+   g3::LogMessage message(std::string("crash"));
+   EXPECT_EQ(&g3::internal::kSignalSite, message._site);
+   EXPECT_NE(g3::internal::kSignalSite.id, siteOfThisLine()->id);
+   EXPECT_EQ("crash", message.message());
+}
+
+#if !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+namespace {
+   // in a child process, the full registry would change the sites of the other tests
+   void fillTheSiteRegistry() {
+      const g3::LogSite* last = nullptr;
+      for (int line = 1; line <= 70000; ++line) {
+         last = g3::internal::registerSite("fill_registry.cpp", line, "fill");
+      }
+      const bool shared_record = (0 == last->line) && std::string::npos != std::string(last->file_path).find("too many");
+      g3::LogMessage message("fill_registry.cpp", 70001, "fill", G3LOG_INFO);
+      std::exit((shared_record && "70001" == message.line()) ? 0 : 1);
+   }
+} // anonymous
+
+TEST(Message, LogSite_RegistryIsBounded) {
+   EXPECT_EXIT(fillTheSiteRegistry(), ::testing::ExitedWithCode(0), "");
+}
+#endif
+
 
 #if defined(CHANGE_G3LOG_DEBUG_TO_DBUG)
 TEST(Level, G3LogDebug_is_DBUG) {
@@ -551,5 +696,66 @@ TEST(Level, Addlevel__enabled) {
    EXPECT_EQ(status, g3::log_levels::status::Enabled);
 }
 
+TEST(Level, LevelTable_CheckDoesNotAddTheLevel) {
+   std::shared_ptr<void> RaiiLeveReset(nullptr, [&](void*) {
+      g3::only_change_at_initialization::reset();
+   });
+
+   const LEVELS in_range {100, "InRange"};
+   const LEVELS out_of_range {5000, "OutOfRange"};
+   for (auto& level : {in_range, out_of_range}) {
+      EXPECT_FALSE(g3::logLevel(level));
+      EXPECT_EQ(g3::log_levels::status::Absent, g3::log_levels::getStatus(level));
+
+      g3::only_change_at_initialization::addLogLevel(level);
+      EXPECT_TRUE(g3::logLevel(level));
+      g3::log_levels::disable(level);
+      EXPECT_FALSE(g3::logLevel(level));
+      EXPECT_EQ(g3::log_levels::status::Disabled, g3::log_levels::getStatus(level));
+   }
+
+   g3::only_change_at_initialization::reset();
+   EXPECT_FALSE(g3::logLevel(in_range));
+   EXPECT_FALSE(g3::logLevel(out_of_range));
+}
+
+TEST(Level, LevelTable_ChangedWhileOtherThreadsCheckLevels) {
+   std::shared_ptr<void> RaiiLeveReset(nullptr, [&](void*) {
+      g3::only_change_at_initialization::reset();
+   });
+
+   const LEVELS custom {100, "Custom"};
+   g3::only_change_at_initialization::addLogLevel(custom, false);
+   std::atomic<bool> stop{false};
+   std::atomic<size_t> enabled_seen{0};
+   std::vector<std::thread> readers;
+   for (int thread = 0; thread < 4; ++thread) {
+      readers.push_back(std::thread([&] {
+         while (!stop.load()) {
+            if (g3::logLevel(custom)) {
+               ++enabled_seen;
+            }
+            EXPECT_TRUE(g3::logLevel(G3LOG_WARNING));
+         }
+      }));
+   }
+
+   for (int round = 0; round < 10000; ++round) {
+      g3::log_levels::set(custom, 0 == round % 2);
+      g3::log_levels::setHighest(0 == round % 2 ? G3LOG_DEBUG : G3LOG_INFO);
+      g3::log_levels::enable(G3LOG_WARNING);
+   }
+   g3::log_levels::enable(custom);
+   stop = true;
+   for (auto& reader : readers) {
+      reader.join();
+   }
+
+   EXPECT_TRUE(g3::logLevel(custom));
+   EXPECT_FALSE(g3::logLevel(G3LOG_DEBUG));
+   EXPECT_TRUE(g3::logLevel(G3LOG_INFO));
+   EXPECT_EQ(g3::log_levels::status::Enabled, g3::log_levels::getStatus(custom));
+}
+
 #endif // G3_DYNAMIC_LOGGING
 
@@ -0,0 +1,134 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include "g3log/shared_queue.hpp"
+#include "g3log/lockfree_queue.hpp"
+#include "g3log/active.hpp"
+#include "g3log/future.hpp"
+
+namespace {
+   const int kProducers = 8;
+   const int kItemsPerProducer = 20000;
+
+   // item = producer * kItemsPerProducer + sequence number
+   template<typename Queue>
+   void verifyManyProducersOneConsumer() {
+      Queue queue;
+      std::vector<std::thread> producers;
+      for (int producer = 0; producer < kProducers; ++producer) {
+         producers.push_back(std::thread([&queue, producer] {
+            for (int index = 0; index < kItemsPerProducer; ++index) {
+               queue.push(producer * kItemsPerProducer + index);
+            }
+         }));
+      }
+
+      std::vector<int> last_seen(kProducers, -1);
+      for (int received = 0; received < kProducers * kItemsPerProducer; ++received) {
+         int item = -1;
+         queue.wait_and_pop(item);
+         const int producer = item / kItemsPerProducer;
+         const int sequence = item % kItemsPerProducer;
+         ASSERT_LT(last_seen[producer], sequence) << "FIFO order broken for producer " << producer;
+         last_seen[producer] = sequence;
+      }
+
+      for (auto& t : producers) {
+         t.join();
+      }
+      EXPECT_TRUE(queue.empty());
+      EXPECT_EQ(0u, queue.size());
+      for (auto sequence : last_seen) {
+         EXPECT_EQ(kItemsPerProducer - 1, sequence);
+      }
+   }
+} // anonymous
+
+
+TEST(Queue, SharedQueue_ManyProducers_FifoPerProducer) {
+   verifyManyProducersOneConsumer<shared_queue<int>>();
+}
+
+TEST(Queue, LockfreeQueue_ManyProducers_FifoPerProducer) {
+   verifyManyProducersOneConsumer<lockfree_queue<int>>();
+}
+
+TEST(Queue, LockfreeQueue_TryAndPop) {
+   lockfree_queue<std::string> queue;
+   std::string item;
+   EXPECT_FALSE(queue.try_and_pop(item));
+   queue.push("hello");
+   queue.push("world");
+   EXPECT_EQ(2u, queue.size());
+   EXPECT_TRUE(queue.try_and_pop(item));
+   EXPECT_EQ("hello", item);
+   EXPECT_TRUE(queue.try_and_pop(item));
+   EXPECT_EQ("world", item);
+   EXPECT_FALSE(queue.try_and_pop(item));
+   EXPECT_TRUE(queue.empty());
+}
+
+TEST(Queue, LockfreeQueue_SleepingConsumerIsWokenUp) {
+   lockfree_queue<int> queue;
+   std::atomic<int> received{0};
+   std::thread consumer([&] {
+      for (int index = 0; index < 10; ++index) {
+         int item = 0;
+         queue.wait_and_pop(item);
+         received += item;
+      }
+   });
+
+   for (int index = 0; index < 10; ++index) {
+      // give the consumer time to go to sleep between each push
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      queue.push(1);
+   }
+   consumer.join();
+   EXPECT_EQ(10, received.load());
+}
+
+TEST(Queue, LockfreeQueue_UnpoppedItemsAreReleased) {
+   auto counter = std::make_shared<int>(0);
+   {
+      lockfree_queue<std::shared_ptr<int>> queue;
+      queue.push(counter);
+      queue.push(counter);
+      EXPECT_EQ(3, counter.use_count());
+   }
+   EXPECT_EQ(1, counter.use_count());
+}
+
+TEST(Queue, Active_ManyProducers_AllCallbacksExecuted) {
+   std::atomic<int> count{0};
+   {
+      std::unique_ptr<kjellkod::Active> active(kjellkod::Active::createActive());
+      std::vector<std::thread> producers;
+      for (int producer = 0; producer < kProducers; ++producer) {
+         producers.push_back(std::thread([&] {
+            for (int index = 0; index < 1000; ++index) {
+               active->send([&count] { ++count; });
+            }
+         }));
+      }
+      for (auto& t : producers) {
+         t.join();
+      }
+      auto done = g3::spawn_task([&count] { return count.load(); }, active.get());
+      EXPECT_EQ(kProducers * 1000, done.get());
+   }
+   EXPECT_EQ(kProducers * 1000, count.load());
+}
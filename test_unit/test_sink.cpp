@@ -15,11 +15,17 @@
 #include <chrono>
 #include <string>
 #include <future>
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <limits>
 #include <g3log/generated_definitions.hpp>
 #include "testing_helpers.h"
 #include "g3log/logmessage.hpp"
+#include "g3log/g3log.hpp"
 #include "g3log/logworker.hpp"
 #include "g3log/std2_make_unique.hpp"
+#include "g3log/threadrings.hpp"
 
 using namespace testing_helpers;
 using namespace std;
@@ -231,3 +237,684 @@ TEST(ConceptSink, DISABLED_AggressiveThreadCallsDuringShutdown) {
 }
 
 
+
+
+
+TEST(Sink, PerThreadRings_AllMessagesDelivered_FifoPerThread) {
+   using namespace g3;
+   const int kThreads = 8;
+   const int kMessagesPerThread = 5000;
+   std::vector<std::string> received;
+   {
+      LogWorkerOptions options;
+      options.per_thread_rings = true;
+      options.ring_capacity = 64; // small, to exercise the back pressure
+      auto worker = LogWorker::createLogWorker(options);
+      auto handle = worker->addSink(std2::make_unique<MessageCollector>(&received), &MessageCollector::receiveMsg);
+
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < kThreads; ++thread) {
+         threads.push_back(std::thread([&worker, thread] {
+            for (int index = 0; index < kMessagesPerThread; ++index) {
+               saveToWorker(*worker, std::to_string(thread) + " " + std::to_string(index));
+            }
+         }));
+      }
+      for (auto& t : threads) {
+         t.join();
+      }
+   } // all rings are drained at LogWorker destruction
+
+   ASSERT_EQ(static_cast<size_t>(kThreads * kMessagesPerThread), received.size());
+   std::vector<int> last_seen(kThreads, -1);
+   for (auto& message : received) {
+      const auto space = message.find(' ');
+      const int thread = std::stoi(message.substr(0, space));
+      const int index = std::stoi(message.substr(space + 1));
+      ASSERT_EQ(last_seen[thread] + 1, index) << "FIFO order broken for thread " << thread;
+      last_seen[thread] = index;
+   }
+}
+
+TEST(Sink, PerThreadRings_WorkerCanBeReplaced) {
+   using namespace g3;
+   LogWorkerOptions options;
+   options.per_thread_rings = true;
+   for (int cycle = 0; cycle < 3; ++cycle) {
+      std::vector<std::string> received;
+      {
+         auto worker = LogWorker::createLogWorker(options);
+         auto handle = worker->addSink(std2::make_unique<MessageCollector>(&received), &MessageCollector::receiveMsg);
+         for (int index = 0; index < 10; ++index) {
+            saveToWorker(*worker, std::to_string(index));
+         }
+      }
+      ASSERT_EQ(10u, received.size());
+      EXPECT_EQ("0", received.front());
+      EXPECT_EQ("9", received.back());
+   }
+}
+
+namespace {
+   // forwarded messages and fatal messages, in the order the merging thread forwards them
+   struct RingsForwarded {
+      std::mutex mutex;
+      std::vector<std::string> entries;
+      std::promise<void> fatal_seen;
+      bool fatal_signaled = false;
+
+      g3::internal::ThreadRings::BatchCall batchCall() {
+         return [this](g3::internal::ThreadRings::Batch batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& entry : *batch) {
+               entries.push_back(entry->message());
+            }
+         };
+      }
+
+      g3::internal::ThreadRings::FatalCall fatalCall() {
+         return [this](g3::FatalMessagePtr fatal_message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.push_back("FATAL " + fatal_message.get()->message());
+            if (!fatal_signaled) {
+               fatal_signaled = true;
+               fatal_seen.set_value();
+            }
+         };
+      }
+   };
+
+   g3::LogMessagePtr ringMessage(const std::string& text) {
+      g3::LogMessagePtr message{std2::make_unique<g3::LogMessage>("test", 0, "test", G3LOG_DEBUG)};
+      message.get()->write().append(text);
+      return message;
+   }
+
+   g3::FatalMessagePtr ringFatal(const std::string& text) {
+      g3::LogMessage details("test", 0, "test", G3LOG_FATAL);
+      details.write().append(text);
+      return g3::FatalMessagePtr{std2::make_unique<g3::FatalMessage>(details, SIGABRT)};
+   }
+} // anonymous
+
+TEST(Sink, PerThreadRings_FatalsAreQueued_AfterTheMessages) {
+   RingsForwarded forwarded;
+   {
+      g3::internal::ThreadRings rings(16, forwarded.batchCall(), forwarded.fatalCall());
+      for (int index = 0; index < 5; ++index) {
+         rings.save(ringMessage(std::to_string(index)));
+      }
+      rings.fatal(ringFatal("first"));
+      rings.fatal(ringFatal("second"));
+      rings.stop();
+   }
+
+   const std::vector<std::string> expected = {"0", "1", "2", "3", "4", "FATAL first", "FATAL second"};
+   EXPECT_EQ(expected, forwarded.entries);
+}
+
+TEST(Sink, PerThreadRings_FatalIsForwarded_WhileOtherThreadsKeepLogging) {
+   RingsForwarded forwarded;
+   g3::internal::ThreadRings rings(64, forwarded.batchCall(), forwarded.fatalCall());
+   std::atomic<bool> keep_logging{true};
+   std::vector<std::thread> threads;
+   for (int thread = 0; thread < 4; ++thread) {
+      threads.push_back(std::thread([&] {
+         while (keep_logging.load()) {
+            rings.save(ringMessage("busy"));
+         }
+      }));
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+   rings.fatal(ringFatal("crash"));
+   const auto status = forwarded.fatal_seen.get_future().wait_for(std::chrono::seconds(10));
+   keep_logging.store(false);
+   for (auto& t : threads) {
+      t.join();
+   }
+   rings.stop();
+   EXPECT_EQ(std::future_status::ready, status);
+}
+
+TEST(Sink, PerThreadRings_SavedAfterStop_AreCountedAsDropped) {
+   RingsForwarded forwarded;
+   g3::internal::ThreadRings rings(16, forwarded.batchCall(), forwarded.fatalCall());
+   rings.save(ringMessage("kept"));
+   rings.stop();
+   for (int index = 0; index < 3; ++index) {
+      rings.save(ringMessage("late"));
+   }
+
+   EXPECT_EQ(3u, rings.dropped());
+   ASSERT_EQ(1u, forwarded.entries.size());
+   EXPECT_EQ("kept", forwarded.entries.front());
+}
+
+TEST(Sink, PerThreadRings_SavedWhileStopping_AreForwardedOrCountedAsDropped) {
+   for (int round = 0; round < 20; ++round) {
+      RingsForwarded forwarded;
+      g3::internal::ThreadRings rings(64, forwarded.batchCall(), forwarded.fatalCall());
+      std::atomic<size_t> saved{0};
+      std::atomic<bool> keep_logging{true};
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < 4; ++thread) {
+         threads.push_back(std::thread([&] {
+            while (keep_logging.load()) {
+               rings.save(ringMessage("busy"));
+               ++saved;
+            }
+         }));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      rings.stop();
+      keep_logging.store(false);
+      for (auto& t : threads) {
+         t.join();
+      }
+      EXPECT_EQ(saved.load(), forwarded.entries.size() + rings.dropped()) << round;
+   }
+}
+
+
+
+namespace {
+   // a slow sink: blocked until the gate is opened
+   struct GatedSink {
+      std::shared_future<void> gate;
+      explicit GatedSink(std::shared_future<void> open) : gate(open) {}
+      void receiveMsg(g3::LogMessageMover) {
+         gate.wait();
+      }
+   };
+
+   // @return number of dropped messages reported by the "N messages dropped" summaries
+   size_t reportedDrops(const std::vector<std::string>& received, size_t* summaries) {
+      size_t dropped = 0;
+      *summaries = 0;
+      const std::string kSummary = " messages dropped";
+      for (auto& message : received) {
+         const auto pos = message.find(kSummary);
+         if (pos != std::string::npos && pos + kSummary.size() == message.size()) {
+            dropped += std::stoul(message.substr(0, pos));
+            ++(*summaries);
+         }
+      }
+      return dropped;
+   }
+
+   // @return messages dropped by the LogWorker
+   size_t floodBoundedWorker(g3::OverflowPolicy policy, size_t max_queue_size, int threads, int messages_per_thread,
+                             std::vector<std::string>* received) {
+      using namespace g3;
+      LogWorkerOptions options;
+      options.max_queue_size = max_queue_size;
+      options.overflow_policy = policy;
+      auto worker = LogWorker::createLogWorker(options);
+      auto handle = worker->addSink(std2::make_unique<MessageCollector>(received), &MessageCollector::receiveMsg);
+
+      std::vector<std::thread> producers;
+      for (int thread = 0; thread < threads; ++thread) {
+         producers.push_back(std::thread([&worker, messages_per_thread] {
+            for (int index = 0; index < messages_per_thread; ++index) {
+               // every tenth message is important
+               const LEVELS level = (index % 10 == 0) ? G3LOG_WARNING : G3LOG_DEBUG;
+               saveToWorker(*worker, index % 10 == 0 ? "important" : "noise", level);
+            }
+         }));
+      }
+      for (auto& t : producers) {
+         t.join();
+      }
+      return worker->droppedMessages();
+   }
+} // anonymous
+
+
+TEST(Sink, BoundedQueue_Block_NothingIsDropped) {
+   std::vector<std::string> received;
+   const size_t dropped = floodBoundedWorker(g3::OverflowPolicy::Block, 4, 4, 5000, &received);
+   EXPECT_EQ(0u, dropped);
+   EXPECT_EQ(4u * 5000u, received.size());
+}
+
+TEST(Sink, BoundedQueue_DropNewestAndDropOldest_DropsAreCountedAndReported) {
+   for (auto policy : {g3::OverflowPolicy::DropNewest, g3::OverflowPolicy::DropOldest}) {
+      std::vector<std::string> received;
+      const size_t total = 8 * 10000;
+      const size_t dropped = floodBoundedWorker(policy, 1, 8, 10000, &received);
+      EXPECT_GT(dropped, 0u);
+
+      size_t summaries = 0;
+      EXPECT_EQ(dropped, reportedDrops(received, &summaries));
+      EXPECT_EQ(total, received.size() - summaries + dropped);
+      // messages saved after the last drop can follow the last summary
+      EXPECT_LT(0u, summaries);
+   }
+}
+
+TEST(Sink, BoundedQueue_DropBelowLevel_ImportantMessagesAreKept) {
+   std::vector<std::string> received;
+   const size_t dropped = floodBoundedWorker(g3::OverflowPolicy::DropBelowLevel, 1, 8, 10000, &received);
+   EXPECT_GT(dropped, 0u);
+   const auto important = std::count(received.begin(), received.end(), "important");
+   EXPECT_EQ(8 * 1000, important);
+
+   size_t summaries = 0;
+   EXPECT_EQ(dropped, reportedDrops(received, &summaries));
+}
+
+TEST(Sink, BoundedQueue_SlowSink_MessagesInFlightStayBounded) {
+   using namespace g3;
+   const size_t kMaxQueueSize = 64;
+   const size_t kMessages = 20000;
+   std::promise<void> open;
+   LogWorkerOptions options;
+   options.max_queue_size = kMaxQueueSize;
+   options.overflow_policy = OverflowPolicy::DropNewest;
+   auto worker = LogWorker::createLogWorker(options);
+   auto handle = worker->addSink(std2::make_unique<GatedSink>(open.get_future().share()), &GatedSink::receiveMsg);
+   for (size_t index = 0; index < kMessages; ++index) {
+      saveToWorker(*worker);
+   }
+
+   // The sink has not processed anything, every message that is not dropped is still in memory:
+   // max_queue_size in the queue, and max_queue_size taken by the background worker or waiting for the sink
+   const size_t in_flight = kMessages - worker->droppedMessages();
+   EXPECT_LE(in_flight, 2 * kMaxQueueSize);
+   open.set_value();
+}
+
+
+
+namespace {
+   struct SharedMessageCollector {
+      std::vector<std::shared_ptr<const g3::LogMessage>>* messages;
+      explicit SharedMessageCollector(std::vector<std::shared_ptr<const g3::LogMessage>>* storage) : messages(storage) {}
+      void receiveMsg(g3::LogMessageMover message) {
+         messages->push_back(message.share());
+      }
+   };
+} // anonymous
+
+TEST(Sink, ManySinks_ShareTheSameMessage_NoCopies) {
+   using namespace g3;
+   std::vector<std::shared_ptr<const LogMessage>> first, second;
+   {
+      auto worker = LogWorker::createLogWorker();
+      auto handle1 = worker->addSink(std2::make_unique<SharedMessageCollector>(&first), &SharedMessageCollector::receiveMsg);
+      auto handle2 = worker->addSink(std2::make_unique<SharedMessageCollector>(&second), &SharedMessageCollector::receiveMsg);
+      saveToWorker(*worker, "shared");
+   }
+   ASSERT_EQ(1u, first.size());
+   ASSERT_EQ(1u, second.size());
+   EXPECT_EQ(first[0].get(), second[0].get());
+   EXPECT_EQ("shared", first[0]->message());
+
+   // a sink can still get its own, modifiable, copy
+   LogMessage copy = LogMessageMover(first[0]).release();
+   copy.write().append(" and modified");
+   EXPECT_EQ("shared", first[0]->message());
+   EXPECT_EQ("shared and modified", copy.message());
+}
+
+TEST(Sink, StderrThreshold_CopiedOncePerMessage_OffByDefault) {
+   using namespace g3;
+   EXPECT_GT(FLAGS_stderrthreshold, G3LOG_FATAL.value);
+
+   std::ostringstream captured;
+   auto original_buffer = std::cerr.rdbuf(captured.rdbuf());
+   FLAGS_stderrthreshold = G3LOG_WARNING.value;
+   {
+      std::vector<std::string> first, second;
+      auto worker = LogWorker::createLogWorker();
+      worker->addSink(std2::make_unique<MessageCollector>(&first), &MessageCollector::receiveMsg);
+      worker->addSink(std2::make_unique<MessageCollector>(&second), &MessageCollector::receiveMsg);
+      for (auto level : {G3LOG_INFO, G3LOG_WARNING}) {
+         saveToWorker(*worker, std::string("at-") + level.text, level);
+      }
+   }
+   FLAGS_stderrthreshold = std::numeric_limits<int32_t>::max();
+   std::cerr.rdbuf(original_buffer);
+
+   const std::string output = captured.str();
+   EXPECT_EQ(std::string::npos, output.find("at-INFO")) << output;
+   const auto warning = output.find("at-WARNING");
+   ASSERT_NE(std::string::npos, warning) << output;
+   EXPECT_EQ(std::string::npos, output.find("at-WARNING", warning + 1)) << output;
+}
+
+
+
+namespace {
+   struct BatchCollector {
+      std::vector<size_t>* batch_sizes;
+      std::vector<std::string>* messages;
+      BatchCollector(std::vector<size_t>* sizes, std::vector<std::string>* storage) : batch_sizes(sizes), messages(storage) {}
+      void receiveBatch(const g3::LogMessageBatch& batch) {
+         batch_sizes->push_back(batch.size());
+         for (auto& message : batch) {
+            messages->push_back(message.get().message());
+         }
+      }
+   };
+} // anonymous
+
+TEST(Sink, BatchSink_ReceivesAllSavedMessagesInOneGo) {
+   using namespace g3;
+   std::vector<size_t> batch_sizes;
+   std::vector<std::string> received;
+   auto sink = std::make_shared<internal::Sink<BatchCollector>>(std2::make_unique<BatchCollector>(&batch_sizes, &received), &BatchCollector::receiveBatch);
+   {
+      LogWorkerImpl impl {LogWorkerOptions()};
+      g3::spawn_task([&impl, sink] { impl._sinks.push_back(sink); }, impl._bg.get()).wait();
+
+      // the background worker is kept busy while the messages are saved
+      std::promise<void> go;
+      std::shared_future<void> wait_for_go(go.get_future());
+      impl._bg->send([wait_for_go] { wait_for_go.wait(); });
+      for (int index = 0; index < 100; ++index) {
+         std::unique_ptr<LogMessage> message {new LogMessage("test", 0, "test", G3LOG_DEBUG)};
+         message->write().append(std::to_string(index));
+         impl.save(std::move(message));
+      }
+      go.set_value();
+      g3::spawn_task([] {}, impl._bg.get()).wait();
+   }
+   sink.reset(); // waits for the sink's queue
+
+   ASSERT_EQ(1u, batch_sizes.size());
+   EXPECT_EQ(100u, batch_sizes[0]);
+   ASSERT_EQ(100u, received.size());
+   EXPECT_EQ("0", received.front());
+   EXPECT_EQ("99", received.back());
+}
+
+TEST(Sink, BatchSink_AddedThroughLogWorker) {
+   using namespace g3;
+   std::vector<size_t> batch_sizes;
+   std::vector<std::string> received;
+   {
+      auto worker = LogWorker::createLogWorker();
+      auto handle = worker->addSink(std2::make_unique<BatchCollector>(&batch_sizes, &received), &BatchCollector::receiveBatch);
+      for (int index = 0; index < 1000; ++index) {
+         saveToWorker(*worker, std::to_string(index));
+      }
+   }
+   ASSERT_EQ(1000u, received.size());
+   for (size_t index = 0; index < received.size(); ++index) {
+      ASSERT_EQ(std::to_string(index), received[index]);
+   }
+   size_t total = 0;
+   for (auto size : batch_sizes) {
+      EXPECT_LT(0u, size);
+      total += size;
+   }
+   EXPECT_EQ(1000u, total);
+}
+
+
+namespace {
+   // remembers the threads that ran the sink's calls
+   struct ThreadCollector {
+      std::vector<std::string>* messages;
+      std::set<std::thread::id>* threads;
+      ThreadCollector(std::vector<std::string>* message_storage, std::set<std::thread::id>* thread_storage)
+         : messages(message_storage), threads(thread_storage) {}
+      void receiveMsg(g3::LogMessageMover message) {
+         messages->push_back(message.get().message());
+         threads->insert(std::this_thread::get_id());
+      }
+      std::thread::id callThread() {
+         return std::this_thread::get_id();
+      }
+   };
+} // anonymous
+
+TEST(Sink, SinkExecutor_ManySinksOnTwoThreads_FifoPerSink) {
+   using namespace g3;
+   const size_t kSinks = 8;
+   const int kMessages = 2000;
+   std::vector<std::vector<std::string>> received(kSinks);
+   std::vector<std::set<std::thread::id>> threads(kSinks);
+   auto executor = SinkExecutor::create(2);
+   EXPECT_EQ(2u, executor->threadCount());
+   {
+      LogWorkerOptions options;
+      options.sink_executor = executor;
+      auto worker = LogWorker::createLogWorker(options);
+      std::vector<std::unique_ptr<SinkHandle<ThreadCollector>>> handles;
+      for (size_t index = 0; index < kSinks; ++index) {
+         handles.push_back(worker->addSink(std2::make_unique<ThreadCollector>(&received[index], &threads[index]), &ThreadCollector::receiveMsg));
+      }
+      for (int index = 0; index < kMessages; ++index) {
+         saveToWorker(*worker, std::to_string(index));
+      }
+   }
+
+   std::set<std::thread::id> all_threads;
+   for (size_t sink = 0; sink < kSinks; ++sink) {
+      ASSERT_EQ(static_cast<size_t>(kMessages), received[sink].size());
+      for (int index = 0; index < kMessages; ++index) {
+         ASSERT_EQ(std::to_string(index), received[sink][index]) << "sink " << sink;
+      }
+      all_threads.insert(threads[sink].begin(), threads[sink].end());
+   }
+   EXPECT_GE(2u, all_threads.size());
+   EXPECT_EQ(0u, all_threads.count(std::this_thread::get_id()));
+}
+
+TEST(Sink, SinkExecutor_SinkHandleCall_RunsOnTheExecutor) {
+   using namespace g3;
+   std::vector<std::string> received;
+   std::set<std::thread::id> threads;
+   auto executor = SinkExecutor::create(0);
+   EXPECT_LE(1u, executor->threadCount());
+   std::unique_ptr<SinkHandle<ThreadCollector>> handle;
+   {
+      LogWorkerOptions options;
+      options.sink_executor = executor;
+      auto worker = LogWorker::createLogWorker(options);
+      handle = worker->addSink(std2::make_unique<ThreadCollector>(&received, &threads), &ThreadCollector::receiveMsg);
+      EXPECT_NE(std::this_thread::get_id(), handle->call(&ThreadCollector::callThread).get());
+      saveToWorker(*worker, "last");
+   }
+   // the LogWorker is gone, the sink is deleted
+   EXPECT_ANY_THROW(handle->call(&ThreadCollector::callThread).get());
+   ASSERT_EQ(1u, received.size());
+   EXPECT_EQ("last", received[0]);
+}
+
+
+namespace {
+   // @return true once all the sinks have processed the messages
+   bool waitForSinks(const g3::LogWorker& worker, uint64_t messages) {
+      for (int attempt = 0; attempt < 5000; ++attempt) {
+         const auto stats = worker.stats();
+         const bool done = std::all_of(stats.sinks.begin(), stats.sinks.end(), [messages](const g3::SinkStats & sink) {
+            return sink.processed == messages;
+         });
+         if (done) {
+            return true;
+         }
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return false;
+   }
+} // anonymous
+
+TEST(Sink, Telemetry_NotEnabled_OnlyDroppedIsCounted) {
+   using namespace g3;
+   std::vector<std::string> received;
+   auto worker = LogWorker::createLogWorker();
+   auto handle = worker->addSink(std2::make_unique<MessageCollector>(&received), &MessageCollector::receiveMsg);
+   saveToWorker(*worker);
+
+   const auto stats = worker->stats();
+   EXPECT_FALSE(stats.enabled);
+   EXPECT_EQ(0u, stats.enqueued);
+   EXPECT_EQ(0u, stats.dropped);
+   EXPECT_TRUE(stats.sinks.empty());
+}
+
+TEST(Sink, Telemetry_ManyThreads_AllMessagesCounted) {
+   using namespace g3;
+   const int kThreads = 4;
+   const int kMessagesPerThread = 2500;
+   const uint64_t kMessages = kThreads * kMessagesPerThread;
+   const std::string text = "0123456789";
+   std::vector<std::string> first, second;
+   LogWorkerOptions options;
+   options.telemetry = true;
+   auto worker = LogWorker::createLogWorker(options);
+   auto first_handle = worker->addSink(std2::make_unique<MessageCollector>(&first), &MessageCollector::receiveMsg);
+   auto second_handle = worker->addSink(std2::make_unique<MessageCollector>(&second), &MessageCollector::receiveMsg);
+
+   std::vector<std::thread> producers;
+   for (int thread = 0; thread < kThreads; ++thread) {
+      producers.push_back(std::thread([&] {
+         for (int index = 0; index < kMessagesPerThread; ++index) {
+            saveToWorker(*worker, text);
+         }
+      }));
+   }
+   for (auto& producer : producers) {
+      producer.join();
+   }
+   ASSERT_TRUE(waitForSinks(*worker, kMessages));
+
+   const auto stats = worker->stats();
+   EXPECT_TRUE(stats.enabled);
+   EXPECT_EQ(kMessages, stats.enqueued);
+   EXPECT_EQ(kMessages, stats.processed);
+   EXPECT_EQ(0u, stats.dropped);
+   EXPECT_EQ(0u, stats.queue_depth);
+   EXPECT_LE(1u, stats.queue_high_water);
+   EXPECT_GE(kMessages, stats.queue_high_water);
+   EXPECT_EQ(kMessages * text.size(), stats.bytes_formatted);
+   ASSERT_EQ(2u, stats.sinks.size());
+   for (const auto& sink : stats.sinks) {
+      EXPECT_EQ(kMessages, sink.received);
+      EXPECT_EQ(0u, sink.backlog);
+      EXPECT_LT(0, sink.busy_time.count());
+      EXPECT_EQ(kMessages, sink.latency.count);
+      EXPECT_LE(sink.latency.p50, sink.latency.p99);
+      EXPECT_LE(sink.latency.p99, sink.latency.max);
+   }
+   EXPECT_EQ(2 * kMessages, stats.latency.count);
+   EXPECT_EQ(std::max(stats.sinks[0].latency.max, stats.sinks[1].latency.max), stats.latency.max);
+}
+
+TEST(Sink, Telemetry_BlockedSink_BacklogAndLatency) {
+   using namespace g3;
+   const uint64_t kMessages = 100;
+   std::promise<void> open;
+   LogWorkerOptions options;
+   options.telemetry = true;
+   auto worker = LogWorker::createLogWorker(options);
+   auto handle = worker->addSink(std2::make_unique<GatedSink>(open.get_future().share()), &GatedSink::receiveMsg);
+   for (uint64_t index = 0; index < kMessages; ++index) {
+      saveToWorker(*worker);
+   }
+
+   // the background worker is done, the sink is not
+   for (int attempt = 0; attempt < 5000 && worker->stats().processed < kMessages; ++attempt) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   const auto blocked = worker->stats();
+   EXPECT_EQ(kMessages, blocked.processed);
+   EXPECT_EQ(0u, blocked.queue_depth);
+   ASSERT_EQ(1u, blocked.sinks.size());
+   EXPECT_EQ(kMessages, blocked.sinks[0].received);
+   EXPECT_EQ(0u, blocked.sinks[0].processed);
+   EXPECT_EQ(kMessages, blocked.sinks[0].backlog);
+
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   open.set_value();
+   ASSERT_TRUE(waitForSinks(*worker, kMessages));
+   const auto done = worker->stats();
+   EXPECT_EQ(0u, done.sinks[0].backlog);
+   EXPECT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(20)), done.sinks[0].busy_time);
+   EXPECT_EQ(kMessages, done.latency.count);
+   EXPECT_LE(std::chrono::nanoseconds(std::chrono::microseconds(1)), done.latency.p50);
+}
+
+TEST(Sink, Telemetry_PerThreadCounter_ThreadsComeAndGo) {
+   g3::internal::PerThreadCounter counter;
+   for (int round = 0; round < 10; ++round) {
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < 4; ++thread) {
+         threads.push_back(std::thread([&counter] {
+            for (int index = 0; index < 1000; ++index) {
+               counter.add(1);
+            }
+         }));
+      }
+      for (auto& thread : threads) {
+         thread.join();
+      }
+   }
+   counter.add(5);
+   EXPECT_EQ(40005u, counter.sum());
+}
+
+TEST(Sink, Telemetry_PerThreadCounter_ThreadAddsToManyCounters) {
+   // two counters, as of two LogWorkers, and more counters than a thread keeps slots of
+   for (size_t counters : {2u, 6u}) {
+      std::vector<std::unique_ptr<g3::internal::PerThreadCounter>> all;
+      for (size_t index = 0; index < counters; ++index) {
+         all.emplace_back(new g3::internal::PerThreadCounter);
+      }
+      std::vector<std::thread> threads;
+      for (int thread = 0; thread < 4; ++thread) {
+         threads.push_back(std::thread([&all] {
+            for (int index = 0; index < 1000; ++index) {
+               for (auto& counter : all) {
+                  counter->add(1);
+               }
+            }
+         }));
+      }
+      for (auto& thread : threads) {
+         thread.join();
+      }
+      for (auto& counter : all) {
+         EXPECT_EQ(4000u, counter->sum()) << counters;
+      }
+   }
+}
+
+TEST(Sink, Telemetry_BoundedQueue_WaitsAreCounted) {
+   using namespace g3;
+   const size_t kMaxQueueSize = 4;
+   const uint64_t kMessages = 50 * kMaxQueueSize; // well over the messages in flight, ref: max_queue_size
+   std::promise<void> open;
+   LogWorkerOptions options;
+   options.telemetry = true;
+   options.max_queue_size = kMaxQueueSize;
+   options.overflow_policy = OverflowPolicy::Block;
+   auto worker = LogWorker::createLogWorker(options);
+   auto handle = worker->addSink(std2::make_unique<GatedSink>(open.get_future().share()), &GatedSink::receiveMsg);
+
+   // the sink holds the background worker, which lets the queue fill up
+   std::thread producer([&worker, kMessages] {
+      for (uint64_t index = 0; index < kMessages; ++index) {
+         saveToWorker(*worker);
+      }
+   });
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   // the producer is stuck in a LOG call, waiting for room in the full queue
+   EXPECT_GT(kMessages, worker->stats().enqueued);
+   open.set_value();
+   producer.join();
+   ASSERT_TRUE(waitForSinks(*worker, kMessages));
+
+   const auto stats = worker->stats();
+   EXPECT_EQ(0u, stats.dropped);
+   EXPECT_LE(1u, stats.room_waits);
+   EXPECT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(10)), stats.room_wait_time);
+   EXPECT_LE(1u, stats.sink_waits);
+   EXPECT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(10)), stats.sink_wait_time);
+   EXPECT_EQ(kMessages, stats.queue_wait.count);
+   EXPECT_LE(std::chrono::nanoseconds(std::chrono::milliseconds(10)), stats.queue_wait.max);
+}
@@ -78,6 +78,12 @@ namespace testing_helpers {
       // RAII of std::ifstream will automatically close the file
    }
 
+   void saveToWorker(g3::LogWorker &worker, const std::string &text, const LEVELS &level) {
+      LogMessagePtr message{std2::make_unique<LogMessage>("test", 0, "test", level)};
+      message.get()->write().append(text);
+      worker.save(message);
+   }
+
    size_t LogFileCleaner::size() {
       return logs_to_clean_.size();
    }
@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <atomic>
 #include <chrono>
 #include <thread>
@@ -29,6 +30,18 @@ namespace testing_helpers {
    bool removeFile(std::string path_to_file);
    bool verifyContent(const std::string &total_text, std::string msg_to_find);
    std::string readFileToText(std::string filename);
+
+   /// Saves a message with the text straight to the worker, as a LOG call does
+   void saveToWorker(g3::LogWorker &worker, const std::string &text = "", const LEVELS &level = G3LOG_DEBUG);
+
+   /// Sink that keeps the text of each message it receives
+   struct MessageCollector {
+      std::vector<std::string>* messages;
+      explicit MessageCollector(std::vector<std::string>* storage) : messages(storage) {}
+      void receiveMsg(g3::LogMessageMover message) {
+         messages->push_back(message.get().message());
+      }
+   };
    
    
    
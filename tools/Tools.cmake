@@ -0,0 +1,39 @@
+# g3log is a KjellKod Logger
+# 2015 @author Kjell Hedström, hedstrom@kjellkod.cc 
+# ==================================================================
+# 2015 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own
+#    risk and comes  with no warranties.
+#
+# This code is yours to share, use and modify with no strings attached
+#   and no restrictions or obligations.
+# ===================================================================
+
+
+
+# ==============================================================
+   #   -DADD_G3LOG_TOOLS=OFF   : to turn off the offline tools
+   #
+   #  Leaving it to ON will create
+   #                        g3log-decode   renders a binary log file (g3::BinaryFileSink) as text
+   #                        g3log-recover  extracts the last messages from a flight recorder file
+   #                        g3log-symbolize  resolves raw stack dumps, ref: g3::setRawStackDump (Linux)
+   #
+   # ==============================================================
+
+   set(DIR_TOOLS ${g3log_SOURCE_DIR}/tools)
+   option (ADD_G3LOG_TOOLS  "Offline tools for g3log's log files" ON)
+
+
+   IF (ADD_G3LOG_TOOLS)
+      message( STATUS "-DADD_G3LOG_TOOLS=ON\t\t\t[g3log-decode][g3log-recover]" )
+      add_executable(g3log-decode ${DIR_TOOLS}/g3log_decode.cpp)
+      add_executable(g3log-recover ${DIR_TOOLS}/g3log_recover.cpp)
+      target_link_libraries(g3log-decode ${G3LOG_LIBRARY} ${PLATFORM_LINK_LIBRIES})
+      target_link_libraries(g3log-recover ${G3LOG_LIBRARY} ${PLATFORM_LINK_LIBRIES})
+      IF (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
+         message( STATUS "\t\t\t\t\t[g3log-symbolize]" )
+         add_executable(g3log-symbolize ${DIR_TOOLS}/g3log_symbolize.cpp)
+      ENDIF()
+   ELSE()
+      message( STATUS "-DADD_G3LOG_TOOLS=OFF" )
+   ENDIF (ADD_G3LOG_TOOLS)
@@ -0,0 +1,72 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+// g3log-decode: renders binary log files, written by g3::BinaryFileSink, as text.
+// The lines look as written by the default FileSink, i.e. LogMessage::toString()
+//
+// usage: g3log-decode [-t] file.g3bin ...
+//    -t   each line is prefixed with the id of the thread that made the LOG call
+
+#include <g3log/binaryfilesink.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+   int usage() {
+      std::cerr << "usage: g3log-decode [-t] file.g3bin ..." << std::endl;
+      std::cerr << "\t-t   prefix each line with the thread id of the LOG call" << std::endl;
+      return 2;
+   }
+
+   bool decode(const std::string& file_name, bool with_thread_id) {
+      g3::BinaryLogReader reader(file_name);
+      if (!reader.good()) {
+         std::cerr << "g3log-decode: [" << file_name << "] is not a binary log file of this version" << std::endl;
+         return false;
+      }
+
+      std::unique_ptr<g3::LogMessage> message;
+      std::string thread_id;
+      while (reader.next(message, thread_id)) {
+         if (with_thread_id) {
+            std::cout << "[" << thread_id << "] ";
+         }
+         std::cout << message->toString();
+      }
+      std::cout << std::flush;
+
+      if (reader.truncated()) {
+         std::cerr << "g3log-decode: [" << file_name << "] ends with an incomplete record" << std::endl;
+      }
+      return true;
+   }
+} // anonymous
+
+
+int main(int argc, char** argv) {
+   bool with_thread_id = false;
+   int files = 0;
+   bool all_decoded = true;
+   for (int index = 1; index < argc; ++index) {
+      const std::string argument = argv[index];
+      if ("-t" == argument) {
+         with_thread_id = true;
+      } else if ("-h" == argument || "--help" == argument) {
+         return usage();
+      } else {
+         all_decoded = decode(argument, with_thread_id) && all_decoded;
+         ++files;
+      }
+   }
+   if (0 == files) {
+      return usage();
+   }
+   return all_decoded ? 0 : 1;
+}
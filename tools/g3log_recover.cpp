@@ -0,0 +1,71 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+// g3log-recover: extracts the most recent log messages from a flight recorder file,
+// ref: LogWorkerOptions::flight_recorder_file. The messages are written oldest first, the
+// lines look as written by the default FileSink, i.e. LogMessage::toString()
+//
+// usage: g3log-recover [-t] flight_recorder_file
+//    -t   each line is prefixed with the id of the thread that made the LOG call
+
+#include <g3log/flightrecorder.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace {
+   int usage() {
+      std::cerr << "usage: g3log-recover [-t] flight_recorder_file" << std::endl;
+      std::cerr << "\t-t   prefix each line with the thread id of the LOG call" << std::endl;
+      return 2;
+   }
+} // anonymous
+
+
+int main(int argc, char** argv) {
+   bool with_thread_id = false;
+   std::string file_name;
+   for (int index = 1; index < argc; ++index) {
+      const std::string argument = argv[index];
+      if ("-t" == argument) {
+         with_thread_id = true;
+      } else if ("-h" == argument || "--help" == argument || !file_name.empty()) {
+         return usage();
+      } else {
+         file_name = argument;
+      }
+   }
+   if (file_name.empty()) {
+      return usage();
+   }
+
+   g3::FlightRecorderReader reader(file_name);
+   if (!reader.good()) {
+      std::cerr << "g3log-recover: [" << file_name << "] is not a flight recorder file of this version" << std::endl;
+      return 1;
+   }
+
+   std::unique_ptr<g3::LogMessage> message;
+   std::string thread_id;
+   size_t count = 0;
+   while (reader.next(message, thread_id)) {
+      if (with_thread_id) {
+         std::cout << "[" << thread_id << "] ";
+      }
+      std::cout << message->toString();
+      ++count;
+   }
+   std::cout << std::flush;
+   std::cerr << "g3log-recover: " << count << " messages recovered";
+   if (reader.skipped() > 0) {
+      std::cerr << ", " << reader.skipped() << " incomplete records skipped";
+   }
+   std::cerr << std::endl;
+   return 0;
+}
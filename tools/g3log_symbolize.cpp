@@ -0,0 +1,324 @@
+/** ==========================================================================
+* 2018 by KjellKod.cc. This is PUBLIC DOMAIN to use at your own risk and comes
+* with no warranties. This code is yours to share, use and modify with no
+* strings attached and no restrictions or obligations.
+ *
+ * For more information see g3log/LICENSE or refer refer to http://unlicense.org
+* ============================================================================*/
+
+// g3log-symbolize: resolves the raw stack dumps of g3log, ref: g3::setRawStackDump, to function
+// names. The log is copied to stdout, each "raw frame" line is replaced by a "stack dump" line
+// as made by the default stack dump:
+//      stack dump [3]  ./app : example::crash(int)+0x1f [0x55d0c2a6e6f4]
+//
+// The frames are resolved with the symbol tables of the modules in the load map that follows
+// them. A module is only used if its GNU build-id matches the recorded one.
+//
+// usage: g3log-symbolize [-d debug_dir] [crash.log ...]
+//    -d   directory with separate debug files, looked up as <debug_dir>/.build-id/ab/cdef....debug
+//    without files the log is read from stdin
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <link.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+   struct Module {
+      uintptr_t low;
+      uintptr_t high;
+      uintptr_t bias;
+      std::string build_id;
+      std::string path;
+   };
+
+   struct Symbol {
+      uintptr_t address;
+      uintptr_t size;
+      std::string name;
+   };
+
+   // the function symbols of an ELF file, sorted by address
+   struct ElfFile {
+      bool good = false;
+      std::string build_id;
+      std::vector<Symbol> symbols;
+   };
+
+   std::string debugDirectory;
+   std::map<std::string, ElfFile> elfFiles; // by path
+
+
+   int usage() {
+      std::cerr << "usage: g3log-symbolize [-d debug_dir] [crash.log ...]" << std::endl;
+      std::cerr << "\t-d   directory with separate debug files, <debug_dir>/.build-id/ab/cdef....debug" << std::endl;
+      return 2;
+   }
+
+   std::string hexText(const unsigned char* bytes, size_t count) {
+      const char* const hex = "0123456789abcdef";
+      std::string text;
+      for (size_t index = 0; index < count; ++index) {
+         text.push_back(hex[bytes[index] >> 4]);
+         text.push_back(hex[bytes[index] & 0xf]);
+      }
+      return text;
+   }
+
+   template <typename T>
+   bool readAt(const std::string& content, size_t offset, T& value) {
+      if (offset > content.size() || content.size() - offset < sizeof(T)) {
+         return false;
+      }
+      std::memcpy(&value, content.data() + offset, sizeof(T));
+      return true;
+   }
+
+   // reads the symbol tables and the build-id note of a native ELF file
+   ElfFile readElf(const std::string& path) {
+      ElfFile elf;
+      std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+      const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      ElfW(Ehdr) header;
+      if (!readAt(content, 0, header) || 0 != std::memcmp(header.e_ident, ELFMAG, SELFMAG)
+            || sizeof(ElfW(Shdr)) != header.e_shentsize) {
+         return elf;
+      }
+
+      std::vector<ElfW(Shdr)> sections(header.e_shnum);
+      for (size_t index = 0; index < sections.size(); ++index) {
+         if (!readAt(content, header.e_shoff + index * sizeof(ElfW(Shdr)), sections[index])) {
+            return elf;
+         }
+      }
+
+      for (const auto& section : sections) {
+         if (SHT_NOTE == section.sh_type && elf.build_id.empty()) {
+            size_t offset = section.sh_offset;
+            const size_t end = std::min(content.size(), static_cast<size_t>(section.sh_offset + section.sh_size));
+            ElfW(Nhdr) note;
+            while (offset + sizeof(note) <= end && readAt(content, offset, note)) {
+               const size_t name = offset + sizeof(note);
+               const size_t description = name + ((note.n_namesz + 3) & ~3u);
+               if (NT_GNU_BUILD_ID == note.n_type && 4 == note.n_namesz && description + note.n_descsz <= end
+                     && 0 == std::memcmp(content.data() + name, "GNU", 4)) {
+                  elf.build_id = hexText(reinterpret_cast<const unsigned char*>(content.data() + description), note.n_descsz);
+                  break;
+               }
+               offset = description + ((note.n_descsz + 3) & ~3u);
+            }
+         }
+
+         if ((SHT_SYMTAB != section.sh_type && SHT_DYNSYM != section.sh_type) || section.sh_link >= sections.size()) {
+            continue;
+         }
+         const auto& names = sections[section.sh_link];
+         for (size_t offset = section.sh_offset; offset + sizeof(ElfW(Sym)) <= section.sh_offset + section.sh_size; offset += sizeof(ElfW(Sym))) {
+            ElfW(Sym) symbol;
+            if (!readAt(content, offset, symbol)) {
+               break;
+            }
+            if (STT_FUNC != ELF64_ST_TYPE(symbol.st_info) || 0 == symbol.st_value || symbol.st_name >= names.sh_size) {
+               continue;
+            }
+            const size_t name = names.sh_offset + symbol.st_name;
+            if (name >= content.size()) {
+               continue;
+            }
+            elf.symbols.push_back({static_cast<uintptr_t>(symbol.st_value), static_cast<uintptr_t>(symbol.st_size),
+                                   std::string(content.data() + name, strnlen(content.data() + name, content.size() - name))});
+         }
+      }
+
+      std::sort(elf.symbols.begin(), elf.symbols.end(), [](const Symbol& left, const Symbol& right) {
+         return left.address < right.address;
+      });
+      elf.good = true;
+      return elf;
+   }
+
+   const ElfFile& elfFile(const std::string& path) {
+      auto found = elfFiles.find(path);
+      if (found == elfFiles.end()) {
+         found = elfFiles.emplace(path, readElf(path)).first;
+      }
+      return found->second;
+   }
+
+   std::string demangle(const std::string& name) {
+      int status = 0;
+      char* real_name = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+      const std::string demangled = (0 == status && nullptr != real_name) ? real_name : name;
+      free(real_name); // mallocated by abi::__cxa_demangle(...)
+      return demangled;
+   }
+
+   // "function+0xoffset" of the return address, or an empty string
+   std::string functionAt(const ElfFile& elf, uintptr_t return_address) {
+      const uintptr_t address = return_address - 1; // a return address points after the call
+      auto after = std::upper_bound(elf.symbols.begin(), elf.symbols.end(), address, [](uintptr_t value, const Symbol& symbol) {
+         return value < symbol.address;
+      });
+      while (after != elf.symbols.begin()) {
+         --after;
+         if (address < after->address + std::max<uintptr_t>(after->size, 1)) {
+            std::ostringstream oss;
+            oss << demangle(after->name) << "+0x" << std::hex << (return_address - after->address);
+            return oss.str();
+         }
+         if (after->size > 0) {
+            break; // sized symbols do not overlap, an earlier one cannot hold the address
+         }
+      }
+      return {};
+   }
+
+   std::string symbolize(uintptr_t frame, const std::vector<Module>& modules) {
+      for (const auto& module : modules) {
+         if (frame < module.low || frame >= module.high) {
+            continue;
+         }
+
+         const uintptr_t address = frame - module.bias;
+         std::ostringstream oss;
+         oss << module.path;
+         std::vector<std::string> candidates;
+         if (!debugDirectory.empty() && module.build_id.size() > 2) {
+            candidates.push_back(debugDirectory + "/.build-id/" + module.build_id.substr(0, 2) + "/" + module.build_id.substr(2) + ".debug");
+         }
+         candidates.push_back(module.path);
+
+         bool mismatch = false;
+         for (const auto& candidate : candidates) {
+            const ElfFile& elf = elfFile(candidate);
+            if (!elf.good) {
+               continue;
+            }
+            if ("-" != module.build_id && elf.build_id != module.build_id) {
+               mismatch = true;
+               continue;
+            }
+            const std::string function = functionAt(elf, address);
+            if (!function.empty()) {
+               oss << " : " << function;
+               return oss.str();
+            }
+         }
+         oss << "+0x" << std::hex << (frame - module.bias) << (mismatch ? " (build-id mismatch)" : "");
+         return oss.str();
+      }
+      return "[unknown module]";
+   }
+
+   bool parseHex(const std::string& text, uintptr_t& value) {
+      char* end = nullptr;
+      value = static_cast<uintptr_t>(std::strtoull(text.c_str(), &end, 16));
+      return end != text.c_str();
+   }
+
+   // "load map <low>-<high> bias <bias> build-id <hex or -> <path>"
+   bool parseModule(const std::string& line, Module& module) {
+      const auto start = line.find("load map 0x");
+      if (std::string::npos == start) {
+         return false;
+      }
+      std::istringstream fields(line.substr(start + std::string("load map ").size()));
+      std::string range, bias_label, bias, build_id_label;
+      fields >> range >> bias_label >> bias >> build_id_label >> module.build_id;
+      std::getline(fields >> std::ws, module.path);
+      const auto dash = range.find('-');
+      return "bias" == bias_label && "build-id" == build_id_label && std::string::npos != dash
+             && parseHex(range.substr(0, dash), module.low) && parseHex(range.substr(dash + 1), module.high)
+             && parseHex(bias, module.bias) && !module.path.empty();
+   }
+
+   // "raw frame [<index>] <address>"
+   bool parseFrame(const std::string& line, std::string& index, uintptr_t& address) {
+      const auto start = line.find("raw frame [");
+      const auto close = line.find("] 0x", start);
+      if (std::string::npos == start || std::string::npos == close) {
+         return false;
+      }
+      const auto first = start + std::string("raw frame [").size();
+      index = line.substr(first, close - first);
+      return parseHex(line.substr(close + 2), address);
+   }
+
+   void symbolizeLog(std::istream& in) {
+      std::vector<std::string> lines;
+      std::string line;
+      while (std::getline(in, line)) {
+         lines.push_back(line);
+      }
+
+      // the load map follows its frames: read backwards, a frame ends the load map before it
+      std::vector<Module> modules;
+      bool frames_seen = false;
+      for (size_t index = lines.size(); index-- > 0;) {
+         Module module;
+         std::string frame_index;
+         uintptr_t address = 0;
+         if (parseModule(lines[index], module)) {
+            if (frames_seen) {
+               modules.clear();
+               frames_seen = false;
+            }
+            modules.push_back(module);
+         } else if (parseFrame(lines[index], frame_index, address)) {
+            frames_seen = true;
+            std::ostringstream oss;
+            oss << lines[index].substr(0, lines[index].find("raw frame ["));
+            oss << "stack dump [" << frame_index << "]  " << symbolize(address, modules) << " [0x" << std::hex << address << "]";
+            lines[index] = oss.str();
+         }
+      }
+
+      for (const auto& text : lines) {
+         std::cout << text << "\n";
+      }
+      std::cout << std::flush;
+   }
+} // anonymous
+
+
+int main(int argc, char** argv) {
+   std::vector<std::string> files;
+   for (int index = 1; index < argc; ++index) {
+      const std::string argument = argv[index];
+      if ("-d" == argument && index + 1 < argc) {
+         debugDirectory = argv[++index];
+      } else if ("-h" == argument || "--help" == argument || "-d" == argument) {
+         return usage();
+      } else {
+         files.push_back(argument);
+      }
+   }
+
+   if (files.empty()) {
+      symbolizeLog(std::cin);
+      return 0;
+   }
+
+   bool all_read = true;
+   for (const auto& file : files) {
+      std::ifstream in(file);
+      if (!in.is_open()) {
+         std::cerr << "g3log-symbolize: cannot read [" << file << "]" << std::endl;
+         all_read = false;
+         continue;
+      }
+      symbolizeLog(in);
+   }
+   return all_read ? 0 : 1;
+}